@@ -0,0 +1,9 @@
+# The rewards of Pong for chip8-vecenv (see VecEnv::readSpec), the agent is the left player
+# Both scores are in VE = 10 * left + right, stored with FX33: the hundreds and tens digits are the left player's points
+reward 0x2F2 bytes 2 bcd
+reward 0x2F4 scale -1
+# The right player's 10th point would carry from the ones digit into the tens digit (a point for the left player)
+# and VE wraps around past 255, so the episode ends before either can happen
+done 0x2F4 eq 9
+done 0x2F2 eq 2
+max_frames 3600
@@ -0,0 +1,83 @@
+#ifndef AOT_HPP
+#define AOT_HPP
+#include <cstdint>
+#include <string>
+
+// The interface between the emulator and ROMs translated ahead of time by chip8-aot
+// The translated ROMs are shared objects, they include this header so everything above AotModule has to stay plain C
+
+#define CHIP8_AOT_ABI_VERSION 2
+#define CHIP8_AOT_SYMBOL "chip8_aot_module"
+
+extern "C"
+{
+    // The emulator state, given to the translated code on every run
+    struct Chip8AotContext
+    {
+        void* self;                     // the emulator, only passed back to the functions below
+        std::uint8_t* regs;             // V0 - VF
+        std::uint16_t* I;
+        std::uint16_t* PC;
+        const std::int32_t* keys;       // the Chip8::KeyState of every key
+        const std::uint8_t* dirty;      // one per even address, non zero if the block starting there was overwritten
+        std::uint8_t quirks;            // the Quirks::Flag bits in effect
+
+        // Executes a single instruction with the interpreter, the PC has to already point after it
+        void (*execute)(void* self, std::uint16_t opcode);
+
+        // Clamps I like the interpreter does when it goes out of bounds, pc is what the interpreter's PC would be
+        void (*check_i)(void* self, std::uint16_t pc);
+    };
+
+    // What a translated ROM exports under CHIP8_AOT_SYMBOL
+    struct Chip8AotModule
+    {
+        std::uint32_t abi_version;      // CHIP8_AOT_ABI_VERSION at the time of translating
+        const std::uint8_t* rom;        // the ROM that was translated, it's loaded at Chip8Const::rom_mem_start
+        std::uint32_t rom_size;
+        const std::uint16_t* blocks;    // (start address, amount of instructions) for every translated block
+        std::uint32_t block_count;
+
+        // Runs translated blocks until the PC leaves them, reaches an overwritten block,
+        // or the next block doesn't fit in the budget, returns the amount of instructions executed
+        std::uint64_t (*run)(Chip8AotContext* context, std::uint64_t budget);
+    };
+}
+
+// An ahead of time translated ROM loaded from a shared object
+class AotModule
+{
+private:
+    void* m_handle{};
+    const Chip8AotModule* m_module{};
+public:
+    // --- Constructors ---
+
+    //  Description:    creates an empty AotModule, to load one use AotModule::load
+    AotModule();
+
+    AotModule(const AotModule&) = delete;
+    AotModule& operator=(const AotModule&) = delete;
+    AotModule(AotModule&& other) noexcept;
+    AotModule& operator=(AotModule&& other) noexcept;
+    ~AotModule();
+
+    // --- Member functions ---
+
+    //  Name:           load
+    //  Description:    loads the shared object in the provided path, anything loaded before is unloaded
+    //  Arguments:      path - the path to the shared object
+    //  Return:         true if it was loaded and its ABI version matches, false otherwise
+    bool load(const std::string& path);
+
+    //  Name:           unload
+    //  Description:    unloads the module
+    void unload();
+
+    //  Name:           get
+    //  Description:    returns the loaded module
+    //  Return:         the module, or nullptr if none is loaded
+    const Chip8AotModule* get() const;
+};
+
+#endif
@@ -1,57 +1,108 @@
 #ifndef CHIP8_HPP
 #define CHIP8_HPP
 #include <string>
-#include <stack>
 #include <array>
-#include <map>
-#include <functional>
+#include <bitset>
+#include <vector>
+#include <span>
 #include "Chip8Common.hpp"
 #include "Timer.hpp"
 #include "VarRegs.hpp"
 #include "Memory.hpp"
+#include "Stack.hpp"
+#include "Rewind.hpp"
+#include "Random.hpp"
 #include "Display.hpp"
 #include "Instruction.hpp"
+#include "ExecutableBuffer.hpp"
+#include "Aot.hpp"
+#include "Quirks.hpp"
+
+// The MemoryAccess policy of the emulator memory (Checked, Masked or Unchecked), CMake sets it with -DCHIP8_MEMORY_ACCESS
+#ifndef CHIP8_MEMORY_ACCESS
+#define CHIP8_MEMORY_ACCESS Checked
+#endif
 
 class Chip8
 {
+public:
+    typedef Memory<Chip8Const::mem_size, MemoryAccess::CHIP8_MEMORY_ACCESS> MemoryType;
+    typedef Stack<Chip8Const::stack_size> StackType;
+
+    // Every instruction the emulator knows how to execute, INVALID is used for everything else
+    enum class OpType : Chip8_t::Byte
+    {
+        _00E0, _00EE, _0NNN, _1NNN, _2NNN, _3XNN, _4XNN, _5XY0,
+        _6XNN, _7XNN, _8XY0, _8XY1, _8XY2, _8XY3, _8XY4, _8XY5,
+        _8XY6, _8XY7, _8XYE, _9XY0, _ANNN, _BXNN, _CXNN, _DXYN,
+        _EX9E, _EXA1, _FX07, _FX0A, _FX15, _FX18, _FX1E, _FX29,
+        _FX33, _FX55, _FX65,
+        INVALID,
+    };
+
+    struct DecodedOp;
+
+    // A pointer to one of the emulator functions (_00E0, _1NNN, ...)
+    typedef void (Chip8::*OpHandler)(const DecodedOp&);
+
+    // An instruction that has already been decoded, the operands are extracted so the handler doesn't have to
+    struct DecodedOp
+    {
+        OpHandler handler{};
+        Chip8_t::Word opcode{};
+        Chip8_t::Word nnn{};
+        Chip8_t::Byte x{};
+        Chip8_t::Byte y{};
+        Chip8_t::Byte n{};
+        Chip8_t::Byte nn{};
+        OpType type{ OpType::INVALID };
+    };
+
+    // The amount of possible opcodes (0x0000 - 0xFFFF)
+    static constexpr std::uint32_t opcode_amount{ 0xFFFF + 1 };
+
+    typedef std::array<DecodedOp, opcode_amount> DispatchTable;
+
 private:
     // ---- Emulator functions ----
+    // The ones that depend on the quirks are templated on a Quirks::Policy, see header/template_defs/Chip8.tpp
 
-    void _00E0(const Instruction<Chip8_t::Word>& instr);
-    void _00EE(const Instruction<Chip8_t::Word>& instr);
-    void _0NNN(const Instruction<Chip8_t::Word>& instr);
-    void _1NNN(const Instruction<Chip8_t::Word>& instr);
-    void _2NNN(const Instruction<Chip8_t::Word>& instr);
-    void _3XNN(const Instruction<Chip8_t::Word>& instr);
-    void _4XNN(const Instruction<Chip8_t::Word>& instr);
-    void _5XY0(const Instruction<Chip8_t::Word>& instr);
-    void _6XNN(const Instruction<Chip8_t::Word>& instr);
-    void _7XNN(const Instruction<Chip8_t::Word>& instr);
-    void _8XY0(const Instruction<Chip8_t::Word>& instr);
-    void _8XY1(const Instruction<Chip8_t::Word>& instr);
-    void _8XY2(const Instruction<Chip8_t::Word>& instr);
-    void _8XY3(const Instruction<Chip8_t::Word>& instr);
-    void _8XY4(const Instruction<Chip8_t::Word>& instr);
-    void _8XY5(const Instruction<Chip8_t::Word>& instr);
-    void _8XY7(const Instruction<Chip8_t::Word>& instr);
-    void _8XY6(const Instruction<Chip8_t::Word>& instr);
-    void _8XYE(const Instruction<Chip8_t::Word>& instr);
-    void _9XY0(const Instruction<Chip8_t::Word>& instr);
-    void _ANNN(const Instruction<Chip8_t::Word>& instr);
-    void _BXNN(const Instruction<Chip8_t::Word>& instr);
-    void _CXNN(const Instruction<Chip8_t::Word>& instr);
-    void _DXYN(const Instruction<Chip8_t::Word>& instr);
-    void _EX9E(const Instruction<Chip8_t::Word>& instr);
-    void _EXA1(const Instruction<Chip8_t::Word>& instr);
-    void _FX07(const Instruction<Chip8_t::Word>& instr);
-    void _FX15(const Instruction<Chip8_t::Word>& instr);
-    void _FX18(const Instruction<Chip8_t::Word>& instr);
-    void _FX1E(const Instruction<Chip8_t::Word>& instr);
-    void _FX0A(const Instruction<Chip8_t::Word>& instr);
-    void _FX29(const Instruction<Chip8_t::Word>& instr);
-    void _FX33(const Instruction<Chip8_t::Word>& instr);
-    void _FX55(const Instruction<Chip8_t::Word>& instr);
-    void _FX65(const Instruction<Chip8_t::Word>& instr);
+    void invalidOp(const DecodedOp& op);
+    void _00E0(const DecodedOp& op);
+    void _00EE(const DecodedOp& op);
+    void _0NNN(const DecodedOp& op);
+    void _1NNN(const DecodedOp& op);
+    void _2NNN(const DecodedOp& op);
+    void _3XNN(const DecodedOp& op);
+    void _4XNN(const DecodedOp& op);
+    void _5XY0(const DecodedOp& op);
+    void _6XNN(const DecodedOp& op);
+    void _7XNN(const DecodedOp& op);
+    void _8XY0(const DecodedOp& op);
+    template <typename Quirks> void _8XY1(const DecodedOp& op);
+    template <typename Quirks> void _8XY2(const DecodedOp& op);
+    template <typename Quirks> void _8XY3(const DecodedOp& op);
+    void _8XY4(const DecodedOp& op);
+    void _8XY5(const DecodedOp& op);
+    void _8XY7(const DecodedOp& op);
+    template <typename Quirks> void _8XY6(const DecodedOp& op);
+    template <typename Quirks> void _8XYE(const DecodedOp& op);
+    void _9XY0(const DecodedOp& op);
+    void _ANNN(const DecodedOp& op);
+    template <typename Quirks> void _BXNN(const DecodedOp& op);
+    void _CXNN(const DecodedOp& op);
+    template <typename Quirks> void _DXYN(const DecodedOp& op);
+    void _EX9E(const DecodedOp& op);
+    void _EXA1(const DecodedOp& op);
+    void _FX07(const DecodedOp& op);
+    void _FX15(const DecodedOp& op);
+    void _FX18(const DecodedOp& op);
+    void _FX1E(const DecodedOp& op);
+    void _FX0A(const DecodedOp& op);
+    void _FX29(const DecodedOp& op);
+    void _FX33(const DecodedOp& op);
+    template <typename Quirks> void _FX55(const DecodedOp& op);
+    template <typename Quirks> void _FX65(const DecodedOp& op);
 
 public:
     enum class KeyState
@@ -69,27 +120,178 @@ public:
         INVALID,
     };
 
-    struct SaveState
+    // How the instructions get executed, all of them give the same results
+    enum class Backend
+    {
+        INTERPRETER,    // one instruction per dispatch
+        CACHED_BLOCKS,  // whole basic blocks of predecoded instructions per dispatch
+        JIT,            // hot basic blocks are compiled to native x86-64 code, the rest runs like CACHED_BLOCKS
+        AOT,            // blocks translated ahead of time by chip8-aot (see Chip8::loadAotModule), the rest runs like INTERPRETER
+        THREADED,       // one instruction per dispatch like INTERPRETER, but in a single computed goto loop (GCC/Clang only)
+        INVALID,
+    };
+
+    // Why Chip8::run returned
+    enum class StopReason
+    {
+        BUDGET,         // the maximum amount of instructions was emulated
+        KEY_WAIT,       // the maximum amount was reached while FX0A is waiting for a key, the PC points at it
+        BREAKPOINT,     // the PC reached a breakpoint, the instruction there wasn't executed yet
+        FRAME,          // an instruction drew to the display (00E0, DXYN)
+        IDLE,           // the maximum amount was reached while the ROM goes around a loop that only waits for the delay timer or a key (see Chip8::isIdleLoop)
+        VBLANK,         // a frame (1/60 of a second of emulated time) ended
+        AUDIO,          // an audio buffer ended (see Chip8::setCyclesPerAudioBuffer)
+        STACK_OVERFLOW, // 2NNN found the stack full, the PC points at it
+        STACK_UNDERFLOW,// 00EE found the stack empty, the PC points at it
+        INVALID,
+    };
+
+    // When Chip8::run should return before the maximum amount of instructions
+    struct StopConditions
     {
-        Memory memory{Chip8Const::mem_size};
+        bool key_wait{ true };                                      // skip ahead to the next event when FX0A starts waiting, the time would only be spent waiting
+        bool idle{ true };                                          // skip whole times around an idle loop up to the next event when the ROM starts going around one, same reason
+        bool frame{};                                               // stop after every instruction that drew to the display
+        bool vblank{};                                              // stop at the end of every frame (see Chip8::setInstructionsPerFrame)
+        bool audio{};                                               // stop at the end of every audio buffer
+        const std::bitset<Chip8Const::mem_size>* breakpoints{};     // stop before executing an instruction at a set address (except the first one)
+    };
+
+    struct RunResult
+    {
+        StopReason reason{ StopReason::INVALID };
+        std::uint64_t executed{};                                   // the amount of instructions emulated
+        std::uint64_t elided{};                                     // the instructions skipped while waiting (KEY_WAIT, IDLE) until the next event or the maximum amount
+    };
+
+    // Everything the emulated machine is made of, in one trivially copyable block, so a snapshot is a single copy.
+    // Keys queued with Chip8::queueKeyEvent are input rather than state, they aren't part of it
+    struct MachineState
+    {
+        MemoryType memory{};
         Display display{Chip8Const::screen_width, Chip8Const::screen_height};
+        StackType stack{};
+        VarRegs regs{};
         Chip8_t::Word PC{};
         Chip8_t::Word I{};
-        std::stack<Chip8_t::Word> stack{};
-        VarRegs regs{Chip8Const::reg_amount};
+        Chip8_t::Byte delay_timer{};
+        Chip8_t::Byte sound_timer{};
+        std::array<KeyState, Chip8Const::buttons> keys{};
+        BehaviourType behaviour{ BehaviourType::CHIP8 };
+        std::uint8_t quirks{ Quirks::Cosmac::flags };
+        Timer::Mode timer_mode{ Timer::Mode::WALL_CLOCK };
+        std::uint32_t instructions_per_frame{ 11 };
+        std::uint32_t cycles_per_audio_buffer{};
+        std::uint64_t cycles{};
+        std::uint64_t next_frame{};         // the cycle the current frame ends at
+        std::uint64_t next_audio{};         // the cycle the current audio buffer ends at, 0 if there are no audio buffers
+        std::uint64_t rom_hash{};           // see Chip8::getRomHash
+        std::uint64_t seed{ Random::default_seed };     // see Chip8::setSeed
+        Random random{};                    // where CXNN continues from
     };
 private:
-    Memory m_memory{Chip8Const::mem_size};
+    // Everything a block compiled by the JIT needs, passed to it in the first argument
+    struct JitContext
+    {
+        Chip8* self{};
+        Chip8_t::Byte* regs{};
+        Chip8_t::Word* I{};
+        Chip8_t::Word* PC{};
+        KeyState* keys{};
+    };
+
+    // A block compiled by the JIT, returns the PC to continue from
+    typedef std::uint32_t (*JitBlockFn)(JitContext*);
+
+    // A straight line run of instructions that ends with a jump, call, return, skip, key wait or memory write
+    struct Block
+    {
+        std::uint32_t first_op{};   // index of the first instruction in m_block_ops
+        std::uint16_t op_count{};   // 0 if the block wasn't discovered yet
+        std::uint16_t hits{};       // how many times the block was executed, used to find hot blocks for the JIT
+        JitBlockFn native{};        // the compiled block, nullptr if not compiled (yet)
+    };
+
+    // Something that happens at an exact emulated cycle, one cycle is one instruction
+    enum class EventType : Chip8_t::Byte
+    {
+        FRAME,      // 1/60 of a second passed: the virtual timers go down and the display is shown (vblank), repeats
+        AUDIO,      // an audio buffer ended, repeats
+        KEY,        // a key changes its state (Chip8::queueKeyEvent)
+    };
+
+    struct Event
+    {
+        std::uint64_t cycle{};
+        std::uint64_t order{};      // events at the same cycle happen in the order they were scheduled
+        EventType type{};
+        Chip8_t::Byte key{};
+        KeyState state{};
+    };
+
+    // The maximum amount of instructions in a single block
+    static constexpr std::uint16_t max_block_length{ 64 };
+
+    // How many times a block has to be executed before the JIT compiles it
+    static constexpr std::uint16_t jit_threshold{ 8 };
+
+    // The most instructions an idle loop can have before its jump back
+    static constexpr std::size_t max_idle_loop_length{ 8 };
+
+    // The size of the memory that the JIT writes the compiled blocks to
+    static constexpr std::size_t jit_buffer_size{ 1 << 20 };
+
+    MemoryType m_memory{};
     Display m_display{Chip8Const::screen_width, Chip8Const::screen_height};
     Chip8_t::Word m_PC{};
     Chip8_t::Word m_I{};
-    std::stack<Chip8_t::Word> m_stack{};
+    StackType m_stack{};
     Timer m_delay_timer{};
     Timer m_sound_timer{}; 
-    VarRegs m_regs{Chip8Const::reg_amount};
+    VarRegs m_regs{};
     std::array<KeyState, Chip8Const::buttons> m_key_states{};
     BehaviourType m_behaviour{ BehaviourType::CHIP8 };
-    std::map<std::string, std::function<void(const Instruction<Chip8_t::Word>&)>> m_exec_map{};
+    std::uint8_t m_quirks{ Quirks::Cosmac::flags };    // the Quirks::Flag bits of the current dispatch table, for the backends that don't use the handlers
+    const DecodedOp* m_dispatch{};
+
+    // Decoded instructions for every even address (index = address / 2), nullptr if not decoded yet
+    std::array<const DecodedOp*, Chip8Const::mem_size / 2> m_decode_cache{};
+
+    // Basic blocks for the CACHED_BLOCKS backend, keyed by their starting address (index = address / 2)
+    Backend m_backend{ Backend::INTERPRETER };
+    std::array<Block, Chip8Const::mem_size / 2> m_blocks{};
+    std::vector<DecodedOp> m_block_ops{};
+    std::bitset<Chip8Const::mem_size> m_block_code{};   // bytes that belong to any block
+    bool m_flush_blocks{};                              // a block was written to, drop all of them before the next dispatch
+    StopReason m_stop{ StopReason::BUDGET };            // set to KEY_WAIT/IDLE/STACK_* to make the backends return, reset by Chip8::run
+    std::uint32_t m_idle_loop_length{ 1 };              // the instructions of the idle loop that set IDLE, including the jump back
+    Chip8_t::Word m_idle_head{};                        // where the last idle loop starts, 0 if there wasn't one since loading a state
+    std::uint64_t m_idle_cycle{};                       // the cycle right after its jump back, to tell if it went around once since
+    std::uint64_t m_event_cycle{};                      // the cycle the last event was serviced at
+    Timer::Mode m_timer_mode{ Timer::Mode::WALL_CLOCK };
+    std::uint32_t m_instructions_per_frame{ 11 };       // how many cycles make up 1/60 of a second
+    std::uint32_t m_cycles_per_audio_buffer{};          // 0 if there are no audio buffers
+
+    // The scheduler, every cycle emulated so far (executed or skipped) and a min-heap of the upcoming events
+    std::uint64_t m_cycles{};
+    std::vector<Event> m_events{};
+    std::uint64_t m_events_scheduled{};
+    std::uint64_t m_rom_hash{};                         // FNV-1a of the loaded ROM, 0 if none was loaded
+    std::uint64_t m_seed{ Random::default_seed };       // what m_random starts from when the memory is cleared
+    Random m_random{};                                  // for CXNN
+
+    // The history for Chip8::rewind, recorded at the end of frames
+    static constexpr std::uint32_t rewind_keyframe_interval{ 60 };
+    Rewind m_rewind{};
+    std::uint32_t m_frames_per_snapshot{ 1 };
+    std::uint32_t m_frames_until_snapshot{};
+    std::int64_t m_rewind_tick{};                       // the last 1/60 of a second of real time counted, with wall clock timers
+    ExecutableBuffer m_jit_code{};                      // compiled blocks for the JIT backend, allocated on first use
+
+    // The ahead of time translated ROM for the AOT backend
+    AotModule m_aot{};
+    std::array<std::uint16_t, Chip8Const::mem_size / 2> m_aot_lengths{};  // amount of instructions of the translated block starting at every even address
+    std::array<Chip8_t::Byte, Chip8Const::mem_size / 2> m_aot_dirty{};    // non zero if the translated block starting there no longer matches the memory
 
     // --- Private member functions ---
 
@@ -99,27 +301,238 @@ private:
     void jumpTo(Chip8_t::Word location);
 
     //  Name:           fetch
-    //  Description:    returns the byte code for the current instruction
-    //  Return:         an Instruction class object containing the instruction
-    Instruction<Chip8_t::Word> fetch();
-
-    //  Name:           decodeExecute
-    //  Description:    decodes and executes the instruction given
-    //  Arguments:      instruction - the instruction to decode and execute
-    std::string decode(const Instruction<Chip8_t::Word>& instruction);
-
-    //  Name:           execute
-    //  Description:    executes the provided instruction
-    //  Arguments:      which - which instruction to execute
-    //                  instruction - the instruction which caused this execute
-    void execute(const std::string& which, const Instruction<Chip8_t::Word>& instruction);
-
-public:  
+    //  Description:    returns the decoded current instruction and advances the PC,
+    //                  the instruction is taken from the decode cache if it was already decoded before
+    //  Return:         the decoded current instruction
+    const DecodedOp& fetch();
+
+    //  Name:           writeMemory
+    //  Description:    writes a byte to the memory and drops the cached decoded instruction at that address
+    //  Arguments:      where - the address to write to
+    //                  what - the byte to write
+    void writeMemory(Chip8_t::Word where, Chip8_t::Byte what);
+
+    //  Name:           writeMemory
+    //  Description:    writes the bytes to consecutive addresses starting at 'where' and drops what was cached for them
+    //  Arguments:      where - the address of the first byte
+    //                  what - the bytes to write
+    void writeMemory(Chip8_t::Word where, std::span<const Chip8_t::Byte> what);
+
+    //  Name:           memoryWritten
+    //  Description:    drops the cached decoded instruction, block and translated blocks that contain the byte at 'where'
+    //  Arguments:      where - the address that was written to
+    void memoryWritten(Chip8_t::Word where);
+
+    //  Name:           invalidateDecodeCache
+    //  Description:    drops all cached decoded instructions, used when the whole memory is replaced
+    void invalidateDecodeCache();
+
+    //  Name:           flushBlocks
+    //  Description:    drops all discovered basic blocks
+    void flushBlocks();
+
+    //  Name:           getBlock
+    //  Description:    returns the basic block starting at the provided address, discovering it if needed
+    //  Arguments:      address - the address the block starts at
+    //  Return:         the block, or nullptr if no block can start at that address
+    Block* getBlock(Chip8_t::Word address);
+
+    //  Name:           step
+    //  Description:    emulates a single instruction (fetch, decode and execute) without moving the clock,
+    //                  the backends call it, Chip8::run counts the cycles and services the events
+    //  Return:         the instruction that was executed
+    const DecodedOp& step();
+
+    //  Name:           emulateInterpreter
+    //  Description:    emulates up to the provided amount of instructions one at a time,
+    //                  every backend stops right after an FX0A that starts waiting for a key (see Chip8::run)
+    //  Arguments:      amount - the maximum amount of instructions to emulate
+    //  Return:         the amount of instructions emulated
+    std::uint64_t emulateInterpreter(std::uint64_t amount);
+
+    //  Name:           emulateBlocks
+    //  Description:    emulates up to the provided amount of instructions one basic block at a time,
+    //                  every backend stops right after an FX0A that starts waiting for a key (see Chip8::run)
+    //  Arguments:      amount - the maximum amount of instructions to emulate
+    //  Return:         the amount of instructions emulated
+    std::uint64_t emulateBlocks(std::uint64_t amount);
+
+    //  Name:           runBlockOps
+    //  Description:    interprets the first 'count' instructions of the block
+    //  Arguments:      block - the block to run
+    //                  count - the amount of instructions to run, must be <= block.op_count
+    void runBlockOps(const Block& block, std::uint64_t count);
+
+    //  Name:           emulateJit
+    //  Description:    emulates up to the provided amount of instructions one basic block at a time, running the hot blocks natively,
+    //                  every backend stops right after an FX0A that starts waiting for a key (see Chip8::run)
+    //  Arguments:      amount - the maximum amount of instructions to emulate
+    //  Return:         the amount of instructions emulated
+    std::uint64_t emulateJit(std::uint64_t amount);
+
+    //  Name:           compileBlock
+    //  Description:    translates the block to native code
+    //  Arguments:      block - the block to compile
+    //                  address - the address the block starts at
+    //  Return:         the compiled block, or nullptr if it couldn't be compiled
+    JitBlockFn compileBlock(const Block& block, Chip8_t::Word address);
+
+    //  Name:           jitCallHandler
+    //  Description:    called by compiled blocks to execute instructions that aren't translated (DXYN, FX0A, timers, ...)
+    //  Arguments:      self - the emulator
+    //                  op - the instruction to execute
+    static void jitCallHandler(Chip8* self, const DecodedOp* op);
+
+    //  Name:           jitCheckI
+    //  Description:    called by compiled blocks when I went out of bounds
+    //  Arguments:      self - the emulator
+    //                  pc - the PC the interpreter would have at this point
+    static void jitCheckI(Chip8* self, std::uint32_t pc);
+
+    //  Name:           emulateThreaded
+    //  Description:    emulates up to the provided amount of instructions in a single computed goto loop,
+    //                  every backend stops right after an FX0A that starts waiting for a key (see Chip8::run)
+    //  Arguments:      amount - the maximum amount of instructions to emulate
+    //  Return:         the amount of instructions emulated
+    std::uint64_t emulateThreaded(std::uint64_t amount);
+
+    //  Name:           emulateAot
+    //  Description:    emulates up to the provided amount of instructions with the ahead of time translated ROM,
+    //                  anything it doesn't cover is interpreted,
+    //                  every backend stops right after an FX0A that starts waiting for a key (see Chip8::run)
+    //  Arguments:      amount - the maximum amount of instructions to emulate
+    //  Return:         the amount of instructions emulated
+    std::uint64_t emulateAot(std::uint64_t amount);
+
+    //  Name:           runChecked
+    //  Description:    Chip8::run for stop conditions that have to be checked after every instruction (breakpoints, frames),
+    //                  always interprets one instruction at a time
+    //  Arguments:      max_instructions - the maximum amount of instructions to emulate
+    //                  conditions - when to stop before that
+    //  Return:         why it stopped and how many instructions were emulated
+    RunResult runChecked(std::uint64_t max_instructions, const StopConditions& conditions);
+
+    //  Name:           eventLater
+    //  Description:    orders the events in m_events, the first one to happen is at the front of the heap
+    //  Arguments:      a, b - the events to compare
+    //  Return:         true if 'a' happens after 'b'
+    static bool eventLater(const Event& a, const Event& b);
+
+    //  Name:           scheduleEvent
+    //  Description:    adds an event to the scheduler
+    //  Arguments:      event - the event, the order is set by this function
+    void scheduleEvent(Event event);
+
+    //  Name:           resetEvents
+    //  Description:    schedules the repeating events (frames, audio buffers) again starting from the current cycle, the queued keys stay
+    void resetEvents();
+
+    //  Name:           nextEventCycle
+    //  Description:    returns the cycle of the first upcoming event that matters, the others can be serviced late
+    //                  (a frame only matters with virtual timers or the vblank condition, an audio buffer only with the audio condition)
+    //  Arguments:      conditions - the stop conditions of the current run
+    //  Return:         the cycle of the event, or the maximum value if there isn't one
+    std::uint64_t nextEventCycle(const StopConditions& conditions);
+
+    //  Name:           recordRewind
+    //  Description:    counts frames towards the next snapshot of the rewind history and records it once enough of them ended
+    //  Arguments:      frames - how many frames ended
+    void recordRewind(std::uint64_t frames);
+
+    //  Name:           serviceEvents
+    //  Description:    handles every event up to the current cycle, repeating events that were missed a few times are handled once for all of them
+    //  Arguments:      conditions - the stop conditions of the current run
+    //  Return:         VBLANK or AUDIO if one of them happened and it's a stop condition, otherwise BUDGET
+    StopReason serviceEvents(const StopConditions& conditions);
+
+    //  Name:           endSlice
+    //  Description:    called by Chip8::run after some instructions were emulated, skips to the next event if the ROM is waiting and services the events
+    //  Arguments:      result - the result of the run so far, updated with the skipped instructions and the reason
+    //                  end - the cycle at which the run ends
+    //                  conditions - the stop conditions of the run
+    //  Return:         true if the run has to stop
+    bool endSlice(RunResult& result, std::uint64_t end, const StopConditions& conditions);
+
+    //  Name:           revalidateAot
+    //  Description:    compares every translated block with the memory, marking the ones that don't match as dirty
+    void revalidateAot();
+
+    //  Name:           aotExecute
+    //  Description:    called by translated ROMs to execute instructions they don't translate
+    //  Arguments:      self - the emulator
+    //                  opcode - the instruction to execute
+    static void aotExecute(void* self, std::uint16_t opcode);
+
+    //  Name:           aotCheckI
+    //  Description:    called by translated ROMs when I went out of bounds
+    //  Arguments:      self - the emulator
+    //                  pc - the PC the interpreter would have at this point
+    static void aotCheckI(void* self, std::uint16_t pc);
+
+    //  Name:           getIdleLoopLength
+    //  Description:    checks whether the jump back at 'jump' closes an idle loop starting at 'head' (see Chip8::isIdleLoop)
+    //  Arguments:      head - the address the jump goes to
+    //                  jump - the address of the jump
+    //  Return:         the instructions of the loop including the jump back, 0 if it isn't an idle loop
+    std::size_t getIdleLoopLength(Chip8_t::Word head, Chip8_t::Word jump);
+
+    //  Name:           checkI
+    //  Description:    makes sure the I register points inside the memory
+    void checkI();
+
+    //  Name:           getDecodeTable
+    //  Description:    returns the table of all 65536 opcodes decoded ahead of time, it's built once on first use,
+    //                  the instructions that depend on the quirks execute like Quirks::Cosmac
+    //  Return:         the decoded instructions, indexed by opcode
+    static const DispatchTable& getDecodeTable();
+
+    //  Name:           getDispatchTable
+    //  Description:    returns the decode table with the handlers for the provided quirks, it's built once on first use
+    //  Return:         the dispatch table, indexed by opcode
+    template <typename Quirks>
+    static const DispatchTable& getDispatchTable();
+
+    //  Name:           getDispatchTable
+    //  Description:    returns the dispatch table for quirks only known at run time (e.g. from a MachineState)
+    //  Arguments:      flags - the Quirks::Flag bits
+    //  Return:         the dispatch table, indexed by opcode
+    static const DispatchTable& getDispatchTable(std::uint8_t flags);
+
+public:
     // --- Constructors ---
 
     //  Description: Returns a Chip8 emulator class object, to load a ROM use Chip8::load
     Chip8();
 
+    // --- Static functions ---
+
+    //  Name:           decode
+    //  Description:    decodes the instruction into its name (eg. "8XY4"), meant for debugging and disassembling,
+    //                  the emulation itself uses the precomputed dispatch table instead
+    //  Arguments:      instruction - the instruction to decode
+    //  Return:         the name of the instruction, or an empty string if the instruction is invalid
+    static std::string decode(const Instruction<Chip8_t::Word>& instruction);
+
+    //  Name:           decodeOp
+    //  Description:    returns the already decoded form of the provided opcode
+    //  Arguments:      opcode - the opcode to look up
+    //  Return:         the decoded instruction
+    static const DecodedOp& decodeOp(Chip8_t::Word opcode);
+
+    //  Name:           isIdleLoop
+    //  Description:    checks whether a loop can only be waiting for the delay timer or a key, meaning every time around
+    //                  it does exactly the same thing until one of them changes: it only sets registers with 6XNN, ANNN
+    //                  and FX07, and a skip right before the jump back may decide whether to leave
+    //  Arguments:      body - the opcodes from the start of the loop up to the jump back, not including it
+    //                  count - the amount of opcodes in body
+    //  Return:         true if it's an idle loop, false otherwise
+    static bool isIdleLoop(const Chip8_t::Word* body, std::size_t count);
+
+    //  Name:           isJitSupported
+    //  Description:    returns whether the JIT backend can run on this platform, if not it behaves like CACHED_BLOCKS
+    //  Return:         true if it can, false otherwise
+    static bool isJitSupported();
+
     // --- Member functions ---
 
     //  Name:           setBehaviourType
@@ -127,29 +540,123 @@ public:
     //  Arguments:      type - the value to switch to
     void setBehaviourType(BehaviourType type);
 
+    //  Name:           setQuirks
+    //  Description:    switches to any combination of quirks, the instructions are specialized for it at compile time
+    //                  (setBehaviourType uses this with Quirks::Cosmac or Quirks::SuperChip)
+    template <typename Quirks>
+    void setQuirks();
+
+    //  Name:           setQuirkFlags
+    //  Description:    switches to the quirks in the provided Quirks::Flag bits, like setQuirks but chosen at run time
+    //  Arguments:      flags - the Quirks::Flag bits, the unknown ones are ignored
+    void setQuirkFlags(std::uint8_t flags);
+
+    //  Name:           getQuirks
+    //  Description:    returns the quirks currently in effect
+    //  Return:         the Quirks::Flag bits
+    std::uint8_t getQuirks();
+
+    //  Name:           setBackend
+    //  Description:    switches the way the instructions are executed, this doesn't change the results
+    //  Arguments:      backend - the backend to switch to
+    void setBackend(Backend backend);
+
+    //  Name:           getBackend
+    //  Description:    returns the backend currently used for executing instructions
+    //  Return:         the current backend
+    Backend getBackend();
+
+    //  Name:           loadAotModule
+    //  Description:    loads a ROM translated by chip8-aot for the AOT backend, the ROM itself still has to be loaded with Chip8::loadMemory
+    //  Arguments:      path - the path to the shared object made from chip8-aot output
+    //  Return:         true if it was loaded, false otherwise
+    bool loadAotModule(const std::string& path);
+
     //  Name:           loadMemory
     //  Description:    loads the file in provided path to the memory, the file should be a CHIP8 rom file
     //  Arguments:      path - the path to the CHIP8 file
     bool loadMemory(const std::string& path);
 
+    //  Name:           loadMemory
+    //  Description:    loads a ROM that is already in memory (e.g. shared by many emulators), whatever doesn't fit is left out
+    //  Arguments:      rom - the contents of a CHIP8 rom file
+    void loadMemory(std::span<const Chip8_t::Byte> rom);
+
+    //  Name:           getRomHash
+    //  Description:    returns a hash of the last ROM loaded with loadMemory, to tell if a save state belongs to it
+    //  Return:         the 64 bit FNV-1a hash of the ROM file, 0 if no ROM was loaded since the memory was cleared
+    std::uint64_t getRomHash();
+
+    //  Name:           setSeed
+    //  Description:    sets what the random numbers of CXNN start from, now and every time the memory is cleared,
+    //                  so the same ROM, input and seed always run the same way
+    //  Arguments:      seed - any value (the default is Random::default_seed)
+    void setSeed(std::uint64_t seed);
+
+    //  Name:           getSeed
+    //  Description:    returns the seed set with setSeed
+    //  Return:         the seed
+    std::uint64_t getSeed();
+
     //  Name:           clearMemory
-    //  Description:    clears the memory of the emulator
+    //  Description:    clears the memory of the emulator and starts the random numbers over from the seed
     void clearMemory();
 
-    //  Name:           getSaveState
-    //  Description:    Copies the current emulator state and returns it
-    //  Return:         The save state
-    SaveState getSaveState();
+    //  Name:           saveState
+    //  Description:    copies the current machine state, without allocating
+    //  Arguments:      state - where to copy the state to
+    void saveState(MachineState& state);
+
+    //  Name:           loadState
+    //  Description:    restores a machine state made by saveState, the emulation continues exactly where it was saved
+    //                  (wall clock timers start counting down from the saved values again), the queued key events are dropped
+    //  Arguments:      state - the state to restore
+    void loadState(const MachineState& state);
+
+    //  Name:           setRewind
+    //  Description:    starts recording the machine state at the end of every 'frames' frames for Chip8::rewind,
+    //                  the history keeps as much as fits in the budget (a few bytes for frames where little changes).
+    //                  With wall clock timers a frame is 1/60 of a second of real time (checked whenever the emulator runs),
+    //                  with virtual timers it's Chip8::setInstructionsPerFrame instructions
+    //  Arguments:      budget - the most memory the history can take (in bytes), 0 stops recording
+    //                  frames - how many frames go by between the snapshots
+    void setRewind(std::size_t budget, std::uint32_t frames = 1);
 
-    //  Name:           loadSaveState
-    //  Description:    Loads the saved state
-    //  Arguments:      state - the save state to load
-    void loadSaveState(SaveState state);
+    //  Name:           rewind
+    //  Description:    goes back to the newest snapshot and drops it, so every call goes further back
+    //  Return:         false if there is nothing to go back to
+    bool rewind();
+
+    //  Name:           getRewindLength
+    //  Description:    returns how many snapshots Chip8::rewind can go back
+    //  Return:         the amount of snapshots
+    std::size_t getRewindLength();
 
     //  Name:           emulateStep
-    //  Description:    emulates a single instruction (fetch, decode and execute) and updates the emulator state
+    //  Description:    emulates a single instruction with the current backend, the same as run(1): the cycle is counted
+    //                  and its events (the timers with virtual timers, queued keys, rewind snapshots) are serviced
     void emulateStep();
 
+    //  Name:           emulateSteps
+    //  Description:    emulates the provided amount of instructions with the current backend, gives the same result
+    //                  as calling emulateStep that many times (it only stops early to wait for a key, which changes nothing)
+    //  Arguments:      amount - the amount of instructions to emulate
+    void emulateSteps(std::uint64_t amount);
+
+    //  Name:           run
+    //  Description:    emulates instructions with the current backend until the maximum amount or one of the stop conditions,
+    //                  frames and breakpoints are checked after every instruction so they always run like INTERPRETER
+    //  Arguments:      max_instructions - the maximum amount of instructions to emulate
+    //                  conditions - when to stop before that
+    //  Return:         why it stopped and how many instructions were emulated
+    RunResult run(std::uint64_t max_instructions, const StopConditions& conditions);
+
+    //  Name:           run
+    //  Description:    same as above with the default stop conditions (only waiting for a key)
+    //  Arguments:      max_instructions - the maximum amount of instructions to emulate
+    //  Return:         why it stopped and how many instructions were emulated
+    RunResult run(std::uint64_t max_instructions);
+
     //  Name:           getPixel()
     //  Description;    returns the Display pixel state for the provided coordinates
     //  Arguments:      x - the X coordinate
@@ -157,6 +664,22 @@ public:
     //  Return:         the state of the pixel at provided coordinates
     bool getPixel(Chip8_t::Byte x, Chip8_t::Byte y);
 
+    //  Name:           getDisplayGeneration
+    //  Description:    returns a number which increases every time the display changes (00E0, DXYN, loading a save state, ...)
+    //  Return:         the generation of the current frame, if it's the same as before the frame didn't change
+    std::uint64_t getDisplayGeneration();
+
+    //  Name:           takeDisplayDirtyRows
+    //  Description:    returns the display rows which changed since the last call and clears them, meant for a single consumer
+    //  Return:         the changed rows, bit Y for row Y
+    std::uint64_t takeDisplayDirtyRows();
+
+    //  Name:           getDisplayRow
+    //  Description:    returns the packed pixels of a display row, a whole row at once instead of a pixel at a time
+    //  Arguments:      y - the Y coordinate of the row (0 - 31)
+    //  Return:         the row at y, see Display::getRow
+    Display::Row getDisplayRow(Chip8_t::Word y);
+
     //  Name:           setKeyState
     //  Description:    sets the state of the provided key
     //  Arguments:      which - the key to set the state of
@@ -199,17 +722,64 @@ public:
     //  Name:           getStackCopy
     //  Description:    returns a copy of the stack
     //  Return:         a copy of the stack
-    std::stack<Chip8_t::Word> getStackCopy();
+    StackType getStackCopy();
 
     //  Name:           getDelayTimerValue
     //  Description:    returns the delay timer value
     //  Return:         the delay timer value
     std::uint8_t getDelayTimerValue();
 
+    //  Name:           getTimeUntilDelayTick
+    //  Description:    returns how long until the delay timer goes down next, meant for sleeping while the ROM is idle
+    //  Return:         the time in milliseconds, or -1 if the delay timer is 0 or virtual
+    std::int64_t getTimeUntilDelayTick();
+
+    //  Name:           setTimerMode
+    //  Description:    chooses whether the timers go down with real time or with the executed instructions (see setInstructionsPerFrame),
+    //                  virtual timers make runs deterministic and let them go as fast as the host can
+    //  Arguments:      mode - the mode of both timers
+    void setTimerMode(Timer::Mode mode);
+
+    //  Name:           getTimerMode
+    //  Description:    returns the mode of the timers
+    //  Return:         the mode of the timers
+    Timer::Mode getTimerMode();
+
+    //  Name:           setInstructionsPerFrame
+    //  Description:    sets how many cycles (instructions) make up a frame, 1/60 of a second: the virtual timers go down once and vblank happens,
+    //                  the frame and the audio buffer start over from the current cycle, queued key events stay queued
+    //  Arguments:      amount - the amount of instructions, at least 1
+    void setInstructionsPerFrame(std::uint32_t amount);
+
+    //  Name:           getCycles
+    //  Description:    returns how many cycles were emulated so far, one for every executed or skipped instruction
+    //  Return:         the amount of cycles
+    std::uint64_t getCycles();
+
+    //  Name:           queueKeyEvent
+    //  Description:    makes a key change its state at an exact cycle, for input that has to be repeatable (e.g. replays)
+    //  Arguments:      cycle - the cycle at which it happens, if it already passed it happens before the next instruction
+    //                  which - the key
+    //                  state - the state to set the key to
+    void queueKeyEvent(std::uint64_t cycle, Chip8_t::Byte which, KeyState state);
+
+    //  Name:           setCyclesPerAudioBuffer
+    //  Description:    sets how many cycles an audio buffer lasts, Chip8::run can stop at the end of each one (StopConditions::audio),
+    //                  the frame and the audio buffer start over from the current cycle, queued key events stay queued
+    //  Arguments:      cycles - the length of a buffer, 0 for none
+    void setCyclesPerAudioBuffer(std::uint32_t cycles);
+
+    //  Name:           getInstructionsPerFrame
+    //  Description:    returns how many executed instructions make the virtual timers go down once
+    //  Return:         the amount of instructions
+    std::uint32_t getInstructionsPerFrame();
+
     //  Name:           getSoundTimerValue
     //  Description:    returns the sound timer value
     //  Return:         the sound timer value
     std::uint8_t getSoundTimerValue();
 };
 
+#include "template_defs/Chip8.tpp"
+
 #endif
\ No newline at end of file
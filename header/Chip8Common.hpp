@@ -1,5 +1,6 @@
 #ifndef CHIP8_CONSTANTS
 #define CHIP8_CONSTANTS
+#include <array>
 #include <cstdint>
 
 
@@ -17,7 +18,29 @@ namespace Chip8Const
     inline constexpr Chip8_t::Byte buttons{0xF + 1};
     inline constexpr Chip8_t::Word font_begin{ 0 };
     inline constexpr Chip8_t::Byte reg_amount{ 0xF+1 };
+    inline constexpr Chip8_t::Byte stack_size{ 16 };
     inline constexpr Chip8_t::Word rom_mem_start{0x200};
+
+    // The hexadecimal digits 0-F, 5 rows of 4 pixels each, put at font_begin
+    inline constexpr std::array<Chip8_t::Byte, 16 * 5> font
+    {
+        0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+        0x20, 0x60, 0x20, 0x20, 0x70, // 1
+        0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+        0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+        0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+        0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+        0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+        0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+        0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+        0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+        0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+        0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+        0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+        0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+        0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+        0xF0, 0x80, 0xF0, 0x80, 0x80, // F
+    };
 }
 
 
@@ -1,18 +1,47 @@
 #ifndef DISPLAY_HPP
 #define DISPLAY_HPP
-#include <vector>
+#include <array>
+#include <cstdint>
+#include <span>
 #include "Chip8Common.hpp"
 
 class Display
 {
+public:
+    // The biggest display that can be held (SUPER-CHIP hires)
+    static constexpr Chip8_t::Word max_width{ 128 };
+    static constexpr Chip8_t::Word max_height{ 64 };
+
+    // A row of pixels packed into bits, the leftmost pixel is the highest bit of the first word
+    typedef std::array<std::uint64_t, max_width / 64> Row;
 private:
-    std::vector<std::vector<bool>> m_data{};
+    // The words are stored column by column, so the rows of a 64 pixel wide display are consecutive words
+    std::array<std::array<std::uint64_t, max_height>, max_width / 64> m_words{};
+    Chip8_t::Word m_width{};
+    Chip8_t::Word m_height{};
+    std::uint64_t m_dirty_rows{};   // bit Y is set when row Y was changed since the last takeDirtyRows
+    std::uint64_t m_generation{};   // increased by every change, so a consumer can tell if it has seen the current frame
+
+    //  Name:           markChanged
+    //  Description:    marks rows as dirty and starts a new generation
+    //  Arguments:      rows - the rows that changed, bit Y for row Y
+    void markChanged(std::uint64_t rows);
+
+    //  Name:           drawBits
+    //  Description:    XORs a row of up to 16 pixels onto the display pixel by pixel, used for displays which aren't 64 pixels wide
+    //  Arguments:      x - the X coordinate of the leftmost pixel
+    //                  y - the Y coordinate of the row
+    //                  bits - the pixels, the highest of the 'count' bits is the leftmost one
+    //                  count - the amount of pixels
+    //                  clip - whether the pixels past the right edge are cut off, instead of wrapping around to the left
+    //  Return:         whether any pixel that was on got turned off
+    bool drawBits(Chip8_t::Word x, Chip8_t::Word y, std::uint16_t bits, Chip8_t::Byte count, bool clip);
 public:
     // --- Constructors ---
 
     //  Description:    A Display class constructor
-    //  Arguments:      width - the width of the display (px)
-    //                  height - the height of the display (px)
+    //  Arguments:      width - the width of the display (px), at most max_width
+    //                  height - the height of the display (px), at most max_height
     Display(Chip8_t::Word width, Chip8_t::Word height);
 
     // --- Member functions ---
@@ -29,7 +58,7 @@ public:
     //  Arguments:       x - the X coordinate of the pixel
     //                   y - the Y coordinate of the pixel
     //  Return value:    The state of the pixel at (x, y) coordinates
-    bool getPixel(Chip8_t::Word x, Chip8_t::Word y);
+    bool getPixel(Chip8_t::Word x, Chip8_t::Word y) const;
 
     //  Name:           flipPixel
     //  Description:    flips the pixel at the provided coordinates
@@ -37,20 +66,59 @@ public:
     //                  y - the Y coordinate of the pixel
     void flipPixel(Chip8_t::Word x, Chip8_t::Word y);
 
+    //  Name:           drawSprite
+    //  Description:    XORs a whole sprite onto the display, starting at (x, y)
+    //  Arguments:      x - the X coordinate of the leftmost pixel
+    //                  y - the Y coordinate of the top row
+    //                  sprite - the rows of the sprite, one byte per row for 8 pixel wide sprites, two for 16 pixel wide ones
+    //                  wide - whether the sprite is 16 pixels wide, instead of 8
+    //                  clip - whether the pixels past the edges are cut off, instead of wrapping around to the other side
+    //  Return:         whether any pixel that was on got turned off
+    bool drawSprite(Chip8_t::Word x, Chip8_t::Word y, std::span<const Chip8_t::Byte> sprite, bool wide, bool clip);
+
+    //  Name:           getRow
+    //  Description:    returns the packed pixels of a row, the bits past the width are always 0
+    //  Arguments:      y - the Y coordinate of the row, has to be < getHeight()
+    //  Return:         the row at y
+    Row getRow(Chip8_t::Word y) const;
+
+    //  Name:           setRow
+    //  Description:    replaces the pixels of a row, the bits past the width are ignored
+    //  Arguments:      y - the Y coordinate of the row, has to be < getHeight()
+    //                  row - the packed pixels, like the ones getRow returns
+    void setRow(Chip8_t::Word y, const Row& row);
+
+    //  Name:           takeDirtyRows
+    //  Description:    returns the rows which changed since the last call and clears them,
+    //                  a row can be reported even if its pixels ended up the same (e.g. a sprite drawn twice)
+    //  Return:         the changed rows, bit Y for row Y
+    std::uint64_t takeDirtyRows();
+
+    //  Name:           getGeneration
+    //  Description:    returns a number which increases every time the display changes, it never decreases
+    //  Return:         the generation of the current pixels
+    std::uint64_t getGeneration() const;
+
+    //  Name:           restore
+    //  Description:    replaces the pixels with the ones of another display (e.g. from a save state),
+    //                  every row becomes dirty and the generation keeps increasing from this display's one
+    //  Arguments:      other - the display to copy the pixels of
+    void restore(const Display& other);
+
     //  Name:           setAll
     //  Description:    sets all pixels on display to provided state
     //  Arguments:      state - the state to set the pixels to
     void setAll(bool state);
 
     //  Name:           getWidth
-    //  Description:    returns the width of the Display, assumes the height is > 0
+    //  Description:    returns the width of the Display
     //  Return:         the width of the display
-    Chip8_t::Word getWidth();   
+    Chip8_t::Word getWidth() const;
 
     //  Name:           getHeight
     //  Description:    returns the height of the Display
     //  Return:         the height of the display
-    Chip8_t::Word getHeight();
+    Chip8_t::Word getHeight() const;
 };
 
-#endif
\ No newline at end of file
+#endif
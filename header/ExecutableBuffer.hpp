@@ -0,0 +1,95 @@
+#ifndef EXECUTABLEBUFFER_HPP
+#define EXECUTABLEBUFFER_HPP
+#include <cstdint>
+#include <cstddef>
+#include <initializer_list>
+
+// A block of memory that machine code can be written to and then executed from
+// It's never writable and executable at the same time, call unlock before writing and lock before executing
+class ExecutableBuffer
+{
+private:
+    std::uint8_t* m_data{};
+    std::size_t m_size{};
+    std::size_t m_position{};
+    bool m_overflow{};
+public:
+    // --- Constructors ---
+
+    //  Description:    creates an empty buffer, to get memory for it use ExecutableBuffer::allocate
+    ExecutableBuffer();
+
+    ExecutableBuffer(const ExecutableBuffer&) = delete;
+    ExecutableBuffer& operator=(const ExecutableBuffer&) = delete;
+    ExecutableBuffer(ExecutableBuffer&& other) noexcept;
+    ExecutableBuffer& operator=(ExecutableBuffer&& other) noexcept;
+    ~ExecutableBuffer();
+
+    // --- Static functions ---
+
+    //  Name:           isSupported
+    //  Description:    returns whether executable memory can be allocated on this platform
+    //  Return:         true if it can, false otherwise
+    static bool isSupported();
+
+    // --- Member functions ---
+
+    //  Name:           allocate
+    //  Description:    gets 'size' bytes of memory from the OS, anything allocated before is released
+    //  Arguments:      size - the amount of bytes
+    //  Return:         true on success, false otherwise
+    bool allocate(std::size_t size);
+
+    //  Name:           isAllocated
+    //  Description:    returns whether the buffer holds any memory
+    //  Return:         true if it does, false otherwise
+    bool isAllocated() const;
+
+    //  Name:           unlock
+    //  Description:    makes the buffer writable (and not executable)
+    void unlock();
+
+    //  Name:           lock
+    //  Description:    makes the buffer executable (and not writable)
+    void lock();
+
+    //  Name:           clear
+    //  Description:    forgets everything that was written, the next write starts at the beginning again
+    void clear();
+
+    //  Name:           emit
+    //  Description:    writes the bytes at the current position, if they don't fit the buffer is marked as overflown
+    //  Arguments:      bytes - the bytes to write
+    void emit(std::initializer_list<std::uint8_t> bytes);
+
+    //  Name:           emit16/emit32/emit64
+    //  Description:    writes a little endian value at the current position
+    //  Arguments:      value - the value to write
+    void emit16(std::uint16_t value);
+    void emit32(std::uint32_t value);
+    void emit64(std::uint64_t value);
+
+    //  Name:           patch32
+    //  Description:    overwrites an already written little endian value
+    //  Arguments:      position - where the value starts
+    //                  value - the value to write
+    void patch32(std::size_t position, std::uint32_t value);
+
+    //  Name:           getPosition
+    //  Description:    returns the position the next write will happen at
+    //  Return:         the position (in bytes from the start)
+    std::size_t getPosition() const;
+
+    //  Name:           getAddress
+    //  Description:    returns the address of the provided position
+    //  Arguments:      position - the position (in bytes from the start)
+    //  Return:         the address
+    void* getAddress(std::size_t position) const;
+
+    //  Name:           hasOverflown
+    //  Description:    returns whether any write didn't fit since the last clear
+    //  Return:         true if it did, false otherwise
+    bool hasOverflown() const;
+};
+
+#endif
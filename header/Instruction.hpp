@@ -15,20 +15,20 @@ public:
 
     //  Description:    a constructor for the Instruction class, takes in the instruction to create the class with
     //  Arguments:      instruction - the instruction to initialize it with
-    Instruction(const Instr_t& instruction);
+    constexpr Instruction(const Instr_t& instruction);
 
     //  Description:    a constructor for the Instruction class, takes in an array of nibbles to create the instruction
     //  Arguments:      nibbles - Nibbles to create the Instruction with
-    Instruction(const std::array<std::uint8_t, sizeof(Instr_t) * 2>& nibbles);
+    constexpr Instruction(const std::array<std::uint8_t, sizeof(Instr_t) * 2>& nibbles);
 
     //  Description:    a constructor for the Instruction class, takes in an array of bytes to create the instruction
     //  Arguments:      bytes - bytes to create the Instruction with
-    Instruction(const std::array<std::uint8_t, sizeof(Instr_t)>& bytes);
+    constexpr Instruction(const std::array<std::uint8_t, sizeof(Instr_t)>& bytes);
 
     //  Name:           getAmountOfNibbles
     //  Description:    returns the amount of nibbles that the instruction can  hold
     //  Return:         the amount of nibbles that the instruction can hold
-    std::uint16_t getAmountOfNibbles() const;
+    static constexpr std::uint16_t getAmountOfNibbles();
 
     //  Name:           getNibble
     //  Description:    gets the nibble at specified position
@@ -45,14 +45,53 @@ public:
     //                  for example for instruction: 0xDEAD
     //                  getNibbles(1,2) = 0xEA
     Instr_t getNibbles(const std::uint16_t& from, const std::uint16_t& to) const;
+
+    //  Name:           getNibble<which>
+    //  Description:    same as getNibble, but the position is checked at compile time so there are no runtime checks
+    //  Return:         the nibble at position 'which'
+    template <std::uint16_t which>
+    constexpr std::uint8_t getNibble() const;
+
+    //  Name:           getNibbles<from, to>
+    //  Description:    same as getNibbles, but the positions are checked at compile time so there are no runtime checks
+    //  Return:         The nibbles from 'from' to 'to' in a single number
+    template <std::uint16_t from, std::uint16_t to>
+    constexpr Instr_t getNibbles() const;
+
+    // --- CHIP8 instruction fields ---
+    // For an instruction like 0xDXYN / 0x8XY4 / 0x3XNN / 0xANNN
+
+    //  Name:           getOpClass
+    //  Description:    returns the first nibble, which says what kind of instruction it is (0xD for 0xDXYN)
+    constexpr std::uint8_t getOpClass() const;
+
+    //  Name:           getX
+    //  Description:    returns the second nibble, usually a register index
+    constexpr std::uint8_t getX() const;
+
+    //  Name:           getY
+    //  Description:    returns the third nibble, usually a register index
+    constexpr std::uint8_t getY() const;
+
+    //  Name:           getN
+    //  Description:    returns the fourth nibble
+    constexpr std::uint8_t getN() const;
+
+    //  Name:           getNN
+    //  Description:    returns the last byte (third and fourth nibble)
+    constexpr std::uint8_t getNN() const;
+
+    //  Name:           getNNN
+    //  Description:    returns the last three nibbles, usually an address
+    constexpr std::uint16_t getNNN() const;
     
     //  Name:           get
     //  Description:    returns the full instruction held by the class object
     //  Return:         the instruction held by the class object
-    Instr_t get() const;
+    constexpr Instr_t get() const;
 
 };
 
 #include "template_defs/Instruction.tpp"
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,255 @@
+#ifndef LOCKSTEP_HPP
+#define LOCKSTEP_HPP
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Chip8.hpp"
+
+// Many copies (lanes) of one CHIP8 machine run in lockstep, e.g. the same ROM with different inputs or seeds.
+// The registers, I, the PC, the timers and the keys are stored as arrays with an element per lane, so an instruction
+// that every lane is at executes for all of them in one loop the compiler vectorises (AVX-512 or AVX2, picked at run time).
+// The memory, the display and the stack of every lane are kept separately, the instructions using them run lane by lane.
+// When the lanes are at different instructions, the biggest groups at the same instruction still execute together and
+// the rest one lane at a time. Every lane gives exactly the same results as a Chip8 with the same quirks, seed and keys,
+// using virtual timers (see Chip8::setTimerMode)
+class Lockstep
+{
+public:
+    // How well the lanes kept together, since the last resetCounters
+    struct Counters
+    {
+        std::uint64_t cycles{};                 // instructions every running lane executed
+        std::uint64_t instructions{};           // instructions executed by all the lanes together
+        std::uint64_t vector_instructions{};    // the part of 'instructions' executed by groups of lanes
+        std::uint64_t vector_groups{};          // how many times a group of lanes executed an instruction together
+        std::uint64_t divergent_cycles{};       // cycles where the running lanes weren't all at the same instruction
+
+        //  Name:           getUtilisation
+        //  Description:    returns how full the groups were, 1 if every group had every lane in it
+        //  Arguments:      lanes - the amount of lanes
+        //  Return:         the average fraction of the lanes in a group
+        double getUtilisation(std::size_t lanes) const;
+    };
+
+    // The lanes are processed in blocks this big, the width of an AVX-512 register in bytes
+    static constexpr std::size_t lane_block{ 64 };
+
+    // When the lanes split up, the amount of groups looked for before the rest executes one lane at a time
+    static constexpr std::size_t max_groups{ 8 };
+
+    // A group smaller than this executes one lane at a time, it isn't worth a pass over every lane
+    static constexpr std::size_t min_group_lanes{ 4 };
+
+private:
+    // A key event for a single lane, see Chip8::queueKeyEvent
+    struct KeyEvent
+    {
+        std::uint64_t cycle{};
+        std::uint32_t lane{};
+        Chip8_t::Byte key{};
+        Chip8::KeyState state{};
+    };
+
+    // What every lane has on its own, too big or indexed too freely to be spread over the lanes
+    struct LaneState
+    {
+        Chip8::MemoryType memory{};
+        Display display{Chip8Const::screen_width, Chip8Const::screen_height};
+        Chip8::StackType stack{};
+        Random random{};
+        std::uint64_t seed{ Random::default_seed };
+        std::uint64_t stop_cycle{};             // the cycles the lane ran for, once it stopped
+        std::uint64_t stop_next_frame{};        // the end of the frame it stopped in
+        Chip8::StopReason stop{ Chip8::StopReason::BUDGET };
+    };
+
+    std::size_t m_lanes{};
+    std::size_t m_stride{};                     // m_lanes rounded up to lane_block, the padding lanes never run
+
+    // An element per lane, the registers and the keys are m_stride elements each, one after another
+    std::vector<Chip8_t::Byte> m_regs{};
+    std::vector<Chip8_t::Word> m_PC{};
+    std::vector<Chip8_t::Word> m_I{};
+    std::vector<Chip8_t::Byte> m_delay_timer{};
+    std::vector<Chip8_t::Byte> m_sound_timer{};
+    std::vector<Chip8_t::Byte> m_keys{};        // Chip8::KeyState
+    std::vector<Chip8_t::Byte> m_running{};     // 0xFF for the lanes that haven't stopped, 0 otherwise
+    std::vector<LaneState> m_lane_states{};
+
+    // Scratch space for splitting the lanes into groups, an element per lane
+    std::vector<Chip8_t::Word> m_opcodes{};
+    std::vector<Chip8_t::Byte> m_group{};
+    std::vector<Chip8_t::Byte> m_pending{};
+
+    // The memory the lanes start with, m_shared[address] is set while the byte there is the same in every lane,
+    // so the instruction at a PC every lane is at only has to be read once
+    Chip8::MemoryType m_reference{};
+    std::bitset<Chip8Const::mem_size> m_shared{};
+
+    std::uint8_t m_quirks{ Quirks::Cosmac::flags };
+    Chip8::BehaviourType m_behaviour{ Chip8::BehaviourType::CHIP8 };
+    std::uint32_t m_instructions_per_frame{ 11 };
+    std::uint64_t m_rom_hash{};
+    std::uint64_t m_cycles{};
+    std::uint64_t m_next_frame{};
+    std::vector<KeyEvent> m_key_events{};       // sorted by cycle, the ones before m_next_key_event were applied
+    std::size_t m_next_key_event{};
+    Counters m_counters{};
+
+    //  Name:           reg
+    //  Description:    returns the lanes of a register
+    //  Arguments:      which - the index of the register, only the low nibble is used
+    //  Return:         a pointer to the register of the first lane, the other lanes follow it
+    Chip8_t::Byte* reg(Chip8_t::Byte which);
+
+    //  Name:           key
+    //  Description:    returns the state of a key in a lane
+    //  Arguments:      lane - the lane
+    //                  which - the key, only the low nibble is used
+    //  Return:         the state
+    Chip8::KeyState key(std::size_t lane, Chip8_t::Byte which) const;
+
+    //  Name:           writeMemory
+    //  Description:    writes bytes to the memory of a lane, the bytes written are no longer the same in every lane
+    //  Arguments:      lane - the lane
+    //                  where - the address of the first byte
+    //                  what - the bytes
+    void writeMemory(std::size_t lane, Chip8_t::Word where, std::span<const Chip8_t::Byte> what);
+
+    //  Name:           stopLane
+    //  Description:    stops a lane that can't go on, it keeps the state it stopped with
+    //  Arguments:      lane - the lane
+    //                  reason - why it stopped (STACK_OVERFLOW or STACK_UNDERFLOW)
+    void stopLane(std::size_t lane, Chip8::StopReason reason);
+
+    //  Name:           executeLane
+    //  Description:    executes an instruction in a single lane, after the PC was moved past it
+    //  Arguments:      op - the instruction
+    //                  lane - the lane
+    void executeLane(const Chip8::DecodedOp& op, std::size_t lane);
+
+    //  Name:           stepLane
+    //  Description:    fetches and executes the next instruction of a single lane
+    //  Arguments:      lane - the lane
+    void stepLane(std::size_t lane);
+
+    //  Name:           stepGroup
+    //  Description:    executes the same instruction at the same PC in a group of lanes, the ones that only change the
+    //                  registers, I, the PC and the timers are executed for every lane at once
+    //  Arguments:      op - the instruction
+    //                  pc - the address of the instruction
+    //                  group - 0xFF for the lanes in the group, 0 for the rest
+    void stepGroup(const Chip8::DecodedOp& op, Chip8_t::Word pc, const Chip8_t::Byte* group);
+
+    //  Name:           step
+    //  Description:    executes an instruction in every running lane and services the events of the next cycle
+    void step();
+
+    //  Name:           serviceEvents
+    //  Description:    ends the frame (ticking the timers) and applies the key events, if it's their cycle
+    void serviceEvents();
+
+public:
+    // --- Constructors ---
+
+    //  Description:    creates the lanes with clear memory, like new Chip8 objects
+    //  Arguments:      lanes - the amount of lanes, at least 1
+    explicit Lockstep(std::size_t lanes);
+
+    // --- Member functions ---
+
+    //  Name:           getLaneCount
+    //  Description:    returns the amount of lanes
+    //  Return:         the amount of lanes
+    std::size_t getLaneCount() const;
+
+    //  Name:           setBehaviourType
+    //  Description:    switches the behaviour of every lane, like Chip8::setBehaviourType
+    //  Arguments:      type - the behaviour to switch to
+    void setBehaviourType(Chip8::BehaviourType type);
+
+    //  Name:           setQuirkFlags
+    //  Description:    switches the quirks of every lane, like Chip8::setQuirkFlags
+    //  Arguments:      flags - the Quirks::Flag bits, the unknown ones are ignored
+    void setQuirkFlags(std::uint8_t flags);
+
+    //  Name:           setInstructionsPerFrame
+    //  Description:    sets how many instructions make up a frame, like Chip8::setInstructionsPerFrame
+    //                  (the frame starts over, the queued key events stay queued)
+    //  Arguments:      amount - the amount of instructions, at least 1
+    void setInstructionsPerFrame(std::uint32_t amount);
+
+    //  Name:           setSeed
+    //  Description:    sets what the random numbers of a lane start from, like Chip8::setSeed
+    //  Arguments:      lane - the lane
+    //                  seed - any value
+    void setSeed(std::size_t lane, std::uint64_t seed);
+
+    //  Name:           clearMemory
+    //  Description:    starts every lane over, like Chip8::clearMemory, the cycle counter goes back to 0
+    void clearMemory();
+
+    //  Name:           loadMemory
+    //  Description:    loads the same ROM into every lane, like Chip8::loadMemory
+    //  Arguments:      rom - the contents of a CHIP8 rom file
+    void loadMemory(std::span<const Chip8_t::Byte> rom);
+
+    //  Name:           setKeyState
+    //  Description:    sets the state of a key in a lane right away
+    //  Arguments:      lane - the lane
+    //                  which - the key (0x0 - 0xF)
+    //                  state - the new state
+    void setKeyState(std::size_t lane, Chip8_t::Byte which, Chip8::KeyState state);
+
+    //  Name:           queueKeyEvent
+    //  Description:    sets the state of a key in a lane once the cycle counter reaches 'cycle', like Chip8::queueKeyEvent
+    //  Arguments:      lane - the lane
+    //                  cycle - when the key changes, now if it already passed
+    //                  which - the key (0x0 - 0xF)
+    //                  state - the new state
+    void queueKeyEvent(std::size_t lane, std::uint64_t cycle, Chip8_t::Byte which, Chip8::KeyState state);
+
+    //  Name:           run
+    //  Description:    executes instructions in every running lane, stopped lanes stay where they are
+    //  Arguments:      cycles - how many instructions every lane executes
+    //  Return:         the amount of lanes still running
+    std::size_t run(std::uint64_t cycles);
+
+    //  Name:           getCycles
+    //  Description:    returns how many instructions the running lanes executed since the memory was cleared
+    //  Return:         the amount of instructions
+    std::uint64_t getCycles() const;
+
+    //  Name:           getStopReason
+    //  Description:    returns why a lane stopped
+    //  Arguments:      lane - the lane
+    //  Return:         BUDGET while it's running, STACK_OVERFLOW or STACK_UNDERFLOW with the PC at the instruction that failed
+    Chip8::StopReason getStopReason(std::size_t lane) const;
+
+    //  Name:           saveState
+    //  Description:    copies the state of a lane, the same one a Chip8 would have
+    //  Arguments:      lane - the lane
+    //                  state - where to copy the state to
+    void saveState(std::size_t lane, Chip8::MachineState& state) const;
+
+    //  Name:           loadState
+    //  Description:    replaces the state of a lane (e.g. to fork a search from it) and starts it again if it stopped,
+    //                  the cycle counter, the frame and the quirks of the lanes don't change, the key events queued for it stay
+    //  Arguments:      lane - the lane
+    //                  state - the state to continue from
+    void loadState(std::size_t lane, const Chip8::MachineState& state);
+
+    //  Name:           getCounters
+    //  Description:    returns how well the lanes kept together
+    //  Return:         the counters
+    const Counters& getCounters() const;
+
+    //  Name:           resetCounters
+    //  Description:    sets every counter to 0
+    void resetCounters();
+};
+
+#endif
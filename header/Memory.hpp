@@ -1,38 +1,85 @@
 #ifndef MEMORY_HPP
 #define MEMORY_HPP
-#include <vector>
+#include <array>
+#include <span>
+#include <cstddef>
 #include <cstdint>
+#include <type_traits>
 
+// How Memory handles addresses past its end, chosen at compile time
+namespace MemoryAccess
+{
+    // Out of bounds reads return 0 and out of bounds writes are dropped, both are reported (for debugging)
+    struct Checked {};
+
+    // Addresses wrap around to the start of the memory, like the 12 bit address bus of the real hardware does
+    struct Masked {};
+
+    // No checks at all, only for ROMs that are known to stay in bounds
+    struct Unchecked {};
+
+    //  Name:           reportOutOfBounds
+    //  Description:    prints an out of bounds access made through MemoryAccess::Checked, kept out of line so the checks stay small
+    //  Arguments:      write   - whether it was a write or a read
+    //                  size    - the size of the memory
+    //                  where   - the first address of the access
+    //                  count   - the amount of bytes accessed
+    void reportOutOfBounds(bool write, std::size_t size, std::size_t where, std::size_t count);
+}
+
+// Size    - the amount of bytes that the memory can hold
+// Access  - one of the MemoryAccess policies
+template <std::size_t Size, typename Access = MemoryAccess::Checked>
 class Memory
 {
+    static_assert(Size > 0 && Size <= 0x10000, "Memory is addressed with 16 bits");
+    static_assert(!std::is_same_v<Access, MemoryAccess::Masked> || (Size & (Size - 1)) == 0, "Masked memory has to be a power of two in size");
+
 private:
-    std::vector<std::uint8_t > m_data{};
+    std::array<std::uint8_t, Size> m_data{};
 public:
-    // --- Constructors ---
-
-    //  Name:           Memory class constructor
-    //  Description:    Creates a new Memory object
-    //  Arguments:       size - the amount of bytes that the memory can hold
-    Memory(std::uint16_t size);
-
     // --- Member functions ---
 
     //  Name:           write
     //  Description:    writes a byte to the address provided
     //  Arguments:      where   - the address of the byte to write to
-    //                  what    - the byte to write in the address 
-    void write(std::uint16_t  where, std::uint8_t  what);
+    //                  what    - the byte to write in the address
+    void write(std::uint16_t where, std::uint8_t what);
 
     //  Name:           read
     //  Description:    reads and returns the byte at the provided address
     //  Arguments:      where   - the address of the byte to write to
     //  Return:         the Byte stored at the provided address
-    std::uint8_t read(std::uint16_t  where);
+    std::uint8_t read(std::uint16_t where) const;
+
+    //  Name:           writeBlock
+    //  Description:    writes the bytes to consecutive addresses, starting at 'where'
+    //  Arguments:      where   - the address of the first byte
+    //                  what    - the bytes to write
+    void writeBlock(std::uint16_t where, std::span<const std::uint8_t> what);
+
+    //  Name:           readBlock
+    //  Description:    reads consecutive addresses starting at 'where', as many as fit in 'to'
+    //  Arguments:      where   - the address of the first byte
+    //                  to      - where to copy the bytes to
+    void readBlock(std::uint16_t where, std::span<std::uint8_t> to) const;
+
+    //  Name:           clear
+    //  Description:    sets every byte to 0
+    void clear();
+
+    //  Name:           view
+    //  Description:    returns the whole memory for bulk operations, these aren't checked by the access policy
+    //  Return:         a span over every byte of the memory
+    std::span<std::uint8_t, Size> view();
+    std::span<const std::uint8_t, Size> view() const;
 
     //  Name:           getSize
     //  Description:    returns the size of the memory
     //  Return:         the size of the memory (in Bytes)
-    std::uint16_t  getSize();
+    static constexpr std::size_t getSize();
 };
 
-#endif
\ No newline at end of file
+#include "template_defs/Memory.tpp"
+
+#endif
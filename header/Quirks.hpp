@@ -0,0 +1,41 @@
+#ifndef QUIRKS_HPP
+#define QUIRKS_HPP
+#include <cstdint>
+
+// The behaviours that differ between CHIP8 implementations, chosen at compile time
+// Every toggle is independent, so any combination can be made, e.g. Quirks::Policy<Quirks::VF_RESET | Quirks::CLIP>
+namespace Quirks
+{
+    enum Flag : std::uint8_t
+    {
+        SHIFT_VY                = 1 << 0,   // 8XY6/8XYE shift VY into VX, instead of shifting VX in place
+        LOAD_STORE_INCREMENT    = 1 << 1,   // FX55/FX65 leave I pointing after the last register
+        JUMP_V0                 = 1 << 2,   // BXNN jumps to XNN + V0, instead of XNN + VX
+        VF_RESET                = 1 << 3,   // 8XY1/8XY2/8XY3 set VF to 0
+        CLIP                    = 1 << 4,   // DXYN cuts sprites off at the edges of the screen, instead of wrapping them
+        SPRITE_16               = 1 << 5,   // DXY0 draws a 16x16 sprite (SUPER-CHIP), instead of nothing
+    };
+
+    // Every flag at once, the flags of any combination are <= this
+    inline constexpr std::uint8_t all_flags{ SHIFT_VY | LOAD_STORE_INCREMENT | JUMP_V0 | VF_RESET | CLIP | SPRITE_16 };
+
+    template <std::uint8_t Flags>
+    struct Policy
+    {
+        static constexpr std::uint8_t flags{ Flags };
+        static constexpr bool shift_vy{ (Flags & SHIFT_VY) != 0 };
+        static constexpr bool load_store_increment{ (Flags & LOAD_STORE_INCREMENT) != 0 };
+        static constexpr bool jump_v0{ (Flags & JUMP_V0) != 0 };
+        static constexpr bool vf_reset{ (Flags & VF_RESET) != 0 };
+        static constexpr bool clip{ (Flags & CLIP) != 0 };
+        static constexpr bool sprite_16{ (Flags & SPRITE_16) != 0 };
+    };
+
+    // Chip8::BehaviourType::CHIP8, the original COSMAC VIP interpreter
+    using Cosmac = Policy<SHIFT_VY | LOAD_STORE_INCREMENT | JUMP_V0 | VF_RESET | CLIP>;
+
+    // Chip8::BehaviourType::SUPERCHIP
+    using SuperChip = Policy<CLIP | SPRITE_16>;
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+#include <array>
+#include <cstdint>
+
+// A random number generator owned by one emulator (xoshiro128**), so emulators on different threads don't share any state
+// and the same seed always gives the same numbers. The whole state is 16 bytes and can be copied, e.g. into a save state
+class Random
+{
+public:
+    typedef std::array<std::uint32_t, 4> State;
+
+    static constexpr std::uint64_t default_seed{ 1 };
+private:
+    State m_state{};
+public:
+    // --- Constructors ---
+
+    //  Description:    creates a generator seeded with default_seed
+    Random();
+
+    //  Description:    creates a seeded generator
+    //  Arguments:      seed - any value, every seed gives different numbers
+    explicit Random(std::uint64_t seed);
+
+    // --- Member functions ---
+
+    //  Name:           next
+    //  Description:    returns the next random number
+    //  Return:         the number, every bit is equally random
+    std::uint32_t next()
+    {
+        std::uint32_t result{ rotate(m_state[1] * 5, 7) * 9 };
+        std::uint32_t shifted{ m_state[1] << 9 };
+        m_state[2] ^= m_state[0];
+        m_state[3] ^= m_state[1];
+        m_state[1] ^= m_state[2];
+        m_state[0] ^= m_state[3];
+        m_state[2] ^= shifted;
+        m_state[3] = rotate(m_state[3], 11);
+        return result;
+    }
+
+    //  Name:           seed
+    //  Description:    starts the numbers over from a seed
+    //  Arguments:      seed - any value, every seed gives different numbers
+    void seed(std::uint64_t seed);
+
+    //  Name:           getState
+    //  Description:    returns the state, to continue from the same number later with setState
+    //  Return:         the state
+    const State& getState() const;
+
+    //  Name:           setState
+    //  Description:    continues from a state returned by getState
+    //  Arguments:      state - the state, all zeros (which would only give zeros) seeds with default_seed instead
+    void setState(const State& state);
+
+private:
+    static constexpr std::uint32_t rotate(std::uint32_t value, int bits)
+    {
+        return (value << bits) | (value >> (32 - bits));
+    }
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef REWIND_HPP
+#define REWIND_HPP
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// A history of snapshots of a fixed size (e.g. Chip8::MachineState) kept in a fixed amount of memory, the newest one comes out first
+// Every snapshot is stored as the XOR with the newest keyframe, run length encoded, so bytes that didn't change take (almost) nothing.
+// A keyframe is encoded the same way against zeros. When the memory runs out, the oldest keyframe is dropped with the snapshots based on it
+class Rewind
+{
+private:
+    std::vector<std::uint8_t> m_data{};         // the records, used as a ring: a header, the encoded snapshot and a trailer (the header again)
+    std::size_t m_head{};                       // where the next record goes
+    std::size_t m_tail{};                       // where the oldest record starts
+    std::size_t m_wrap_end{};                   // where the records before the start of m_data end, only if m_wrapped
+    bool m_wrapped{};                           // the records go past the end of m_data and continue at the start
+    std::size_t m_count{};
+
+    std::size_t m_snapshot_size{};
+    std::uint32_t m_keyframe_interval{};
+    std::uint32_t m_since_keyframe{};           // the amount of records after the newest keyframe
+    std::vector<std::uint8_t> m_keyframe{};     // the newest keyframe, decoded
+    std::vector<std::uint8_t> m_encoded{};      // the record being made
+
+    //  Name:           encode
+    //  Description:    run length encodes the XOR of a snapshot and a base into m_encoded,
+    //                  as (amount of equal bytes, amount of different bytes, the XORed different bytes) until the end
+    //  Arguments:      snapshot - the snapshot to encode
+    //                  base - what to XOR it with, empty for zeros
+    void encode(std::span<const std::uint8_t> snapshot, std::span<const std::uint8_t> base);
+
+    //  Name:           decode
+    //  Description:    XORs an encoded snapshot onto its base
+    //  Arguments:      encoded - what encode made
+    //                  to - the base, it becomes the snapshot
+    static void decode(std::span<const std::uint8_t> encoded, std::span<std::uint8_t> to);
+
+    //  Name:           readHeader
+    //  Description:    reads the header (or trailer) of a record
+    //  Arguments:      at - where the header starts
+    //                  size - set to the size of the encoded snapshot
+    //  Return:         whether the record is a keyframe
+    bool readHeader(std::size_t at, std::size_t& size) const;
+
+    //  Name:           previousRecord
+    //  Description:    finds the record right before the one at 'at' (or before m_head)
+    //  Arguments:      at - the start of a record, or m_head
+    //  Return:         the start of the record before it
+    std::size_t previousRecord(std::size_t at) const;
+
+    //  Name:           dropOldest
+    //  Description:    drops the oldest keyframe and the records based on it
+    void dropOldest();
+
+public:
+    // --- Constructors ---
+
+    //  Description:    creates an empty history that can't hold anything, use the other constructor to make a usable one
+    Rewind();
+
+    //  Description:    creates an empty history
+    //  Arguments:      budget - the most memory the records can take (in bytes)
+    //                  snapshot_size - the size of every snapshot
+    //                  keyframe_interval - how many snapshots make up a keyframe and the ones based on it
+    Rewind(std::size_t budget, std::size_t snapshot_size, std::uint32_t keyframe_interval);
+
+    // --- Member functions ---
+
+    //  Name:           push
+    //  Description:    adds a snapshot to the history, dropping the oldest ones if they don't fit
+    //  Arguments:      snapshot - the snapshot, its size has to be the snapshot_size of the constructor
+    //  Return:         false if it didn't fit even in an empty history (or the history can't hold anything)
+    bool push(std::span<const std::uint8_t> snapshot);
+
+    //  Name:           pop
+    //  Description:    takes the newest snapshot out of the history
+    //  Arguments:      snapshot - set to the snapshot, its size has to be the snapshot_size of the constructor
+    //  Return:         false if the history is empty
+    bool pop(std::span<std::uint8_t> snapshot);
+
+    //  Name:           clear
+    //  Description:    drops every snapshot
+    void clear();
+
+    //  Name:           getCount
+    //  Description:    returns how many snapshots the history has
+    //  Return:         the amount of snapshots
+    std::size_t getCount() const;
+
+    //  Name:           getUsed
+    //  Description:    returns how much of the budget the records take
+    //  Return:         the amount of bytes
+    std::size_t getUsed() const;
+
+    //  Name:           isEnabled
+    //  Description:    returns whether the history can hold anything
+    //  Return:         false if it was made without a budget
+    bool isEnabled() const;
+};
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef SAVEFILE_HPP
+#define SAVEFILE_HPP
+#include <cstdint>
+#include <string>
+#include "Chip8.hpp"
+
+// Save states on disk
+// A file is a SaveFile::Header followed by sections, every section is a SaveFile::SectionHeader followed by its data,
+// padded to 8 bytes. Readers skip the sections they don't know and only read the part they know of longer ones,
+// so files from newer versions with the same major version still load. Everything is little endian.
+namespace SaveFile
+{
+    //  Name:           fourCC
+    //  Description:    packs 4 characters into an id, so they read as text in a hex dump
+    //  Arguments:      text - the 4 characters
+    //  Return:         the id
+    constexpr std::uint32_t fourCC(const char (&text)[5])
+    {
+        return std::uint32_t(std::uint8_t(text[0])) | std::uint32_t(std::uint8_t(text[1])) << 8 |
+               std::uint32_t(std::uint8_t(text[2])) << 16 | std::uint32_t(std::uint8_t(text[3])) << 24;
+    }
+
+    inline constexpr std::uint32_t magic{ fourCC("C8ST") };
+    inline constexpr std::uint16_t version_major{ 1 };    // changes when older readers can't read the files anymore
+    inline constexpr std::uint16_t version_minor{ 1 };    // changes when sections are added or grow
+
+    struct Header
+    {
+        std::uint32_t magic{ SaveFile::magic };
+        std::uint16_t version_major{ SaveFile::version_major };
+        std::uint16_t version_minor{ SaveFile::version_minor };
+        std::uint32_t header_size{ sizeof(Header) };    // where the first section starts
+        std::uint32_t section_count{};
+        std::uint64_t rom_hash{};                       // see Chip8::getRomHash
+        std::uint8_t quirks{};                          // the Quirks::Flag bits
+        std::uint8_t behaviour{};                       // Chip8::BehaviourType
+        std::uint8_t timer_mode{};                      // Timer::Mode
+        std::uint8_t reserved[5]{};
+    };
+
+    struct SectionHeader
+    {
+        std::uint32_t id{};
+        std::uint32_t size{};                           // the size of the data, without the padding
+    };
+
+    // The sections, the data of each one is the struct named after it (or the memory itself for MEMORY)
+    enum SectionId : std::uint32_t
+    {
+        MEMORY  = fourCC("MEM "),
+        CPU     = fourCC("CPU "),
+        TIMING  = fourCC("TIME"),
+        KEYS    = fourCC("KEYS"),
+        DISPLAY = fourCC("DISP"),
+        RANDOM  = fourCC("RNG "),   // since 1.1, older files start from Random::default_seed
+    };
+
+    struct CpuSection
+    {
+        std::uint16_t PC{};
+        std::uint16_t I{};
+        std::uint8_t regs[Chip8Const::reg_amount]{};
+        std::uint8_t stack_depth{};
+        std::uint8_t reserved{};
+        std::uint16_t stack[Chip8Const::stack_size]{};  // bottom first
+    };
+
+    struct TimingSection
+    {
+        std::uint8_t delay_timer{};
+        std::uint8_t sound_timer{};
+        std::uint8_t reserved[2]{};
+        std::uint32_t instructions_per_frame{};
+        std::uint32_t cycles_per_audio_buffer{};
+        std::uint32_t reserved2{};
+        std::uint64_t cycles{};
+        std::uint64_t next_frame{};
+        std::uint64_t next_audio{};
+    };
+
+    struct KeysSection
+    {
+        std::uint8_t states[Chip8Const::buttons]{};     // Chip8::KeyState
+    };
+
+    // Followed by 'height' rows of 'words_per_row' words, packed like Display::Row
+    struct DisplaySection
+    {
+        std::uint16_t width{};
+        std::uint16_t height{};
+        std::uint16_t words_per_row{};
+        std::uint16_t reserved{};
+    };
+
+    struct RandomSection
+    {
+        std::uint64_t seed{};                           // see Chip8::setSeed
+        std::uint32_t state[4]{};                       // Random::State
+    };
+
+    //  Name:           write
+    //  Description:    writes a state to a file with a single write, replacing the file only once it was written completely
+    //  Arguments:      path - the path of the file
+    //                  state - the state to write
+    //  Return:         true if it was written, false otherwise
+    bool write(const std::string& path, const Chip8::MachineState& state);
+
+    //  Name:           read
+    //  Description:    reads a state from a file, the file is mapped to memory (where supported) and read from there directly
+    //  Arguments:      path - the path of the file
+    //                  state - where to read the state to, left unchanged if the file can't be read
+    //  Return:         true if it was read, false if it's missing, invalid or from an incompatible version
+    bool read(const std::string& path, Chip8::MachineState& state);
+
+    //  Name:           getSlotPath
+    //  Description:    returns the path of a numbered save slot, the slots are stored next to the ROM
+    //  Arguments:      rom_path - the path of the ROM
+    //                  slot - the number of the slot
+    //  Return:         the path of the slot's file
+    std::string getSlotPath(const std::string& rom_path, unsigned slot);
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef STACK_HPP
+#define STACK_HPP
+#include <array>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+
+// A call stack of return addresses which can hold up to Capacity of them, without allocating
+template <std::size_t Capacity>
+class Stack
+{
+    static_assert(Capacity > 0 && Capacity <= 0xFF, "The depth is kept in a byte");
+
+private:
+    std::array<std::uint16_t, Capacity> m_data{};
+    std::uint8_t m_depth{};
+public:
+    // --- Member functions ---
+
+    //  Name:           push
+    //  Description:    puts an address on top of the stack, unless it's full
+    //  Arguments:      address - the address to push
+    //  Return:         false if the stack was full (overflow), true otherwise
+    bool push(std::uint16_t address);
+
+    //  Name:           pop
+    //  Description:    takes the address on top of the stack, unless it's empty
+    //  Arguments:      address - set to the popped address
+    //  Return:         false if the stack was empty (underflow), true otherwise
+    bool pop(std::uint16_t& address);
+
+    //  Name:           getDepth
+    //  Description:    returns how many addresses are on the stack
+    //  Return:         the amount of addresses
+    std::size_t getDepth() const;
+
+    //  Name:           view
+    //  Description:    returns the addresses on the stack, the bottom one first and the top one last
+    //  Return:         a span over the addresses
+    std::span<const std::uint16_t> view() const;
+
+    //  Name:           getCapacity
+    //  Description:    returns the maximum amount of addresses
+    //  Return:         the capacity of the stack
+    static constexpr std::size_t getCapacity();
+};
+
+#include "template_defs/Stack.tpp"
+
+#endif
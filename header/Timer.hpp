@@ -5,18 +5,39 @@
 
 class Timer
 {
+public:
+    // What makes the value go down
+    enum class Mode
+    {
+        WALL_CLOCK,     // 60 times a second of real time
+        VIRTUAL,        // only Timer::tick, so the owner decides when a 1/60 of a second passed (e.g. by counting instructions)
+    };
+
 private:
+    Mode m_mode{ Mode::WALL_CLOCK };
     std::uint8_t m_start_val{};
     std::uint8_t m_value{};
     std::int64_t m_time_started{};
 
 public:
-    Timer();
+    Timer(Mode mode = Mode::WALL_CLOCK);
     void set(std::uint8_t  value);
     void update();
     std::uint8_t  get();
+    std::int64_t getTimeUntilTick();
+
+    //  Name:           tick
+    //  Description:    makes the value go down as if 'ticks' 1/60 of a second passed, only for Mode::VIRTUAL
+    //  Arguments:      ticks - how many times the value goes down (it stops at 0)
+    void tick(std::uint64_t ticks = 1);
+
+    //  Name:           setMode
+    //  Description:    switches what makes the value go down, keeping the current value
+    //  Arguments:      mode - the new mode
+    void setMode(Mode mode);
+    Mode getMode();
 
     static std::int64_t getTime();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -1,28 +1,36 @@
 #ifndef VARREGS_HPP
 #define VARREGS_HPP
+#include <array>
 #include <cstdint>
-#include <vector>
+#include "Chip8Common.hpp"
 
 class VarRegs
 {
 private:
-    std::vector<std::uint8_t> m_regs{};
+    std::array<std::uint8_t, Chip8Const::reg_amount> m_regs{};
 public:
-    //  Description:    VarRegs class constructor, creates a new VarRegs object which can hold up to 'amount' registers
-    //  Arguments:      amount - the amount of regs that VarRegs can hold    
-    VarRegs(std::uint8_t amount);
-
     //  Name:           read
     //  Description:    returns the value of the register at 'which'
-    //  Arguments:      which - the index of the register
+    //  Arguments:      which - the index of the register, only the low nibble is used so it can't be out of bounds
     //  Return:         the value of the register at 'which'
-    std::uint8_t read(std::uint8_t  which);
+    std::uint8_t read(std::uint8_t which) const
+    {
+        return m_regs[which & (Chip8Const::reg_amount - 1)];
+    }
 
     //  Name:           write
     //  Description:    writes 'value' to the register at 'which'
-    //  Arguments:      which - the index of the register
+    //  Arguments:      which - the index of the register, only the low nibble is used so it can't be out of bounds
     //                  value - the value to write to the register
-    void write(std::uint8_t which, std::uint8_t value);
+    void write(std::uint8_t which, std::uint8_t value)
+    {
+        m_regs[which & (Chip8Const::reg_amount - 1)] = value;
+    }
+
+    //  Name:           data
+    //  Description:    returns a pointer to the first register, the rest follow it
+    //  Return:         the pointer to the registers
+    std::uint8_t* data();
 };
 
-#endif
\ No newline at end of file
+#endif
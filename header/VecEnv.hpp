@@ -0,0 +1,252 @@
+#ifndef VECENV_HPP
+#define VECENV_HPP
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Chip8.hpp"
+
+// Many environments of the same ROM for reinforcement learning, every one a Chip8 with virtual timers.
+// A step presses the keys of an action in every environment, runs a few frames and writes the display, the reward and
+// whether the episode ended straight into arrays the caller owns, nothing is allocated after the constructor.
+// The rewards and the ends of episodes are read from the memory of the ROM (see Spec). An environment whose episode ended
+// starts over from a snapshot, the state right after loading the ROM unless another one is set.
+// The environments are split between a pool of threads, each environment gives the same results whichever thread runs it.
+class VecEnv
+{
+public:
+    // How the display is written to the observations
+    enum class Observation
+    {
+        PACKED,     // a bit per pixel, 8 pixels a byte, the leftmost pixel is the highest bit (like the sprites)
+        UNPACKED    // a byte per pixel, 1 if it's on, 0 otherwise
+    };
+
+    // A number in the memory of the ROM, the reward is how much it changed times 'scale'
+    struct RewardTerm
+    {
+        Chip8_t::Word address{};
+        Chip8_t::Byte bytes{ 1 };   // 1 - 4 bytes, big endian
+        bool bcd{};                 // a decimal digit per byte, like FX33 stores them
+        float scale{ 1 };
+    };
+
+    // The episode ends when (memory[address] & mask) == value, or != value if 'equal' is false
+    struct DoneCondition
+    {
+        Chip8_t::Word address{};
+        Chip8_t::Byte mask{ 0xFF };
+        Chip8_t::Byte value{};
+        bool equal{ true };
+    };
+
+    // What the rewards and the ends of episodes of a ROM are, see readSpec. An episode also ends when the ROM can't go on
+    // (a stack overflow or underflow)
+    struct Spec
+    {
+        std::vector<RewardTerm> rewards{};
+        std::vector<DoneCondition> done{};
+        std::uint64_t max_frames{};     // an episode ends after this many frames, 0 for no limit
+    };
+
+    struct Options
+    {
+        std::size_t environments{ 1 };
+        std::size_t threads{ 1 };                                   // including the caller's, 0 for one per core
+        std::uint32_t frame_skip{ 4 };                              // the frames a step runs with the same keys
+        std::uint32_t instructions_per_frame{ 11 };
+        Chip8::BehaviourType behaviour{ Chip8::BehaviourType::CHIP8 };
+        Chip8::Backend backend{ Chip8::Backend::INTERPRETER };
+        Observation observation{ Observation::PACKED };
+        bool auto_reset{ true };                                    // start over right away when an episode ends, otherwise it's done until reset
+        std::uint64_t seed{ Random::default_seed };                 // episode N of environment E gets seed + E + N * environments
+    };
+
+    // The bytes of the observation of a single environment
+    static constexpr std::size_t packed_size{ Chip8Const::screen_width / 8 * Chip8Const::screen_height };
+    static constexpr std::size_t unpacked_size{ (std::size_t)Chip8Const::screen_width * Chip8Const::screen_height };
+
+    // The most reward terms a spec can have, their last values are kept without allocating
+    static constexpr std::size_t max_reward_terms{ 8 };
+
+private:
+    struct Environment
+    {
+        std::unique_ptr<Chip8> emulator{};
+        std::uint16_t held{};                                       // bit K is set while key K is held
+        std::uint64_t frames{};                                     // frames since the episode started
+        std::uint64_t episodes{};                                   // episodes started
+        std::array<std::int64_t, max_reward_terms> values{};        // the reward terms at the end of the last step
+    };
+
+    // What the threads are doing right now
+    enum class Job
+    {
+        STEP,
+        RESET
+    };
+
+    Options m_options{};
+    Spec m_spec{};
+    std::vector<Environment> m_environments{};
+    std::unique_ptr<Chip8::MachineState> m_reset_state{};
+
+    // The arguments of the job being done
+    Job m_job{ Job::STEP };
+    std::span<const std::uint16_t> m_actions{};
+    std::span<std::uint8_t> m_observations{};
+    std::span<float> m_rewards{};
+    std::span<std::uint8_t> m_dones{};
+
+    // The pool, the caller works too, so there is one thread less than Options::threads
+    std::vector<std::thread> m_workers{};
+    std::mutex m_mutex{};
+    std::condition_variable m_start{};
+    std::condition_variable m_finished{};
+    std::uint64_t m_generation{};           // increased for every job, the workers wait for it to change
+    std::size_t m_busy{};                   // the workers still doing the job
+    bool m_quit{};
+    std::atomic<std::size_t> m_next_environment{};
+    std::size_t m_chunk{ 1 };               // the environments taken from m_next_environment at once
+
+    //  Name:           readTerm
+    //  Description:    reads the number of a reward term from the memory of an environment
+    //  Arguments:      emulator - the environment
+    //                  term - the reward term
+    //  Return:         the number
+    static std::int64_t readTerm(Chip8& emulator, const RewardTerm& term);
+
+    //  Name:           isDone
+    //  Description:    checks if the episode of an environment ended
+    //  Arguments:      environment - the environment
+    //  Return:         true if it did
+    bool isDone(Environment& environment) const;
+
+    //  Name:           resetEnvironment
+    //  Description:    starts a new episode in an environment from the reset snapshot
+    //  Arguments:      index - the index of the environment
+    void resetEnvironment(std::size_t index);
+
+    //  Name:           stepEnvironment
+    //  Description:    presses the keys of an action and runs the frames of a step in an environment
+    //  Arguments:      index - the index of the environment
+    //                  action - bit K is set to hold key K
+    //                  reward - set to the reward of the step
+    //  Return:         whether the episode ended
+    bool stepEnvironment(std::size_t index, std::uint16_t action, float& reward);
+
+    //  Name:           writeObservation
+    //  Description:    writes the display of an environment to its part of m_observations
+    //  Arguments:      index - the index of the environment
+    void writeObservation(std::size_t index);
+
+    //  Name:           saveResetState
+    //  Description:    makes the state of the first environment, right after loading a ROM, the reset snapshot
+    void saveResetState();
+
+    //  Name:           doJob
+    //  Description:    takes environments from m_next_environment and does m_job for them until there are none left
+    void doJob();
+
+    //  Name:           runJob
+    //  Description:    does m_job for every environment on every thread and waits for it to finish
+    void runJob();
+
+    //  Name:           work
+    //  Description:    the loop of a worker thread, waits for jobs until m_quit is set
+    void work();
+
+    //  Name:           checkBuffers
+    //  Description:    checks a ROM was loaded and the arrays passed to step or reset are big enough, reporting the first problem
+    //  Arguments:      observations - the observations
+    //                  actions, rewards, dones - the sizes of the other arrays
+    //  Return:         true if everything is fine
+    bool checkBuffers(std::span<std::uint8_t> observations, std::size_t actions, std::size_t rewards, std::size_t dones) const;
+
+public:
+    // --- Constructors ---
+
+    //  Description:    creates the environments and starts the threads, a ROM has to be loaded before the first step
+    //  Arguments:      options - how many environments there are and how they run
+    //                  spec - the rewards and the ends of episodes, at most max_reward_terms reward terms are used
+    VecEnv(const Options& options, const Spec& spec);
+
+    VecEnv(const VecEnv&) = delete;
+    VecEnv& operator=(const VecEnv&) = delete;
+
+    //  Description:    stops the threads
+    ~VecEnv();
+
+    // --- Member functions ---
+
+    //  Name:           readSpec
+    //  Description:    reads a spec file, reporting the first invalid line. A line is one of ('#' starts a comment,
+    //                  numbers can be hex with 0x):
+    //                    reward <address> [bytes <1-4>] [bcd] [scale <x>]
+    //                    done <address> <eq|ne> <value> [mask <m>]
+    //                    max_frames <n>
+    //  Arguments:      path - the path to the file
+    //                  spec - the terms and conditions are added to it
+    //  Return:         true if the whole file was read, false otherwise
+    static bool readSpec(const std::string& path, Spec& spec);
+
+    //  Name:           getObservationSize
+    //  Description:    returns the bytes of the observation of a single environment
+    //  Return:         packed_size or unpacked_size
+    std::size_t getObservationSize() const;
+
+    //  Name:           getEnvironmentCount
+    //  Description:    returns the amount of environments
+    //  Return:         the amount of environments
+    std::size_t getEnvironmentCount() const;
+
+    //  Name:           loadMemory
+    //  Description:    loads a ROM into every environment, the state right after becomes the reset snapshot
+    //  Arguments:      path - the path to the ROM
+    //  Return:         true if the ROM was loaded, false otherwise
+    bool loadMemory(const std::string& path);
+
+    //  Name:           loadMemory
+    //  Description:    same as above with the contents of the ROM
+    //  Arguments:      rom - the contents of a CHIP8 rom file
+    void loadMemory(std::span<const Chip8_t::Byte> rom);
+
+    //  Name:           setResetState
+    //  Description:    sets the snapshot every episode starts from (e.g. saved after the title screen)
+    //  Arguments:      state - the snapshot, the quirks and the instructions per frame in it are used too (a frame of a step
+    //                  is as long as the environment's frame)
+    void setResetState(const Chip8::MachineState& state);
+
+    //  Name:           reset
+    //  Description:    starts a new episode in every environment
+    //  Arguments:      observations - getObservationSize() bytes per environment, one after another
+    //  Return:         false if the array is too small
+    bool reset(std::span<std::uint8_t> observations);
+
+    //  Name:           step
+    //  Description:    holds the keys of an action for Options::frame_skip frames in every environment, an action that
+    //                  lets go of a key makes it JUST_RELEASED for a frame. With Options::auto_reset an environment whose episode
+    //                  ended starts the next one and its observation is the first one of the new episode
+    //  Arguments:      actions - an action per environment, bit K is set to hold key K
+    //                  observations - getObservationSize() bytes per environment, one after another
+    //                  rewards - set to the reward of every environment
+    //                  dones - set to 1 for the environments whose episode ended, 0 for the rest
+    //  Return:         false if an array is too small
+    bool step(std::span<const std::uint16_t> actions, std::span<std::uint8_t> observations,
+              std::span<float> rewards, std::span<std::uint8_t> dones);
+
+    //  Name:           getEmulator
+    //  Description:    returns the emulator of an environment, e.g. to save its state
+    //  Arguments:      index - the index of the environment
+    //  Return:         the emulator
+    Chip8& getEmulator(std::size_t index);
+};
+
+#endif
@@ -0,0 +1,194 @@
+#include "./../Chip8.hpp"
+
+#include <iostream>
+
+// ---- Emulator functions ----
+
+// 8XY1 -   set VX to bitwise OR of VX and VY
+template <typename Quirks>
+void Chip8::_8XY1(const DecodedOp& op)
+{
+    Chip8_t::Byte vx{ m_regs.read(op.x) };
+    Chip8_t::Byte vy{ m_regs.read(op.y) };
+    m_regs.write(op.x, vx | vy);
+
+    if constexpr(Quirks::vf_reset)
+    {
+        m_regs.write(0xF, 0);
+    }
+}
+
+// 8XY2 -   set VX to bitwise AND of VX and VY
+template <typename Quirks>
+void Chip8::_8XY2(const DecodedOp& op)
+{
+    Chip8_t::Byte vx{ m_regs.read(op.x) };
+    Chip8_t::Byte vy{ m_regs.read(op.y) };
+    m_regs.write(op.x, vx & vy);
+
+    if constexpr(Quirks::vf_reset)
+    {
+        m_regs.write(0xF, 0);
+    }
+}
+
+// 8XY3 -   set VX to bitwise XOR of VX and VY
+template <typename Quirks>
+void Chip8::_8XY3(const DecodedOp& op)
+{
+    Chip8_t::Byte vx{ m_regs.read(op.x) };
+    Chip8_t::Byte vy{ m_regs.read(op.y) };
+    m_regs.write(op.x, vx ^ vy);
+
+    if constexpr(Quirks::vf_reset)
+    {
+        m_regs.write(0xF, 0);
+    }
+}
+
+// 8XY6 -   
+// Beh1:    set VX to VY
+// Beh2:    ignore VY
+// Then:    Shift VX one bit to the right, set VF to 1 if the bit shifted out was 1, or 0 if was 0
+template <typename Quirks>
+void Chip8::_8XY6(const DecodedOp& op)
+{
+    Chip8_t::Byte vx{ m_regs.read(op.x) };
+    if constexpr(Quirks::shift_vy)
+    {
+        vx = m_regs.read(op.y);
+    }
+
+    m_regs.write(op.x, vx >> 1);
+    m_regs.write(0xF, vx & 0b00000001);
+}
+
+// 8XYE -   
+// Beh1:    set VX to VY
+// Beh2:    ignore VY
+// Then:    Shift VX one bit to the left, set VF to 1 if the bit shifted out was 1, or 0 if was 0
+template <typename Quirks>
+void Chip8::_8XYE(const DecodedOp& op)
+{
+    Chip8_t::Byte vx{ m_regs.read(op.x) };
+    if constexpr(Quirks::shift_vy)
+    {
+        vx = m_regs.read(op.y);
+    }
+
+    m_regs.write(op.x, vx << 1);
+    m_regs.write(0xF, (vx & 0b10000000) > 0);
+}
+
+// Legacy:
+// BXNN - Jump to XNN plus the value in V0
+// New:
+// BXNN - Jump to XNN plus the value in register VX
+template <typename Quirks>
+void Chip8::_BXNN(const DecodedOp& op)
+{
+    // Convert XNN to a single number
+    Chip8_t::Word dest{ op.nnn};
+    
+    // Add the appropriate register
+    if constexpr(Quirks::jump_v0)
+    {
+        dest += m_regs.read(0x0);
+    }
+    else
+    {
+        dest += m_regs.read(op.x);
+    }
+    
+    // Jump to it
+    jumpTo(dest);
+}
+
+// 0xDXYN - Draw a N height sprite to the screen at coordinates (VX, VY) from the location of the I registed
+//          if any of the pixels were flipped as a result of this set VF to 1, otherwise it's set to 0
+//          without the clip quirk the parts of the sprite that go off screen wrap around to the other side
+//          with the sprite_16 quirk DXY0 draws a 16x16 sprite, two bytes per row
+template <typename Quirks>
+void Chip8::_DXYN(const DecodedOp& op)
+{
+    Chip8_t::Byte x{ (Chip8_t::Byte)(m_regs.read(op.x) % Chip8Const::screen_width) };
+    Chip8_t::Byte y{ (Chip8_t::Byte)(m_regs.read(op.y) % Chip8Const::screen_height) };
+    bool wide{ Quirks::sprite_16 && op.n == 0 };
+    std::size_t bytes{ wide ? 32u : op.n };
+
+    // Fetch the whole sprite at once and draw it
+    std::array<Chip8_t::Byte, 32> sprite{};
+    m_memory.readBlock(m_I, std::span<Chip8_t::Byte>{ sprite.data(), bytes });
+    bool collision{ m_display.drawSprite(x, y, std::span<const Chip8_t::Byte>{ sprite.data(), bytes }, wide, Quirks::clip) };
+
+    // Set VF register
+    m_regs.write(0xF, collision ? 1 : 0);
+}
+
+// FX55 - Set memory in I, to I+X with the values of V0 to VX
+template <typename Quirks>
+void Chip8::_FX55(const DecodedOp& op)
+{
+    writeMemory(m_I, std::span<const Chip8_t::Byte>{ m_regs.data(), (std::size_t)op.x + 1 });
+
+    if constexpr(Quirks::load_store_increment)
+    {
+        m_I += op.x + 1;
+    }
+}
+
+// FX65 - Set V0 to VX, with the value from memory of I to I+X
+template <typename Quirks>
+void Chip8::_FX65(const DecodedOp& op)
+{
+    m_memory.readBlock(m_I, std::span<Chip8_t::Byte>{ m_regs.data(), (std::size_t)op.x + 1 });
+
+    if constexpr(Quirks::load_store_increment)
+    {
+        m_I += op.x + 1;
+    }
+}
+
+// --- Private member functions ---
+
+template <typename Quirks>
+const Chip8::DispatchTable& Chip8::getDispatchTable()
+{
+    static const DispatchTable table{ []()
+    {
+        // Decoding doesn't depend on the quirks, only the functions executing some of the instructions do
+        DispatchTable result{ getDecodeTable() };
+        for(DecodedOp& op : result)
+        {
+            switch(op.type)
+            {
+                case OpType::_8XY1: op.handler = &Chip8::_8XY1<Quirks>; break;
+                case OpType::_8XY2: op.handler = &Chip8::_8XY2<Quirks>; break;
+                case OpType::_8XY3: op.handler = &Chip8::_8XY3<Quirks>; break;
+                case OpType::_8XY6: op.handler = &Chip8::_8XY6<Quirks>; break;
+                case OpType::_8XYE: op.handler = &Chip8::_8XYE<Quirks>; break;
+                case OpType::_BXNN: op.handler = &Chip8::_BXNN<Quirks>; break;
+                case OpType::_DXYN: op.handler = &Chip8::_DXYN<Quirks>; break;
+                case OpType::_FX55: op.handler = &Chip8::_FX55<Quirks>; break;
+                case OpType::_FX65: op.handler = &Chip8::_FX65<Quirks>; break;
+                default: break;
+            }
+        }
+
+        return result;
+    }() };
+
+    return table;
+}
+
+// --- Member functions ---
+
+template <typename Quirks>
+void Chip8::setQuirks()
+{
+    m_quirks = Quirks::flags;
+    m_dispatch = getDispatchTable<Quirks>().data();
+
+    // Everything decoded so far points into the old table, and the JIT bakes the quirks into the compiled blocks
+    invalidateDecodeCache();
+}
@@ -1,34 +1,30 @@
 #include "./../Instruction.hpp"
 
-#include <sstream>
+#include <iostream>
 
 template <typename Instr_t>
-Instruction<Instr_t>::Instruction(const Instr_t& instruction) : m_instruction{instruction} {}
+constexpr Instruction<Instr_t>::Instruction(const Instr_t& instruction) : m_instruction{instruction} {}
 
 template <typename Instr_t>
-Instruction<Instr_t>::Instruction(const std::array<std::uint8_t, sizeof(Instr_t) * 2>& nibbles) : m_instruction{}
+constexpr Instruction<Instr_t>::Instruction(const std::array<std::uint8_t, sizeof(Instr_t) * 2>& nibbles) : m_instruction{}
 {
-    std::uint64_t current_multiplier{ 1 };
-    for(int i{ (int)nibbles.size() - 1 }; i >= 0; --i)
+    for(std::uint8_t nibble : nibbles)
     {
-        m_instruction += nibbles[i] * current_multiplier;
-        current_multiplier *= 0x10;
+        m_instruction = (Instr_t)((std::uint64_t(m_instruction) << 4) | (nibble & 0xF));
     }
 }
 
 template <typename Instr_t>
-Instruction<Instr_t>::Instruction(const std::array<std::uint8_t, sizeof(Instr_t)>& bytes) : m_instruction{}
+constexpr Instruction<Instr_t>::Instruction(const std::array<std::uint8_t, sizeof(Instr_t)>& bytes) : m_instruction{}
 {
-    std::uint64_t current_multiplier{ 1 };
-    for(int i{ (int)bytes.size() - 1 }; i >= 0; --i)
+    for(std::uint8_t byte : bytes)
     {
-        m_instruction += bytes[i] * current_multiplier;
-        current_multiplier *= 0x100;
+        m_instruction = (Instr_t)((std::uint64_t(m_instruction) << 8) | byte);
     }
 }
 
 template <typename Instr_t>
-std::uint16_t Instruction<Instr_t>::getAmountOfNibbles() const
+constexpr std::uint16_t Instruction<Instr_t>::getAmountOfNibbles()
 {
     // sizeof(Instr_t) * 8 - size in bits
     // so, sizeof(Instr_t) * 2 - amount of nibbles
@@ -62,20 +58,73 @@ Instr_t Instruction<Instr_t>::getNibbles(const std::uint16_t& from, const std::u
         return 0;
     }
 
-    std::stringstream ss{};
-    ss << std::hex;
-    for(std::uint16_t i{from}; i <= to; ++i)
-    {
-        ss << (unsigned int)getNibble(i);
-    }
+    // Shift the last wanted nibble to the bottom and cut off everything above the first one
+    std::uint16_t shift = (amount - 1 - to) * 4;
+    std::uint16_t bits = (to - from + 1) * 4;
+    std::uint64_t mask{ bits >= 64 ? ~std::uint64_t{} : (std::uint64_t{1} << bits) - 1 };
+    return (Instr_t)((std::uint64_t(m_instruction) >> shift) & mask);
+}
+
+template <typename Instr_t>
+template <std::uint16_t which>
+constexpr std::uint8_t Instruction<Instr_t>::getNibble() const
+{
+    static_assert(which < getAmountOfNibbles(), "Attempted to grab invalid nibble!");
+
+    return (std::uint64_t(m_instruction) >> ((getAmountOfNibbles() - 1 - which) * 4)) & 0xF;
+}
+
+template <typename Instr_t>
+template <std::uint16_t from, std::uint16_t to>
+constexpr Instr_t Instruction<Instr_t>::getNibbles() const
+{
+    static_assert(from <= to, "Attempted to grab nibbles where 'from' > 'to'!");
+    static_assert(to < getAmountOfNibbles(), "Attempted to grab invalid nibbles!");
+
+    constexpr std::uint16_t shift{ (std::uint16_t)((getAmountOfNibbles() - 1 - to) * 4) };
+    constexpr std::uint16_t bits{ (std::uint16_t)((to - from + 1) * 4) };
+    constexpr std::uint64_t mask{ bits >= 64 ? ~std::uint64_t{} : (std::uint64_t{1} << bits) - 1 };
+    return (Instr_t)((std::uint64_t(m_instruction) >> shift) & mask);
+}
+
+template <typename Instr_t>
+constexpr std::uint8_t Instruction<Instr_t>::getOpClass() const
+{
+    return getNibble<0>();
+}
+
+template <typename Instr_t>
+constexpr std::uint8_t Instruction<Instr_t>::getX() const
+{
+    return getNibble<1>();
+}
+
+template <typename Instr_t>
+constexpr std::uint8_t Instruction<Instr_t>::getY() const
+{
+    return getNibble<2>();
+}
+
+template <typename Instr_t>
+constexpr std::uint8_t Instruction<Instr_t>::getN() const
+{
+    return getNibble<3>();
+}
 
-    std::uint64_t ret{};
-    ss >> ret;
-    return ret;
+template <typename Instr_t>
+constexpr std::uint8_t Instruction<Instr_t>::getNN() const
+{
+    return (std::uint8_t)getNibbles<2, 3>();
 }
 
 template <typename Instr_t>
-Instr_t Instruction<Instr_t>::get() const
+constexpr std::uint16_t Instruction<Instr_t>::getNNN() const
+{
+    return (std::uint16_t)getNibbles<1, 3>();
+}
+
+template <typename Instr_t>
+constexpr Instr_t Instruction<Instr_t>::get() const
 {
     return m_instruction;
-}
\ No newline at end of file
+}
@@ -0,0 +1,124 @@
+#include "./../Memory.hpp"
+
+#include <algorithm>
+
+template <std::size_t Size, typename Access>
+void Memory<Size, Access>::write(std::uint16_t where, std::uint8_t what)
+{
+    if constexpr(std::is_same_v<Access, MemoryAccess::Masked>)
+    {
+        where &= Size - 1;
+    }
+    else if constexpr(std::is_same_v<Access, MemoryAccess::Checked>)
+    {
+        if(where >= Size)
+        {
+            MemoryAccess::reportOutOfBounds(true, Size, where, 1);
+            return;
+        }
+    }
+
+    m_data[where] = what;
+}
+
+template <std::size_t Size, typename Access>
+std::uint8_t Memory<Size, Access>::read(std::uint16_t where) const
+{
+    if constexpr(std::is_same_v<Access, MemoryAccess::Masked>)
+    {
+        where &= Size - 1;
+    }
+    else if constexpr(std::is_same_v<Access, MemoryAccess::Checked>)
+    {
+        if(where >= Size)
+        {
+            MemoryAccess::reportOutOfBounds(false, Size, where, 1);
+            return 0;
+        }
+    }
+
+    return m_data[where];
+}
+
+template <std::size_t Size, typename Access>
+void Memory<Size, Access>::writeBlock(std::uint16_t where, std::span<const std::uint8_t> what)
+{
+    std::size_t start{ where };
+    if constexpr(std::is_same_v<Access, MemoryAccess::Masked>)
+    {
+        // Split the copy where it wraps around, 'what' could even be longer than the memory
+        start &= Size - 1;
+        while(!what.empty())
+        {
+            std::size_t count{ std::min(what.size(), Size - start) };
+            std::copy_n(what.data(), count, m_data.data() + start);
+            what = what.subspan(count);
+            start = 0;
+        }
+        return;
+    }
+    else if constexpr(std::is_same_v<Access, MemoryAccess::Checked>)
+    {
+        if(start + what.size() > Size)
+        {
+            MemoryAccess::reportOutOfBounds(true, Size, start, what.size());
+            what = what.first(start < Size ? Size - start : 0);
+        }
+    }
+
+    std::copy(what.begin(), what.end(), m_data.begin() + start);
+}
+
+template <std::size_t Size, typename Access>
+void Memory<Size, Access>::readBlock(std::uint16_t where, std::span<std::uint8_t> to) const
+{
+    std::size_t start{ where };
+    if constexpr(std::is_same_v<Access, MemoryAccess::Masked>)
+    {
+        start &= Size - 1;
+        while(!to.empty())
+        {
+            std::size_t count{ std::min(to.size(), Size - start) };
+            std::copy_n(m_data.data() + start, count, to.data());
+            to = to.subspan(count);
+            start = 0;
+        }
+        return;
+    }
+    else if constexpr(std::is_same_v<Access, MemoryAccess::Checked>)
+    {
+        if(start + to.size() > Size)
+        {
+            MemoryAccess::reportOutOfBounds(false, Size, start, to.size());
+            std::size_t in_bounds{ start < Size ? Size - start : 0 };
+            std::fill(to.begin() + in_bounds, to.end(), 0);
+            to = to.first(in_bounds);
+        }
+    }
+
+    std::copy_n(m_data.begin() + start, to.size(), to.begin());
+}
+
+template <std::size_t Size, typename Access>
+void Memory<Size, Access>::clear()
+{
+    m_data.fill(0);
+}
+
+template <std::size_t Size, typename Access>
+std::span<std::uint8_t, Size> Memory<Size, Access>::view()
+{
+    return m_data;
+}
+
+template <std::size_t Size, typename Access>
+std::span<const std::uint8_t, Size> Memory<Size, Access>::view() const
+{
+    return m_data;
+}
+
+template <std::size_t Size, typename Access>
+constexpr std::size_t Memory<Size, Access>::getSize()
+{
+    return Size;
+}
@@ -0,0 +1,41 @@
+#include "./../Stack.hpp"
+
+template <std::size_t Capacity>
+bool Stack<Capacity>::push(std::uint16_t address)
+{
+    if(m_depth == Capacity)
+    {
+        return false;
+    }
+    m_data[m_depth++] = address;
+    return true;
+}
+
+template <std::size_t Capacity>
+bool Stack<Capacity>::pop(std::uint16_t& address)
+{
+    if(m_depth == 0)
+    {
+        return false;
+    }
+    address = m_data[--m_depth];
+    return true;
+}
+
+template <std::size_t Capacity>
+std::size_t Stack<Capacity>::getDepth() const
+{
+    return m_depth;
+}
+
+template <std::size_t Capacity>
+std::span<const std::uint16_t> Stack<Capacity>::view() const
+{
+    return { m_data.data(), m_depth };
+}
+
+template <std::size_t Capacity>
+constexpr std::size_t Stack<Capacity>::getCapacity()
+{
+    return Capacity;
+}
@@ -1,8 +1,10 @@
 #include <iostream>
 #include <map>
+#include <algorithm>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_mixer.h>
 #include "header/Chip8.hpp"
+#include "header/SaveFile.hpp"
 #include <imgui.h>
 #include <imgui_impl_sdl2.h>
 #include <imgui_impl_sdlrenderer2.h>
@@ -30,12 +32,26 @@ int main()
 
     // Prepare emulator
     Chip8 emulator{};
+    // A snapshot every 1/60 of a second of real time (every frame with virtual timers), about 10 minutes of history for most ROMs
+    emulator.setRewind(16 << 20);
     double emu_last_update{ (double) Timer::getTime() };
     int emu_updates_per_second{0};
     char emu_rom_dir[MAX_ROM_DIR_LEN]{};
-    Chip8::SaveState emu_save_state{emulator.getSaveState()};
+    char emu_aot_dir[MAX_ROM_DIR_LEN]{};
+    std::bitset<Chip8Const::mem_size> emu_breakpoints{};
+    Chip8::StopConditions emu_stop_conditions{};
+    // How long the main loop can sleep, because the emulator is busy waiting on a timer or a key
+    int64_t emu_idle_sleep{ 0 };
+    Chip8::MachineState emu_save_state{};
+    int emu_save_slot{ 0 };
+    // Held to go back in time, a snapshot every 1/60 of a second, so it goes back at the speed it was recorded
+    bool emu_rewinding{ false };
+    int64_t emu_last_rewind{ 0 };
     float emu_fg[3]{0xFF/255.f, 0xFF/255.f, 0xFF/255.f};
     float emu_bg[3]{0x00/255.f, 0x00/255.f, 0x00/255.f};
+    // What is drawn on the target texture, so only the changed rows are drawn again
+    std::uint64_t emu_drawn_generation{};
+    bool emu_redraw_all{ true };
 
     // Move this to a function for later cleanup (in case it fails in the middle!)
     // Prepare SDL
@@ -95,6 +111,10 @@ int main()
     // Create imgui settings vars
     std::string imgui_status{};
     int imgui_mem_view_follow{};
+    int imgui_backend{ (int)emulator.getBackend() };
+    int imgui_timer_mode{ (int)emulator.getTimerMode() };
+    std::uint32_t imgui_instructions_per_frame{ emulator.getInstructionsPerFrame() };
+    Chip8_t::Word imgui_breakpoint{Chip8Const::rom_mem_start};
     double imgui_updates_per_sec_actual{emu_updates_per_second};
 
     // Play sound
@@ -139,6 +159,10 @@ int main()
                 }
                 case SDL_KEYDOWN:
                 {
+                    if(ev.key.keysym.sym == SDLK_BACKSPACE && !io.WantCaptureKeyboard)
+                    {
+                        emu_rewinding = true;
+                    }
                     if(key_translations.find(ev.key.keysym.sym) != key_translations.end())
                     {
                         emulator.setKeyState(key_translations.at(ev.key.keysym.sym), Chip8::KeyState::DOWN);
@@ -147,6 +171,10 @@ int main()
                 }
                 case SDL_KEYUP:
                 {
+                    if(ev.key.keysym.sym == SDLK_BACKSPACE)
+                    {
+                        emu_rewinding = false;
+                    }
                     if(key_translations.find(ev.key.keysym.sym) != key_translations.end())
                     {
                         emulator.setKeyState(key_translations.at(ev.key.keysym.sym), Chip8::KeyState::JUST_RELEASED);
@@ -165,16 +193,46 @@ int main()
         int64_t time_now{ Timer::getTime() };
         double emu_update_wait{ 1000.0 / double(emu_updates_per_second) };
         double since_last_update{ double(time_now) - emu_last_update };
-        if(since_last_update >= emu_update_wait)
+        if(emu_rewinding)
+        {
+            // The emulation is paused while going back, it continues from wherever it ends up
+            if(time_now - emu_last_rewind >= 1000 / 60)
+            {
+                emu_last_rewind = time_now;
+                imgui_status = emulator.rewind() ? "REWINDING..." : "NOTHING TO REWIND!";
+            }
+            emu_last_update = (double)time_now;
+        }
+        else if(since_last_update >= emu_update_wait)
         {
             int64_t amount_of_updates{ (int64_t)(since_last_update / emu_update_wait) };
             double time_accounted_for{ amount_of_updates * emu_update_wait };
-            for(int64_t i{}; i < amount_of_updates; ++i)
+            // Breakpoints are checked after every instruction, so only pass them if there are any
+            emu_stop_conditions.breakpoints = emu_breakpoints.any() ? &emu_breakpoints : nullptr;
+            Chip8::RunResult result{ emulator.run(amount_of_updates, emu_stop_conditions) };
+            if(result.reason == Chip8::StopReason::BREAKPOINT)
             {
-                emulator.emulateStep();
+                imgui_status = "BREAKPOINT HIT!";
+                emu_updates_per_second = 0;
+            }
+            else if(result.reason == Chip8::StopReason::STACK_OVERFLOW || result.reason == Chip8::StopReason::STACK_UNDERFLOW)
+            {
+                imgui_status = result.reason == Chip8::StopReason::STACK_OVERFLOW ? "STACK OVERFLOW!" : "STACK UNDERFLOW!";
+                emu_updates_per_second = 0;
             }
 
-            imgui_updates_per_sec_actual = amount_of_updates / (since_last_update / 1000.0);
+            // Skipped instructions of an idle loop still count, as the program would have executed them
+            imgui_updates_per_sec_actual = (result.executed + result.elided) / (since_last_update / 1000.0);
+            emu_idle_sleep = 0;
+            if(result.reason == Chip8::StopReason::IDLE)
+            {
+                int64_t until_tick{ emulator.getTimeUntilDelayTick() };
+                emu_idle_sleep = until_tick < 0 ? 16 : std::min<int64_t>(until_tick, 16);
+            }
+            else if(result.reason == Chip8::StopReason::KEY_WAIT)
+            {
+                emu_idle_sleep = 16;
+            }
             double time_unaccounted_for{ since_last_update - time_accounted_for }; 
             emu_last_update = (double)time_now - time_unaccounted_for;
         }
@@ -210,11 +268,28 @@ int main()
         // Clear
         SDL_RenderClear(renderer);
 
-        // Draw to texture
+        // Draw the changed rows to texture, the texture keeps the rest
+        std::uint64_t dirty_rows{ emulator.takeDisplayDirtyRows() };
+        if(emulator.getDisplayGeneration() == emu_drawn_generation)
+        {
+            dirty_rows = 0;
+        }
+        emu_drawn_generation = emulator.getDisplayGeneration();
+        if(emu_redraw_all)
+        {
+            dirty_rows = ~std::uint64_t(0);
+            emu_redraw_all = false;
+        }
+
         SDL_SetRenderTarget(renderer, target);
-        for(int x{}; x < 64; ++x)
+        for(int y{}; y < 32; ++y)
         {
-            for(int y{}; y < 32; ++y)
+            if((dirty_rows & (std::uint64_t(1) << y)) == 0)
+            {
+                continue;
+            }
+
+            for(int x{}; x < 64; ++x)
             {
                 bool pixel{ emulator.getPixel(x, y) };
                 if(pixel)
@@ -327,6 +402,25 @@ int main()
             //ImGui::InputInt("Instructions per second", &emu_updates_per_second, 1, 100);
             ImGui::InputScalar("Instructions per second", ImGuiDataType_U32, &emu_updates_per_second, nullptr, nullptr, "%u");
 
+            // Execution backend
+            if(ImGui::Combo("Execution backend", &imgui_backend, "Interpreter\0Cached blocks\0JIT\0AOT\0Threaded\0"))
+            {
+                emulator.setBackend((Chip8::Backend)imgui_backend);
+            }
+
+            // Timers, virtual ones go down once every 'instructions per frame' instructions instead of 60 times a second
+            if(ImGui::Combo("Timers", &imgui_timer_mode, "Wall clock\0Virtual\0"))
+            {
+                emulator.setTimerMode((Timer::Mode)imgui_timer_mode);
+            }
+            if(imgui_timer_mode == (int)Timer::Mode::VIRTUAL)
+            {
+                if(ImGui::InputScalar("Instructions per frame", ImGuiDataType_U32, &imgui_instructions_per_frame, nullptr, nullptr, "%u"))
+                {
+                    emulator.setInstructionsPerFrame(imgui_instructions_per_frame);
+                }
+            }
+
             // Next instruction
             if(ImGui::Button("Next Instruction"))
             {
@@ -337,6 +431,20 @@ int main()
             
             // Actual instr/sec
             ImGui::Text("Actual instructions per second: %.02f", imgui_updates_per_sec_actual);
+
+            // Breakpoints, the emulation pauses (0 instructions per second) when one is reached
+            ImGui::InputScalar("Breakpoint", ImGuiDataType_U16, &imgui_breakpoint, nullptr, nullptr, "%03X", ImGuiInputTextFlags_CharsHexadecimal);
+            ImGui::SameLine();
+            if(ImGui::Button("Toggle breakpoint") && imgui_breakpoint < Chip8Const::mem_size)
+            {
+                emu_breakpoints.flip(imgui_breakpoint);
+            }
+            ImGui::SameLine();
+            if(ImGui::Button("Clear breakpoints"))
+            {
+                emu_breakpoints.reset();
+            }
+            ImGui::Text("Breakpoints set: %zu", emu_breakpoints.count());
             
             
             // - ROM settings -
@@ -359,6 +467,21 @@ int main()
                 }
             }
 
+            ImGui::InputText("AOT module directory", emu_aot_dir, MAX_ROM_DIR_LEN);
+            if(ImGui::Button("Load AOT module"))
+            {
+                if(!emulator.loadAotModule(emu_aot_dir))
+                {
+                    imgui_status = "FAILED TO LOAD AOT MODULE!";
+                }
+                else
+                {
+                    imgui_status = "AOT MODULE LOADED!";
+                    imgui_backend = (int)Chip8::Backend::AOT;
+                    emulator.setBackend(Chip8::Backend::AOT);
+                }
+            }
+
             ImGui::SameLine();
             if(ImGui::Button("Clear memory"))
             {
@@ -367,18 +490,39 @@ int main()
                 emulator.clearMemory();
             }
 
-            ImGui::SameLine();
+            // Save states are kept in numbered slots next to the ROM
+            ImGui::SliderInt("Save slot", &emu_save_slot, 0, 9);
             if(ImGui::Button("Save state"))
             {
-                imgui_status = "SAVED STATE!";
-                emu_save_state = emulator.getSaveState();
+                emulator.saveState(emu_save_state);
+                if(!SaveFile::write(SaveFile::getSlotPath(emu_rom_dir, emu_save_slot), emu_save_state))
+                {
+                    imgui_status = "FAILED TO SAVE STATE!";
+                }
+                else
+                {
+                    imgui_status = "SAVED STATE!";
+                }
             }
 
             ImGui::SameLine();
             if(ImGui::Button("Load state"))
             {
-                imgui_status = "LOADED STATE!";
-                emulator.loadSaveState(emu_save_state);
+                if(!SaveFile::read(SaveFile::getSlotPath(emu_rom_dir, emu_save_slot), emu_save_state))
+                {
+                    imgui_status = "FAILED TO LOAD STATE!";
+                }
+                else if(emu_save_state.rom_hash != emulator.getRomHash())
+                {
+                    imgui_status = "STATE IS FOR A DIFFERENT ROM!";
+                }
+                else
+                {
+                    imgui_status = "LOADED STATE!";
+                    emulator.loadState(emu_save_state);
+                    imgui_timer_mode = (int)emulator.getTimerMode();
+                    imgui_instructions_per_frame = emulator.getInstructionsPerFrame();
+                }
             }
 
             ImGui::Text(("Status: " + imgui_status).c_str());
@@ -399,7 +543,10 @@ int main()
             }
             if(ImGui::BeginPopup("ForegroundColorPicker"))
             {
-                ImGui::ColorPicker3("Foreground color", emu_fg);
+                if(ImGui::ColorPicker3("Foreground color", emu_fg))
+                {
+                    emu_redraw_all = true;
+                }
                 ImGui::EndPopup();
             }
 
@@ -412,7 +559,10 @@ int main()
             }
             if(ImGui::BeginPopup("BackgroundColorPicker"))
             {
-                ImGui::ColorPicker3("Background color", emu_bg);
+                if(ImGui::ColorPicker3("Background color", emu_bg))
+                {
+                    emu_redraw_all = true;
+                }
                 ImGui::EndPopup();
             }
 
@@ -480,26 +630,24 @@ int main()
             ImGui::TableSetupColumn("Value");
             ImGui::TableHeadersRow();
 
-            std::stack<Chip8_t::Word> stack_copy{ emulator.getStackCopy() };
-
-            int i{1};
-            while(!stack_copy.empty())
-            {
-                ImGui::TableNextRow();
-                ImGui::TableSetColumnIndex(0);
-                ImGui::Text("%u", i++);
-                ImGui::TableSetColumnIndex(1);
-                ImGui::Text("%04X", stack_copy.top());
-                stack_copy.pop();
-            }
+            Chip8::StackType stack_copy{ emulator.getStackCopy() };
+            std::span<const Chip8_t::Word> stack_view{ stack_copy.view() };
 
-            for(int j{i}; j <= 10; ++j)
+            // The view is bottom first, the table is top first
+            for(std::size_t i{}; i < Chip8::StackType::getCapacity(); ++i)
             {
                 ImGui::TableNextRow();
                 ImGui::TableSetColumnIndex(0);
-                ImGui::Text("%u", j);
+                ImGui::Text("%zu", i + 1);
                 ImGui::TableSetColumnIndex(1);
-                ImGui::Text("N/A");
+                if(i < stack_view.size())
+                {
+                    ImGui::Text("%04X", stack_view[stack_view.size() - 1 - i]);
+                }
+                else
+                {
+                    ImGui::Text("N/A");
+                }
             }
 
             ImGui::EndTable();
@@ -516,6 +664,12 @@ int main()
 
         // Present
         SDL_RenderPresent(renderer);
+
+        // Don't spin while the program is only waiting
+        if(emu_idle_sleep > 0)
+        {
+            SDL_Delay((Uint32)emu_idle_sleep);
+        }
     }
 
     // --- Cleanup ---
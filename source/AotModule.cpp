@@ -0,0 +1,77 @@
+#include "../header/Aot.hpp"
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <dlfcn.h>
+#define AOT_MODULE_DLOPEN
+#endif
+
+// --- Constructors ---
+
+AotModule::AotModule() {}
+
+AotModule::AotModule(AotModule&& other) noexcept :
+    m_handle{std::exchange(other.m_handle, nullptr)},
+    m_module{std::exchange(other.m_module, nullptr)}
+{}
+
+AotModule& AotModule::operator=(AotModule&& other) noexcept
+{
+    if(this != &other)
+    {
+        unload();
+        m_handle = std::exchange(other.m_handle, nullptr);
+        m_module = std::exchange(other.m_module, nullptr);
+    }
+    return *this;
+}
+
+AotModule::~AotModule()
+{
+    unload();
+}
+
+// --- Member functions ---
+
+bool AotModule::load(const std::string& path)
+{
+    unload();
+
+#ifdef AOT_MODULE_DLOPEN
+    m_handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if(m_handle == nullptr)
+    {
+        return false;
+    }
+
+    const Chip8AotModule* module{ static_cast<const Chip8AotModule*>(dlsym(m_handle, CHIP8_AOT_SYMBOL)) };
+    if(module == nullptr || module->abi_version != CHIP8_AOT_ABI_VERSION)
+    {
+        unload();
+        return false;
+    }
+
+    m_module = module;
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+void AotModule::unload()
+{
+#ifdef AOT_MODULE_DLOPEN
+    if(m_handle != nullptr)
+    {
+        dlclose(m_handle);
+    }
+#endif
+    m_handle = nullptr;
+    m_module = nullptr;
+}
+
+const Chip8AotModule* AotModule::get() const
+{
+    return m_module;
+}
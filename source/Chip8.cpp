@@ -2,50 +2,83 @@
 #include <fstream>
 #include <iomanip>
 #include <random>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <utility>
 #include "../header/Chip8.hpp"
 
 // ---- Emulator functions ----
 
 // 00E0 - Clear screen, argument name omitted to make compiler shut up
-void Chip8::_00E0(const Instruction<Chip8_t::Word>&)
+void Chip8::_00E0(const DecodedOp&)
 {
     m_display.setAll(0);
 }
 
 // 00EE - Set PC to the value at top of the stack, argument name omitted to make compiler shut up
-void Chip8::_00EE(const Instruction<Chip8_t::Word>&)
+void Chip8::_00EE(const DecodedOp&)
 {
-    Chip8_t::Word location{m_stack.top()};
-    m_stack.pop();
+    Chip8_t::Word location{};
+    if(!m_stack.pop(location))
+    {
+        // Nowhere to return to, stop at the 00EE
+        printf("STACK UNDERFLOW AT %03X!\n", m_PC - 2);
+        m_PC -= 2;
+        m_stop = StopReason::STACK_UNDERFLOW;
+        return;
+    }
     jumpTo(location);
 }
 
+// Any opcode which isn't a known instruction
+void Chip8::invalidOp(const DecodedOp& op)
+{
+    printf("INVALID INSTRUCTION ORIGINATING FROM %04X\n", op.opcode);
+}
+
 // 0NNN - not implemented!, argument name omitted to make compiler shut up
-void Chip8::_0NNN(const Instruction<Chip8_t::Word>&)
+void Chip8::_0NNN(const DecodedOp&)
 {
     std::cout << "UNINMPLEMENTED!\n";
 }
 
 // 1NNN - Jump to NNN
-void Chip8::_1NNN(const Instruction<Chip8_t::Word>& instruction)
+void Chip8::_1NNN(const DecodedOp& op)
 {
-    Chip8_t::Word location{ (Chip8_t::Word)(instruction.getNibbles(1, 3)) };
+    Chip8_t::Word location{ op.nnn };
+
+    // Jumping back around a loop that can't do anything new until the delay timer or a key changes
+    std::size_t length{ location < m_PC ? getIdleLoopLength(location, m_PC - 2) : 0 };
+    if(length > 0)
+    {
+        m_stop = StopReason::IDLE;
+        m_idle_loop_length = (std::uint32_t)length;
+    }
+
     jumpTo(location);
 }
 
 // 2NNN - add current PC to stack, and jump to NNN
-void Chip8::_2NNN(const Instruction<Chip8_t::Word>& instruction)
+void Chip8::_2NNN(const DecodedOp& op)
 {
-    m_stack.push(m_PC);
-    Chip8_t::Word location{ (Chip8_t::Word)(instruction.getNibbles(1, 3)) };
+    if(!m_stack.push(m_PC))
+    {
+        // No room for the return address, stop at the 2NNN
+        printf("STACK OVERFLOW AT %03X!\n", m_PC - 2);
+        m_PC -= 2;
+        m_stop = StopReason::STACK_OVERFLOW;
+        return;
+    }
+    Chip8_t::Word location{ op.nnn };
     jumpTo(location);
 }
 
 // 3XNN - Skip one instruction if value in VX == NN
-void Chip8::_3XNN(const Instruction<Chip8_t::Word>& instruction)
+void Chip8::_3XNN(const DecodedOp& op)
 {
-    Chip8_t::Byte val_1{ m_regs.read(instruction.getNibble(1)) };
-    Chip8_t::Byte val_2{ (Chip8_t::Byte)(instruction.getNibbles(2, 3)) };
+    Chip8_t::Byte val_1{ m_regs.read(op.x) };
+    Chip8_t::Byte val_2{ op.nn };
 
     if(val_1 == val_2)
     {
@@ -54,10 +87,10 @@ void Chip8::_3XNN(const Instruction<Chip8_t::Word>& instruction)
 }
 
 // 4XNN - Skip one instruction if value in VX != NN
-void Chip8::_4XNN(const Instruction<Chip8_t::Word>& instruction)
+void Chip8::_4XNN(const DecodedOp& op)
 {
-    Chip8_t::Byte val_1{ m_regs.read(instruction.getNibble(1)) };
-    Chip8_t::Byte val_2{ (Chip8_t::Byte)(instruction.getNibbles(2, 3)) };
+    Chip8_t::Byte val_1{ m_regs.read(op.x) };
+    Chip8_t::Byte val_2{ op.nn };
 
     if(val_1 != val_2)
     {
@@ -66,10 +99,10 @@ void Chip8::_4XNN(const Instruction<Chip8_t::Word>& instruction)
 }
 
 // 5XY0 - Skip if values in VX == VY
-void Chip8::_5XY0(const Instruction<Chip8_t::Word>& instruction)
+void Chip8::_5XY0(const DecodedOp& op)
 {
-    Chip8_t::Byte val_1{ m_regs.read(instruction.getNibble(1)) };
-    Chip8_t::Byte val_2{ m_regs.read(instruction.getNibble(2)) };
+    Chip8_t::Byte val_1{ m_regs.read(op.x) };
+    Chip8_t::Byte val_2{ m_regs.read(op.y) };
 
     if(val_1 == val_2)
     {
@@ -78,382 +111,745 @@ void Chip8::_5XY0(const Instruction<Chip8_t::Word>& instruction)
 }
 
 // 6XNN - set register VX to NN
-void Chip8::_6XNN(const Instruction<Chip8_t::Word>& instruction)
+void Chip8::_6XNN(const DecodedOp& op)
 {
-    Chip8_t::Byte value{ (Chip8_t::Byte)(instruction.getNibbles(2, 3)) };
-    m_regs.write(instruction.getNibble(1), value);
+    Chip8_t::Byte value{ op.nn };
+    m_regs.write(op.x, value);
 }
 
 // 7XNN - add NN to register VX
-void Chip8::_7XNN(const Instruction<Chip8_t::Word>& instruction)
+void Chip8::_7XNN(const DecodedOp& op)
 {
-    Chip8_t::Byte value{ (Chip8_t::Byte)(m_regs.read(instruction.getNibble(1))) };
-    Chip8_t::Byte add{ (Chip8_t::Byte) (instruction.getNibbles(2, 3)) };
-    m_regs.write(instruction.getNibble(1), value + add);
+    Chip8_t::Byte value{ m_regs.read(op.x) };
+    Chip8_t::Byte add{ op.nn };
+    m_regs.write(op.x, value + add);
 }
 
 // 8XY0 -   set VX to VY
-void Chip8::_8XY0(const Instruction<Chip8_t::Word>& instruction)
+void Chip8::_8XY0(const DecodedOp& op)
 {
-    Chip8_t::Byte vy{ m_regs.read(instruction.getNibble(2)) };
-    m_regs.write(instruction.getNibble(1), vy);
+    Chip8_t::Byte vy{ m_regs.read(op.y) };
+    m_regs.write(op.x, vy);
 }
 
-// 8XY1 -   set VX to bitwise OR of VX and VY
-void Chip8::_8XY1(const Instruction<Chip8_t::Word>& instruction)
+// 8XY4 -   set VX to VX + VY, if VX+VY overflows VF is set to 1, otherwise to 0
+void Chip8::_8XY4(const DecodedOp& op)
+{
+    Chip8_t::Byte vx{ m_regs.read(op.x) };
+    Chip8_t::Byte vy{ m_regs.read(op.y) };
+    m_regs.write(op.x, vx + vy);
+    m_regs.write(0xF, vx + vy > 0xFF);
+}
+
+// 8XY5 -   set VX to VX - VY, if VX > VY set VF to 1, otherwise to 0
+void Chip8::_8XY5(const DecodedOp& op)
+{
+    Chip8_t::Byte vx{ m_regs.read(op.x) };
+    Chip8_t::Byte vy{ m_regs.read(op.y) };
+    m_regs.write(op.x, vx - vy);
+    m_regs.write(0xF, vx >= vy);
+}
+
+// 8XY7 -   set VX to VY - VX, if VY > VX set VF to 1, otherwise to 0
+void Chip8::_8XY7(const DecodedOp& op)
+{
+    Chip8_t::Byte vx{ m_regs.read(op.x) };
+    Chip8_t::Byte vy{ m_regs.read(op.y) };
+    m_regs.write(op.x, vy - vx);
+    m_regs.write(0xF, vy >= vx);
+}
+
+// 9XY0 - Skip one instruction if values in VX != VY
+void Chip8::_9XY0(const DecodedOp& op)
 {
-    Chip8_t::Byte vx{ m_regs.read(instruction.getNibble(1)) };
-    Chip8_t::Byte vy{ m_regs.read(instruction.getNibble(2)) };
-    m_regs.write(instruction.getNibble(1), vx | vy);
+    Chip8_t::Byte val_1{ m_regs.read(op.x) };
+    Chip8_t::Byte val_2{ m_regs.read(op.y) };
 
-    if(m_behaviour == Chip8::BehaviourType::CHIP8)
+    if(val_1 != val_2)
     {
-        m_regs.write(0xF, 0);
+        m_PC += 2;
     }
 }
 
-// 8XY2 -   set VX to bitwise AND of VX and VY
-void Chip8::_8XY2(const Instruction<Chip8_t::Word>& instruction)
+// ANNN - set index I to NNN
+void Chip8::_ANNN(const DecodedOp& op)
 {
-    Chip8_t::Byte vx{ m_regs.read(instruction.getNibble(1)) };
-    Chip8_t::Byte vy{ m_regs.read(instruction.getNibble(2)) };
-    m_regs.write(instruction.getNibble(1), vx & vy);
+    Chip8_t::Word value{ op.nnn };
+    m_I = value;
+}
 
-    if(m_behaviour == Chip8::BehaviourType::CHIP8)
+// CXNN - generates a random number and binary ANDs it with NN, then puts the result in VX
+void Chip8::_CXNN(const DecodedOp& op)
+{
+    // The highest bits of xoshiro128** are the best ones
+    Chip8_t::Byte random{ (Chip8_t::Byte)(m_random.next() >> 24) };
+    Chip8_t::Byte value{ op.nn };
+    m_regs.write(op.x, random & value);
+}
+
+// EX9E - Skip one instruction if the key corresponding to value in VX is pressed
+void Chip8::_EX9E(const DecodedOp& op)
+{
+    Chip8_t::Byte key{ (Chip8_t::Byte)(m_regs.read(op.x) % (Chip8Const::buttons))};
+    if(m_key_states[key] == Chip8::KeyState::DOWN) 
     {
-        m_regs.write(0xF, 0);
+        m_PC += 2;
     }
 }
 
-// 8XY3 -   set VX to bitwise XOR of VX and VY
-void Chip8::_8XY3(const Instruction<Chip8_t::Word>& instruction)
+// EXA1 - Skip one instruction if the key corresponding to value in VX is not pressed
+void Chip8::_EXA1(const DecodedOp& op)
 {
-    Chip8_t::Byte vx{ m_regs.read(instruction.getNibble(1)) };
-    Chip8_t::Byte vy{ m_regs.read(instruction.getNibble(2)) };
-    m_regs.write(instruction.getNibble(1), vx ^ vy);
-
-    if(m_behaviour == Chip8::BehaviourType::CHIP8)
+    Chip8_t::Byte key{ (Chip8_t::Byte)(m_regs.read(op.x) % (Chip8Const::buttons))};
+    if(m_key_states[key] == Chip8::KeyState::UP || m_key_states[key] == Chip8::KeyState::JUST_RELEASED)
     {
-        m_regs.write(0xF, 0);
+        m_PC += 2;
     }
 }
 
-// 8XY4 -   set VX to VX + VY, if VX+VY overflows VF is set to 1, otherwise to 0
-void Chip8::_8XY4(const Instruction<Chip8_t::Word>& instruction)
+// FX07 - set VX to current value of delay timer
+void Chip8::_FX07(const DecodedOp& op)
 {
-    Chip8_t::Byte vx{ m_regs.read(instruction.getNibble(1)) };
-    Chip8_t::Byte vy{ m_regs.read(instruction.getNibble(2)) };
-    m_regs.write(instruction.getNibble(1), vx + vy);
-    m_regs.write(0xF, vx + vy > 0xFF);
+    m_regs.write(op.x, m_delay_timer.get());
 }
 
-// 8XY5 -   set VX to VX - VY, if VX > VY set VF to 1, otherwise to 0
-void Chip8::_8XY5(const Instruction<Chip8_t::Word>& instruction)
+// FX15 - set delay timer to current value in VX
+void Chip8::_FX15(const DecodedOp& op)
 {
-    Chip8_t::Byte vx{ m_regs.read(instruction.getNibble(1)) };
-    Chip8_t::Byte vy{ m_regs.read(instruction.getNibble(2)) };
-    m_regs.write(instruction.getNibble(1), vx - vy);
-    m_regs.write(0xF, vx >= vy);
+    m_delay_timer.set(m_regs.read(op.x));
 }
 
-// 8XY7 -   set VX to VY - VX, if VY > VX set VF to 1, otherwise to 0
-void Chip8::_8XY7(const Instruction<Chip8_t::Word>& instruction)
+// FX18 - set sound timer to current value in VX
+void Chip8::_FX18(const DecodedOp& op)
 {
-    Chip8_t::Byte vx{ m_regs.read(instruction.getNibble(1)) };
-    Chip8_t::Byte vy{ m_regs.read(instruction.getNibble(2)) };
-    m_regs.write(instruction.getNibble(1), vy - vx);
-    m_regs.write(0xF, vy >= vx);
+    m_sound_timer.set(m_regs.read(op.x));
 }
 
-// 8XY6 -   
-// Beh1:    set VX to VY
-// Beh2:    ignore VY
-// Then:    Shift VX one bit to the right, set VF to 1 if the bit shifted out was 1, or 0 if was 0
-void Chip8::_8XY6(const Instruction<Chip8_t::Word>& instruction)
+// FX1E - add VX to I
+void Chip8::_FX1E(const DecodedOp& op)
 {
-    Chip8_t::Byte vx{ m_regs.read(instruction.getNibble(1)) };
-    if(m_behaviour == Chip8::BehaviourType::CHIP8)
+    m_I += m_regs.read(op.x);
+}
+
+// FX0A - Waits until a key is pressed, if a key is pressed it's "value" is put in VX
+void Chip8::_FX0A(const DecodedOp& op)
+{
+    Chip8_t::Byte key{Chip8Const::buttons};
+    for(Chip8_t::Byte key_i{}; key_i < Chip8Const::buttons; ++key_i)
+    {
+        if(m_key_states[key_i] == KeyState::JUST_RELEASED)
+        {
+            key = key_i;
+            break;
+        }
+    }
+    if(key >= Chip8Const::buttons)
+    {
+        m_PC -= 2;
+        m_stop = StopReason::KEY_WAIT;
+    }
+    else
     {
-        vx = m_regs.read(instruction.getNibble(2));
+        m_regs.write(op.x, key);
     }
+}
+
+// FX29 - set the I register to the address of hexadecimal character in VX
+void Chip8::_FX29(const DecodedOp& op)
+{
+    // Get the second nibble (index 1)
+    Chip8_t::Byte m_char{ m_regs.read(op.x) };
+    m_char = m_char % (0xF+1);
 
-    m_regs.write(instruction.getNibble(1), vx >> 1);
-    m_regs.write(0xF, vx & 0b00000001);
+    // Set I to the font location
+    m_I = Chip8Const::font_begin + m_char * 5;
 }
 
-// 8XYE -   
-// Beh1:    set VX to VY
-// Beh2:    ignore VY
-// Then:    Shift VX one bit to the left, set VF to 1 if the bit shifted out was 1, or 0 if was 0
-void Chip8::_8XYE(const Instruction<Chip8_t::Word>& instruction)
+// FX33 - Take the number in VX, divide to 3 dec numbers (139 - 1, 3, 9), then store them in I, I+1, I+2
+void Chip8::_FX33(const DecodedOp& op)
 {
-    Chip8_t::Byte vx{ m_regs.read(instruction.getNibble(1)) };
-    if(m_behaviour == Chip8::BehaviourType::CHIP8)
-    {
-        vx = m_regs.read(instruction.getNibble(2));
-    }
+    Chip8_t::Byte num{ m_regs.read(op.x) };
+    const Chip8_t::Byte digits[]{ (Chip8_t::Byte)(num / 100), (Chip8_t::Byte)(num / 10 % 10), (Chip8_t::Byte)(num % 10) };
+    writeMemory(m_I, digits);
+}
 
-    m_regs.write(instruction.getNibble(1), vx << 1);
-    m_regs.write(0xF, (vx & 0b10000000) > 0);
+// --- Private member functions ---
+
+void Chip8::jumpTo(Chip8_t::Word location)
+{
+    m_PC = location;
 }
 
-// 9XY0 - Skip one instruction if values in VX != VY
-void Chip8::_9XY0(const Instruction<Chip8_t::Word>& instruction)
+const Chip8::DecodedOp& Chip8::fetch()
 {
-    Chip8_t::Byte val_1{ m_regs.read(instruction.getNibble(1)) };
-    Chip8_t::Byte val_2{ m_regs.read(instruction.getNibble(2)) };
+    Chip8_t::Word pc{ m_PC };
+    m_PC += 2;
 
-    if(val_1 != val_2)
+    // Only even, in bounds addresses are cached
+    if(pc >= Chip8Const::mem_size || (pc & 1) != 0)
     {
-        m_PC += 2;
+        return m_dispatch[(m_memory.read(pc) << 8) | m_memory.read(pc + 1)];
     }
+
+    const DecodedOp*& cached{ m_decode_cache[pc >> 1] };
+    if(cached == nullptr)
+    {
+        cached = &m_dispatch[(m_memory.read(pc) << 8) | m_memory.read(pc + 1)];
+    }
+
+    return *cached;
 }
 
-// ANNN - set index I to NNN
-void Chip8::_ANNN(const Instruction<Chip8_t::Word>& instruction)
+void Chip8::writeMemory(Chip8_t::Word where, Chip8_t::Byte what)
 {
-    Chip8_t::Word value{ (Chip8_t::Word)(instruction.getNibbles(1, 3)) };
-    m_I = value;
+    m_memory.write(where, what);
+    memoryWritten(where);
 }
 
-// Legacy:
-// BXNN - Jump to XNN plus the value in V0
-// New:
-// BXNN - Jump to XNN plus the value in register VX
-void Chip8::_BXNN(const Instruction<Chip8_t::Word>& instruction)
+void Chip8::writeMemory(Chip8_t::Word where, std::span<const Chip8_t::Byte> what)
 {
-    // Convert XNN to a single number
-    Chip8_t::Word dest{ (Chip8_t::Word) instruction.getNibbles(1, 3)};
-    
-    // Add the appropriate register
-    if(m_behaviour == Chip8::BehaviourType::CHIP8)
+    m_memory.writeBlock(where, what);
+
+    // Masked memory wraps the bytes around, the others don't write past the end
+    for(std::size_t i{}; i < what.size(); ++i)
     {
-        dest += m_regs.read(0x0);
+        memoryWritten((where + i) % Chip8Const::mem_size);
     }
-    else
+}
+
+void Chip8::memoryWritten(Chip8_t::Word where)
+{
+    // The byte is part of the instruction starting at the even address at or right before it
+    if(where < Chip8Const::mem_size)
     {
-        dest += m_regs.read(instruction.getNibble(1));
+        m_decode_cache[where >> 1] = nullptr;
+
+        // Blocks can't be dropped right away, the one doing the write might still be executing
+        if(m_block_code[where])
+        {
+            m_flush_blocks = true;
+        }
+
+        // Mark the translated blocks which contain the byte as dirty, they can start up to max_block_length instructions before it
+        if(m_aot.get() != nullptr)
+        {
+            Chip8_t::Word first{ (Chip8_t::Word)(where >= max_block_length * 2 ? where - max_block_length * 2 + 1 : 0) };
+            for(Chip8_t::Word start{ (Chip8_t::Word)(first & ~1) }; start <= where; start += 2)
+            {
+                if(start + m_aot_lengths[start >> 1] * 2 > where)
+                {
+                    m_aot_dirty[start >> 1] = true;
+                }
+            }
+        }
     }
-    
-    // Jump to it
-    jumpTo(dest);
 }
 
-// CXNN - generates a random number and binary ANDs it with NN, then puts the result in VX
-void Chip8::_CXNN(const Instruction<Chip8_t::Word>& instruction)
+void Chip8::invalidateDecodeCache()
 {
-    Chip8_t::Byte random{ (Chip8_t::Byte) (rand() % (0xFF+1)) };
-    Chip8_t::Byte value{ (Chip8_t::Byte) (instruction.getNibbles(2, 3)) };
-    m_regs.write(instruction.getNibble(1), random & value);
+    m_decode_cache.fill(nullptr);
+    m_flush_blocks = true;
 }
 
-// 0xDXYN - Draw a N height sprite to the screen at coordinates (VX, VY) from the location of the I registed
-//          if any of the pixels were flipped as a result of this set VF to 1, otherwise it's set to 0
-void Chip8::_DXYN(const Instruction<Chip8_t::Word>& instruction)
+void Chip8::flushBlocks()
 {
-    Chip8_t::Byte x{ (Chip8_t::Byte)(m_regs.read(instruction.getNibble(1)) % Chip8Const::screen_width) };
-    Chip8_t::Byte y{ (Chip8_t::Byte)(m_regs.read(instruction.getNibble(2)) % Chip8Const::screen_height) };
-    Chip8_t::Byte n{ (Chip8_t::Byte)(instruction.getNibble(3)) };
+    m_blocks.fill({});
+    m_block_ops.clear();
+    m_block_code.reset();
+    m_flush_blocks = false;
+    m_jit_code.clear();
+}
 
-    // Set VF register
-    m_regs.write(0xF, 0);
+Chip8::Block* Chip8::getBlock(Chip8_t::Word address)
+{
+    // Blocks only start at even addresses, and never contain the last instruction in memory
+    // so that the PC stays in bounds while a block is executing
+    if(address >= Chip8Const::mem_size - 2 || (address & 1) != 0)
+    {
+        return nullptr;
+    }
 
-    for(Chip8_t::Byte byte_i{}; byte_i < n; ++byte_i)
+    Block& block{ m_blocks[address >> 1] };
+    if(block.op_count > 0)
     {
-        // Exit contition
-        if(y + byte_i >= m_display.getHeight())
-        {
-            break;
-        }
+        return &block;
+    }
 
-        // Go through each bit in byte
-        for(char i{7}; i >= 0; --i)
+    // Discover the block
+    block.first_op = m_block_ops.size();
+    for(Chip8_t::Word pc{address}; pc < Chip8Const::mem_size - 2 && block.op_count < max_block_length; pc += 2)
+    {
+        const DecodedOp& op{ m_dispatch[(m_memory.read(pc) << 8) | m_memory.read(pc + 1)] };
+        m_block_ops.push_back(op);
+        m_block_code[pc] = true;
+        m_block_code[pc + 1] = true;
+        ++block.op_count;
+
+        bool block_end{};
+        switch(op.type)
         {
-            Chip8_t::Byte bit_i{ (Chip8_t::Byte)(7 - i) };
-            Chip8_t::Byte mask{ (Chip8_t::Byte) (1 << i) };
-            Chip8_t::Byte masked_number{ (Chip8_t::Byte) (m_memory.read(m_I + byte_i) & mask) };
-            bool bit{ (bool) ((Chip8_t::Byte)(masked_number >> i)) };
-            
-            // Exit condition
-            if ( x + bit_i >= m_display.getWidth())
+            // Anything that changes the PC
+            case OpType::_00EE:
+            case OpType::_1NNN:
+            case OpType::_2NNN:
+            case OpType::_BXNN:
+            case OpType::_3XNN:
+            case OpType::_4XNN:
+            case OpType::_5XY0:
+            case OpType::_9XY0:
+            case OpType::_EX9E:
+            case OpType::_EXA1:
+            case OpType::_FX0A:
+            // Anything that writes to memory, it might overwrite the rest of the block
+            case OpType::_FX33:
+            case OpType::_FX55:
             {
+                block_end = true;
                 break;
             }
-
-            // Draw
-            if(bit == true)
+            default:
             {
-                if(getPixel(x + bit_i, y + byte_i) == true)
-                {
-                    m_regs.write(0xF, 1);
-                }
-
-                m_display.flipPixel(x + bit_i, y + byte_i);
+                break;
             }
+        }
 
-            
+        if(block_end)
+        {
+            break;
         }
     }
+
+    return &block;
 }
 
-// EX9E - Skip one instruction if the key corresponding to value in VX is pressed
-void Chip8::_EX9E(const Instruction<Chip8_t::Word>& instruction)
+const Chip8::DecodedOp& Chip8::step()
 {
-    Chip8_t::Byte key{ (Chip8_t::Byte)(m_regs.read(instruction.getNibble(1)) % (Chip8Const::buttons))};
-    if(m_key_states[key] == Chip8::KeyState::DOWN) 
+    // Fetch & Decode, the decoding was already done when the dispatch table was built
+    const DecodedOp& op{fetch()};
+
+    // Ensure PC and I validness
+    if(m_PC >= Chip8Const::mem_size)
     {
-        m_PC += 2;
+        printf("PC (%04X) out of bounds! Setting it to 0xFFF - 1!\n", m_PC);
+        m_PC = Chip8Const::mem_size - 2;
     }
+    checkI();
+
+    // Execute
+    (this->*op.handler)(op);
+    return op;
 }
 
-// EXA1 - Skip one instruction if the key corresponding to value in VX is not pressed
-void Chip8::_EXA1(const Instruction<Chip8_t::Word>& instruction)
+std::uint64_t Chip8::emulateInterpreter(std::uint64_t amount)
 {
-    Chip8_t::Byte key{ (Chip8_t::Byte)(m_regs.read(instruction.getNibble(1)) % (Chip8Const::buttons))};
-    if(m_key_states[key] == Chip8::KeyState::UP || m_key_states[key] == Chip8::KeyState::JUST_RELEASED)
+    std::uint64_t executed{};
+    while(executed < amount && m_stop == StopReason::BUDGET)
+    {
+        step();
+        ++executed;
+    }
+    return executed;
+}
+
+std::uint64_t Chip8::emulateBlocks(std::uint64_t amount)
+{
+    std::uint64_t executed{};
+    while(executed < amount && m_stop == StopReason::BUDGET)
+    {
+        if(m_flush_blocks)
+        {
+            flushBlocks();
+        }
+
+        const Block* block{ getBlock(m_PC) };
+        if(block == nullptr)
+        {
+            step();
+            ++executed;
+            continue;
+        }
+
+        // Don't go over the amount, the rest of the block will be picked up as a new block next time
+        std::uint64_t count{ std::min<std::uint64_t>(block->op_count, amount - executed) };
+        runBlockOps(*block, count);
+        executed += count;
+    }
+
+    return executed;
+}
+
+void Chip8::runBlockOps(const Block& block, std::uint64_t count)
+{
+    const DecodedOp* ops{ m_block_ops.data() + block.first_op };
+    for(std::uint64_t i{}; i < count; ++i)
     {
         m_PC += 2;
+        checkI();
+        (this->*ops[i].handler)(ops[i]);
     }
 }
 
-// FX07 - set VX to current value of delay timer
-void Chip8::_FX07(const Instruction<Chip8_t::Word>& instruction)
+Chip8::RunResult Chip8::runChecked(std::uint64_t max_instructions, const StopConditions& conditions)
 {
-    m_regs.write(instruction.getNibble(1), m_delay_timer.get());
+    RunResult result{ StopReason::BUDGET, 0, 0 };
+    std::uint64_t end{ m_cycles + max_instructions };
+
+    // Keys queued for now, the rest of the events were serviced at the end of the last run
+    serviceEvents(conditions);
+    while(m_cycles < end)
+    {
+        // The first instruction is always executed, so running again from a breakpoint moves past it
+        if(conditions.breakpoints != nullptr && result.executed > 0 && m_PC < Chip8Const::mem_size && conditions.breakpoints->test(m_PC))
+        {
+            result.reason = StopReason::BREAKPOINT;
+            break;
+        }
+
+        m_stop = StopReason::BUDGET;
+        const DecodedOp& op{ step() };
+        ++result.executed;
+        ++m_cycles;
+
+        if(endSlice(result, end, conditions))
+        {
+            break;
+        }
+
+        if(conditions.frame && (op.type == OpType::_00E0 || op.type == OpType::_DXYN))
+        {
+            result.reason = StopReason::FRAME;
+            break;
+        }
+    }
+
+    return result;
 }
 
-// FX15 - set delay timer to current value in VX
-void Chip8::_FX15(const Instruction<Chip8_t::Word>& instruction)
+bool Chip8::eventLater(const Event& a, const Event& b)
 {
-    m_delay_timer.set(m_regs.read(instruction.getNibble(1)));
+    return a.cycle != b.cycle ? a.cycle > b.cycle : a.order > b.order;
 }
 
-// FX18 - set sound timer to current value in VX
-void Chip8::_FX18(const Instruction<Chip8_t::Word>& instruction)
+void Chip8::scheduleEvent(Event event)
 {
-    m_sound_timer.set(m_regs.read(instruction.getNibble(1)));
+    event.order = m_events_scheduled++;
+    m_events.push_back(event);
+    std::push_heap(m_events.begin(), m_events.end(), eventLater);
 }
 
-// FX1E - add VX to I
-void Chip8::_FX1E(const Instruction<Chip8_t::Word>& instruction)
+void Chip8::resetEvents()
 {
-    m_I += m_regs.read(instruction.getNibble(1));
+    // Queued keys stay, only the frames and the audio buffers start over
+    std::erase_if(m_events, [](const Event& event) { return event.type != EventType::KEY; });
+    std::make_heap(m_events.begin(), m_events.end(), eventLater);
+    scheduleEvent({ m_cycles + m_instructions_per_frame, 0, EventType::FRAME });
+    if(m_cycles_per_audio_buffer > 0)
+    {
+        scheduleEvent({ m_cycles + m_cycles_per_audio_buffer, 0, EventType::AUDIO });
+    }
 }
 
-// FX0A - Waits until a key is pressed, if a key is pressed it's "value" is put in VX
-void Chip8::_FX0A(const Instruction<Chip8_t::Word>& instruction)
+std::uint64_t Chip8::nextEventCycle(const StopConditions& conditions)
 {
-    Chip8_t::Byte key{Chip8Const::buttons};
-    for(Chip8_t::Byte key_i{}; key_i < Chip8Const::buttons; ++key_i)
+    std::uint64_t next{ std::numeric_limits<std::uint64_t>::max() };
+    for(const Event& event : m_events)
     {
-        if(m_key_states[key_i] == KeyState::JUST_RELEASED)
+        bool matters{ event.type == EventType::KEY };
+        matters |= event.type == EventType::FRAME && (m_timer_mode == Timer::Mode::VIRTUAL || conditions.vblank);
+        matters |= event.type == EventType::AUDIO && conditions.audio;
+        if(matters)
         {
-            key = key_i;
-            break;
+            next = std::min(next, event.cycle);
         }
     }
-    if(key >= Chip8Const::buttons)
+    return next;
+}
+
+void Chip8::recordRewind(std::uint64_t frames)
+{
+    if(!m_rewind.isEnabled())
     {
-        m_PC -= 2;
+        return;
     }
-    else
+    if(frames < m_frames_until_snapshot)
     {
-        m_regs.write(instruction.getNibble(1), key);
+        m_frames_until_snapshot -= frames;
+        return;
     }
-}
 
-// FX29 - set the I register to the address of hexadecimal character in VX
-void Chip8::_FX29(const Instruction<Chip8_t::Word>& instruction)
-{
-    // Get the second nibble (index 1)
-    Chip8_t::Byte m_char{ m_regs.read(instruction.getNibble(1)) };
-    m_char = m_char % (0xF+1);
-
-    // Set I to the font location
-    m_I = Chip8Const::font_begin + m_char * 5;
+    MachineState state{};
+    saveState(state);
+    m_rewind.push({ reinterpret_cast<const std::uint8_t*>(&state), sizeof(state) });
+    m_frames_until_snapshot = m_frames_per_snapshot;
 }
 
-// FX33 - Take the number in VX, divide to 3 dec numbers (139 - 1, 3, 9), then store them in I, I+1, I+2
-void Chip8::_FX33(const Instruction<Chip8_t::Word>& instruction)
+Chip8::StopReason Chip8::serviceEvents(const StopConditions& conditions)
 {
-    Chip8_t::Byte num{ m_regs.read(instruction.getNibble(1)) };
-    for(char i{2}; i >= 0; --i)
+    // With wall clock timers a frame of the history is 1/60 of a second of real time, however many instructions ran in it
+    if(m_rewind.isEnabled() && m_timer_mode == Timer::Mode::WALL_CLOCK)
     {
-        if(m_I + i >= m_memory.getSize())
+        std::int64_t tick{ Timer::getTime() * 60 / 1000 };
+        if(tick > m_rewind_tick)
         {
-            std::cout << "FX33 ATTEMPTED TO WRITE MEMORY OUT OF BOUNDS!\n";
-            break;
+            recordRewind(tick - m_rewind_tick);
+            m_rewind_tick = tick;
+        }
+    }
+
+    StopReason stop{ StopReason::BUDGET };
+    while(!m_events.empty() && m_events.front().cycle <= m_cycles)
+    {
+        std::pop_heap(m_events.begin(), m_events.end(), eventLater);
+        Event event{ m_events.back() };
+        m_events.pop_back();
+        m_event_cycle = m_cycles;
+
+        switch(event.type)
+        {
+            case EventType::FRAME:
+            {
+                std::uint64_t frames{ (m_cycles - event.cycle) / m_instructions_per_frame + 1 };
+                m_delay_timer.tick(frames);
+                m_sound_timer.tick(frames);
+                scheduleEvent({ event.cycle + frames * m_instructions_per_frame, 0, EventType::FRAME });
+                if(m_timer_mode == Timer::Mode::VIRTUAL)
+                {
+                    recordRewind(frames);
+                }
+                if(conditions.vblank && stop == StopReason::BUDGET)
+                {
+                    stop = StopReason::VBLANK;
+                }
+                break;
+            }
+            case EventType::AUDIO:
+            {
+                std::uint64_t buffers{ (m_cycles - event.cycle) / m_cycles_per_audio_buffer + 1 };
+                scheduleEvent({ event.cycle + buffers * m_cycles_per_audio_buffer, 0, EventType::AUDIO });
+                if(conditions.audio && stop == StopReason::BUDGET)
+                {
+                    stop = StopReason::AUDIO;
+                }
+                break;
+            }
+            case EventType::KEY:
+            {
+                setKeyState(event.key, event.state);
+                break;
+            }
         }
-        m_memory.write(m_I + i, num % 10);
-        num /= 10;
     }
+    return stop;
 }
 
-// FX55 - Set memory in I, to I+X with the values of V0 to VX
-void Chip8::_FX55(const Instruction<Chip8_t::Word>& instruction)
+bool Chip8::endSlice(RunResult& result, std::uint64_t end, const StopConditions& conditions)
 {
-    for(int i{}; i <= instruction.getNibble(1); ++i)
+    // The ROM can't go on, the PC points at the instruction that failed
+    if(m_stop == StopReason::STACK_OVERFLOW || m_stop == StopReason::STACK_UNDERFLOW)
     {
-        if(m_I + i >= m_memory.getSize())
+        result.reason = m_stop;
+        return true;
+    }
+
+    // Nothing changes until a key or the delay timer does, the time would only be spent going around the same loop,
+    // so skip straight to the next event that could change something (or the end, the reason says what it was waiting for)
+    result.reason = StopReason::BUDGET;
+    if(m_stop == StopReason::KEY_WAIT && conditions.key_wait)
+    {
+        std::uint64_t target{ std::min(end, nextEventCycle(conditions)) };
+        result.elided += target - m_cycles;
+        result.reason = m_stop;
+        m_cycles = target;
+    }
+    else if(m_stop == StopReason::IDLE && conditions.idle && m_idle_head == m_PC && m_idle_cycle + m_idle_loop_length == m_cycles &&
+            m_event_cycle <= m_idle_cycle)
+    {
+        // The whole loop ran once from the start since the last event, so every time around it does the same until the
+        // next one. The PC is back at the start, only whole times around it are skipped and the rest of the way is
+        // emulated, so the PC at the event is where it would be without skipping. None of it is the jump back
+        std::uint64_t target{ std::min(end, nextEventCycle(conditions)) };
+        std::uint64_t skipped{ (target - m_cycles) / m_idle_loop_length * m_idle_loop_length };
+        result.elided += skipped;
+        result.reason = m_stop;
+        m_cycles += skipped;
+        while(m_cycles < target)
         {
-            std::cout << "FX55 - ATTEMPTED TO WRITE MEMORY OUT OF BOUNDS!\n";
-            break;
+            step();
+            ++result.executed;
+            ++m_cycles;
         }
-        m_memory.write(m_I + i, m_regs.read(i));
+    }
+    if(m_stop == StopReason::IDLE)
+    {
+        m_idle_head = m_PC;
+        m_idle_cycle = m_cycles;
     }
 
-    if(m_behaviour == Chip8::BehaviourType::CHIP8)
+    StopReason stop{ serviceEvents(conditions) };
+    if(stop != StopReason::BUDGET)
     {
-        m_I += instruction.getNibble(1) + 1;
+        result.reason = stop;
+        return true;
     }
+    return false;
 }
 
-// FX65 - Set V0 to VX, with the value from memory of I to I+X
-void Chip8::_FX65(const Instruction<Chip8_t::Word>& instruction)
+std::size_t Chip8::getIdleLoopLength(Chip8_t::Word head, Chip8_t::Word jump)
 {
-    for(int i{}; i <= instruction.getNibble(1); ++i)
+    std::size_t count{ (std::size_t)(jump - head) / 2 };
+    if(head > jump || (jump - head) % 2 != 0 || count > max_idle_loop_length)
     {
-        if(m_I + i >= m_memory.getSize())
-        {
-            std::cout << "FX65 - ATTEMPTED TO READ MEMORY OUT OF BOUNDS!\n";
-            break;
-        }
-        m_regs.write(i, m_memory.read(m_I + i));
+        return 0;
     }
 
-    if(m_behaviour == Chip8::BehaviourType::CHIP8)
+    std::array<Chip8_t::Word, max_idle_loop_length> body{};
+    for(std::size_t i{}; i < count; ++i)
     {
-        m_I += instruction.getNibble(1) + 1;
+        Chip8_t::Word address{ (Chip8_t::Word)(head + i * 2) };
+        body[i] = (m_memory.read(address) << 8) | m_memory.read(address + 1);
     }
+
+    return isIdleLoop(body.data(), count) ? count + 1 : 0;
 }
 
-// --- Private member functions ---
+void Chip8::checkI()
+{
+    if(m_I >= Chip8Const::mem_size)
+    {
+        printf("I (%04X) out of bounds! Setting it to 0xFFF - 1!\n", m_I);
+        m_I = Chip8Const::mem_size - 2;
+    }
+}
 
-void Chip8::jumpTo(Chip8_t::Word location)
+const Chip8::DispatchTable& Chip8::getDecodeTable()
 {
-    m_PC = location;
+    static const DispatchTable table{ []()
+    {
+        // Every valid name returned by decode, paired with the function that executes it
+        struct Entry
+        {
+            const char* name;
+            OpType type;
+            OpHandler handler;
+        };
+
+        static constexpr Entry entries[]
+        {
+            {"00E0", OpType::_00E0, &Chip8::_00E0},
+            {"00EE", OpType::_00EE, &Chip8::_00EE},
+            {"0NNN", OpType::_0NNN, &Chip8::_0NNN},
+            {"1NNN", OpType::_1NNN, &Chip8::_1NNN},
+            {"2NNN", OpType::_2NNN, &Chip8::_2NNN},
+            {"3XNN", OpType::_3XNN, &Chip8::_3XNN},
+            {"4XNN", OpType::_4XNN, &Chip8::_4XNN},
+            {"5XY0", OpType::_5XY0, &Chip8::_5XY0},
+            {"6XNN", OpType::_6XNN, &Chip8::_6XNN},
+            {"7XNN", OpType::_7XNN, &Chip8::_7XNN},
+            {"8XY0", OpType::_8XY0, &Chip8::_8XY0},
+            {"8XY1", OpType::_8XY1, &Chip8::_8XY1<Quirks::Cosmac>},
+            {"8XY2", OpType::_8XY2, &Chip8::_8XY2<Quirks::Cosmac>},
+            {"8XY3", OpType::_8XY3, &Chip8::_8XY3<Quirks::Cosmac>},
+            {"8XY4", OpType::_8XY4, &Chip8::_8XY4},
+            {"8XY5", OpType::_8XY5, &Chip8::_8XY5},
+            {"8XY6", OpType::_8XY6, &Chip8::_8XY6<Quirks::Cosmac>},
+            {"8XY7", OpType::_8XY7, &Chip8::_8XY7},
+            {"8XYE", OpType::_8XYE, &Chip8::_8XYE<Quirks::Cosmac>},
+            {"9XY0", OpType::_9XY0, &Chip8::_9XY0},
+            {"ANNN", OpType::_ANNN, &Chip8::_ANNN},
+            {"BXNN", OpType::_BXNN, &Chip8::_BXNN<Quirks::Cosmac>},
+            {"CXNN", OpType::_CXNN, &Chip8::_CXNN},
+            {"DXYN", OpType::_DXYN, &Chip8::_DXYN<Quirks::Cosmac>},
+            {"EX9E", OpType::_EX9E, &Chip8::_EX9E},
+            {"EXA1", OpType::_EXA1, &Chip8::_EXA1},
+            {"FX07", OpType::_FX07, &Chip8::_FX07},
+            {"FX0A", OpType::_FX0A, &Chip8::_FX0A},
+            {"FX15", OpType::_FX15, &Chip8::_FX15},
+            {"FX18", OpType::_FX18, &Chip8::_FX18},
+            {"FX1E", OpType::_FX1E, &Chip8::_FX1E},
+            {"FX29", OpType::_FX29, &Chip8::_FX29},
+            {"FX33", OpType::_FX33, &Chip8::_FX33},
+            {"FX55", OpType::_FX55, &Chip8::_FX55<Quirks::Cosmac>},
+            {"FX65", OpType::_FX65, &Chip8::_FX65<Quirks::Cosmac>},
+        };
+
+        DispatchTable result{};
+        for(std::uint32_t opcode{}; opcode < opcode_amount; ++opcode)
+        {
+            Instruction<Chip8_t::Word> instruction{ (Chip8_t::Word)opcode };
+            DecodedOp& op{ result[opcode] };
+
+            // Extract all operands up front, each handler only uses the ones it needs
+            op.opcode = (Chip8_t::Word)opcode;
+            op.nnn = instruction.getNNN();
+            op.x = instruction.getX();
+            op.y = instruction.getY();
+            op.n = instruction.getN();
+            op.nn = instruction.getNN();
+            op.type = OpType::INVALID;
+            op.handler = &Chip8::invalidOp;
+
+            // Classify using the same decoder that the debugger sees, so both always agree
+            std::string name{ decode(instruction) };
+            for(const Entry& entry : entries)
+            {
+                if(name == entry.name)
+                {
+                    op.type = entry.type;
+                    op.handler = entry.handler;
+                    break;
+                }
+            }
+        }
+
+        return result;
+    }() };
+
+    return table;
 }
 
-Instruction<Chip8_t::Word> Chip8::fetch()
+const Chip8::DispatchTable& Chip8::getDispatchTable(std::uint8_t flags)
 {
-    Instruction<Chip8_t::Word> operation{ std::array<Chip8_t::Byte, 2>{m_memory.read(m_PC), m_memory.read(m_PC + 1)} };
-    m_PC += 2;
+    // One getter per combination of the flags, the tables themselves are still only built when they're first used
+    static constexpr auto getters{ []<std::size_t... Flags>(std::index_sequence<Flags...>)
+    {
+        return std::array<const DispatchTable& (*)(), sizeof...(Flags)>{ &getDispatchTable<Quirks::Policy<Flags>>... };
+    }(std::make_index_sequence<Quirks::all_flags + 1>{}) };
 
-    return operation;
+    return getters[flags & Quirks::all_flags]();
 }
 
+// --- Constructors ----
+
+Chip8::Chip8() : 
+//    m_memory{Chip8Const::mem_size},
+//    m_display{Chip8Const::screen_width, Chip8Const::screen_height},
+//    m_PC{},
+//    m_I{},/
+//    m_stack{},
+//    m_delay_timer{},
+//    m_sound_timer{}, 
+//    m_regs{},
+//    m_key_states{},
+    m_behaviour{Chip8::BehaviourType::CHIP8},
+    m_dispatch{getDispatchTable<Quirks::Cosmac>().data()}
+{
+    clearMemory();
+}
+
+// --- Static functions ---
+
 std::string Chip8::decode(const Instruction<Chip8_t::Word>& instruction)
 {
     std::string result{};
-    // Decode & execute
-    switch(instruction.getNibble(0))
+    // Decode
+    switch(instruction.getOpClass())
     {
         case 0x0:
         {
             // Possible instructions:
             // 00E0 - Clear screen
             // 00EE - Set PC to the value at top of the stack
-            switch (instruction.getNibbles(2, 3))
+            switch (instruction.getNN())
             {
                 // 00E0 - Clear screen
                 case 0xE0:
@@ -505,7 +901,7 @@ std::string Chip8::decode(const Instruction<Chip8_t::Word>& instruction)
         {
             // Possible instructions:
             // 5XY0 - Skip if values in VX == VY
-            if(instruction.getNibble(3) != 0x0)
+            if(instruction.getN() != 0x0)
             {
                 break;
             }
@@ -545,7 +941,7 @@ std::string Chip8::decode(const Instruction<Chip8_t::Word>& instruction)
             // Beh1:    set VX to VY
             // Beh2:    ignore VY
             // Then:    Shift VX one bit to the left, set VF to 1 if the bit shifted out was 1, or 0 if was 0
-            switch (instruction.getNibble(3))
+            switch (instruction.getN())
             {
                 // 8XY0 - VX is set to VY
                 case 0x0:
@@ -620,7 +1016,7 @@ std::string Chip8::decode(const Instruction<Chip8_t::Word>& instruction)
         {
             // Possible instructions:
             // 9XY0 - Skip one instruction if values in VX != VY
-            if(instruction.getNibble(3) != 0x0)
+            if(instruction.getN() != 0x0)
             {
                 break;
             }
@@ -662,7 +1058,7 @@ std::string Chip8::decode(const Instruction<Chip8_t::Word>& instruction)
             // EX9E - Skip one instruction if the key corresponding to value in VX is pressed
             // EXA1 - Skip one instruction if the key corresponding to value in VX is not pressed
 
-            Chip8_t::Word val{ (Chip8_t::Byte) (instruction.getNibbles(2, 3)) };
+            Chip8_t::Word val{ instruction.getNN() };
             switch (val)
             {
                 // EX9E - Skip one instruction if the key corresponding to value in VX is pressed
@@ -693,7 +1089,7 @@ std::string Chip8::decode(const Instruction<Chip8_t::Word>& instruction)
             // FX33 - Take the number in VX, divide to 3 dec numbers (139 - 1, 3, 9), then store them in I, I+1, I+2
             // FX55 - Set memory in I, to I+X with the values of V0 to VX
             // FX65 - Set V0 to VX, with the value from memory of I to I+X
-            Chip8_t::Byte val{ (Chip8_t::Byte) (instruction.getNibbles(2, 3)) };
+            Chip8_t::Byte val{ instruction.getNN() };
 
             switch (val)
             {
@@ -767,79 +1163,91 @@ std::string Chip8::decode(const Instruction<Chip8_t::Word>& instruction)
     return result;
 }
 
-void Chip8::execute(const std::string& which, const Instruction<Chip8_t::Word>& instruction)
+const Chip8::DecodedOp& Chip8::decodeOp(Chip8_t::Word opcode)
 {
-    if(m_exec_map.find(which) == m_exec_map.end())
+    return getDecodeTable()[opcode];
+}
+
+bool Chip8::isIdleLoop(const Chip8_t::Word* body, std::size_t count)
+{
+    if(count > max_idle_loop_length)
     {
-        printf("INVALID INSTRUCTION %s ORIGINATING FROM %04X\n", which.c_str(), instruction.get());
-        return;
+        return false;
     }
 
-    (m_exec_map.at(which))(instruction);
+    for(std::size_t i{}; i < count; ++i)
+    {
+        switch(getDecodeTable()[body[i]].type)
+        {
+            // Always set the register to the same thing while the delay timer stays the same
+            case OpType::_6XNN:
+            case OpType::_ANNN:
+            case OpType::_FX07:
+            {
+                break;
+            }
+            // A skip anywhere else could take a different path the next time around
+            case OpType::_3XNN:
+            case OpType::_4XNN:
+            case OpType::_5XY0:
+            case OpType::_9XY0:
+            case OpType::_EX9E:
+            case OpType::_EXA1:
+            {
+                if(i + 1 != count)
+                {
+                    return false;
+                }
+                break;
+            }
+            default:
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
 }
 
-// --- Constructors ----
+// --- Member functions ---
 
-Chip8::Chip8() : 
-//    m_memory{Chip8Const::mem_size},
-//    m_display{Chip8Const::screen_width, Chip8Const::screen_height},
-//    m_PC{},
-//    m_I{},/
-//    m_stack{},
-//    m_delay_timer{},
-//    m_sound_timer{}, 
-//    m_regs{},
-//    m_key_states{},
-    m_behaviour{Chip8::BehaviourType::CHIP8}
+void Chip8::setBehaviourType(Chip8::BehaviourType type)
 {
-    clearMemory();
+    m_behaviour = type;
 
-    // Initalize exec map
-    m_exec_map = 
+    if(type == Chip8::BehaviourType::CHIP8)
     {
-        {"00E0", std::bind(&Chip8::_00E0, this, std::placeholders::_1)},
-        {"00EE", std::bind(&Chip8::_00EE, this, std::placeholders::_1)},
-        {"0NNN", std::bind(&Chip8::_0NNN, this, std::placeholders::_1)},
-        {"1NNN", std::bind(&Chip8::_1NNN, this, std::placeholders::_1)},
-        {"2NNN", std::bind(&Chip8::_2NNN, this, std::placeholders::_1)},
-        {"3XNN", std::bind(&Chip8::_3XNN, this, std::placeholders::_1)},
-        {"4XNN", std::bind(&Chip8::_4XNN, this, std::placeholders::_1)},
-        {"5XY0", std::bind(&Chip8::_5XY0, this, std::placeholders::_1)},
-        {"6XNN", std::bind(&Chip8::_6XNN, this, std::placeholders::_1)},
-        {"7XNN", std::bind(&Chip8::_7XNN, this, std::placeholders::_1)},
-        {"8XY0", std::bind(&Chip8::_8XY0, this, std::placeholders::_1)},
-        {"8XY1", std::bind(&Chip8::_8XY1, this, std::placeholders::_1)},
-        {"8XY2", std::bind(&Chip8::_8XY2, this, std::placeholders::_1)},
-        {"8XY3", std::bind(&Chip8::_8XY3, this, std::placeholders::_1)},
-        {"8XY4", std::bind(&Chip8::_8XY4, this, std::placeholders::_1)},
-        {"8XY5", std::bind(&Chip8::_8XY5, this, std::placeholders::_1)},
-        {"8XY6", std::bind(&Chip8::_8XY6, this, std::placeholders::_1)},
-        {"8XY7", std::bind(&Chip8::_8XY7, this, std::placeholders::_1)},
-        {"8XYE", std::bind(&Chip8::_8XYE, this, std::placeholders::_1)},
-        {"9XY0", std::bind(&Chip8::_9XY0, this, std::placeholders::_1)},
-        {"ANNN", std::bind(&Chip8::_ANNN, this, std::placeholders::_1)},
-        {"BXNN", std::bind(&Chip8::_BXNN, this, std::placeholders::_1)},
-        {"CXNN", std::bind(&Chip8::_CXNN, this, std::placeholders::_1)},
-        {"DXYN", std::bind(&Chip8::_DXYN, this, std::placeholders::_1)},
-        {"EX9E", std::bind(&Chip8::_EX9E, this, std::placeholders::_1)},
-        {"EXA1", std::bind(&Chip8::_EXA1, this, std::placeholders::_1)},
-        {"FX07", std::bind(&Chip8::_FX07, this, std::placeholders::_1)},
-        {"FX0A", std::bind(&Chip8::_FX0A, this, std::placeholders::_1)},
-        {"FX15", std::bind(&Chip8::_FX15, this, std::placeholders::_1)},
-        {"FX18", std::bind(&Chip8::_FX18, this, std::placeholders::_1)},
-        {"FX1E", std::bind(&Chip8::_FX1E, this, std::placeholders::_1)},
-        {"FX29", std::bind(&Chip8::_FX29, this, std::placeholders::_1)},
-        {"FX33", std::bind(&Chip8::_FX33, this, std::placeholders::_1)},
-        {"FX55", std::bind(&Chip8::_FX55, this, std::placeholders::_1)},
-        {"FX65", std::bind(&Chip8::_FX65, this, std::placeholders::_1)},
-    };
+        setQuirks<Quirks::Cosmac>();
+    }
+    else
+    {
+        setQuirks<Quirks::SuperChip>();
+    }
 }
 
-// --- Member functions ---
+void Chip8::setQuirkFlags(std::uint8_t flags)
+{
+    m_quirks = flags & Quirks::all_flags;
+    m_dispatch = getDispatchTable(m_quirks).data();
 
-void Chip8::setBehaviourType(Chip8::BehaviourType type)
+    // Same as setQuirks
+    invalidateDecodeCache();
+}
+
+std::uint8_t Chip8::getQuirks()
 {
-    m_behaviour = type;
+    return m_quirks;
+}
+
+void Chip8::setBackend(Chip8::Backend backend)
+{
+    m_backend = backend;
+}
+
+Chip8::Backend Chip8::getBackend()
+{
+    return m_backend;
 }
 
 bool Chip8::loadMemory(const std::string& path)
@@ -851,55 +1259,62 @@ bool Chip8::loadMemory(const std::string& path)
         return false;
     }
 
-    // Write file contents to memory
-    Chip8_t::Byte byte{};
-    Chip8_t::Word index{Chip8Const::rom_mem_start};
-    while(file.read(reinterpret_cast<char*>(&byte), 1))
-    {
-        m_memory.write(index, byte);
-        ++index;
-        if(index >= 4096)
-        {
-            break;
-        }
-    }
-
+    // Only what fits in the memory is read
+    std::array<Chip8_t::Byte, Chip8Const::mem_size - Chip8Const::rom_mem_start> rom{};
+    file.read(reinterpret_cast<char*>(rom.data()), rom.size());
+    std::size_t size{ (std::size_t)file.gcount() };
     file.close();
+
+    loadMemory(std::span<const Chip8_t::Byte>{ rom.data(), size });
     return true;
 }
 
-void Chip8::clearMemory()
+void Chip8::loadMemory(std::span<const Chip8_t::Byte> rom)
 {
-    Chip8_t::Byte m_font[]
+    // Write the ROM to memory, whatever doesn't fit is left out
+    std::span<Chip8_t::Byte> memory{ m_memory.view().subspan(Chip8Const::rom_mem_start) };
+    rom = rom.first(std::min(rom.size(), memory.size()));
+    std::copy(rom.begin(), rom.end(), memory.begin());
+
+    // FNV-1a of what was loaded
+    m_rom_hash = 0xCBF29CE484222325;
+    for(Chip8_t::Byte byte : rom)
     {
-        0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
-        0x20, 0x60, 0x20, 0x20, 0x70, // 1
-        0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-        0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-        0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-        0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-        0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-        0xF0, 0x10, 0x20, 0x40, 0x40, // 7
-        0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
-        0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
-        0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-        0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-        0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-        0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-        0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-        0xF0, 0x80, 0xF0, 0x80, 0x80  // F
-    };
+        m_rom_hash = (m_rom_hash ^ byte) * 0x100000001B3;
+    }
 
-    // Set base memory
-    m_memory = {Chip8Const::mem_size};
+    invalidateDecodeCache();
+    revalidateAot();
+}
 
-    for(int i{}; i < 80; ++i)
-    {
-        m_memory.write(Chip8Const::font_begin + i,  m_font[i]);
-    }
+std::uint64_t Chip8::getRomHash()
+{
+    return m_rom_hash;
+}
+
+void Chip8::setSeed(std::uint64_t seed)
+{
+    m_seed = seed;
+    m_random.seed(seed);
+}
+
+std::uint64_t Chip8::getSeed()
+{
+    return m_seed;
+}
+
+void Chip8::clearMemory()
+{
+    // Set base memory
+    m_memory.clear();
+    std::copy(Chip8Const::font.begin(), Chip8Const::font.end(), m_memory.view().begin() + Chip8Const::font_begin);
+    invalidateDecodeCache();
 
     // Set display
-    m_display = {Chip8Const::screen_width, Chip8Const::screen_height};
+    m_display.setAll(false);
+
+    m_rom_hash = 0;
+    m_random.seed(m_seed);
 
     // Set PC
     m_PC = Chip8Const::rom_mem_start;
@@ -911,87 +1326,211 @@ void Chip8::clearMemory()
     m_stack = {};
 
     // Set timers
-    m_delay_timer = {};
-    m_sound_timer = {};
+    m_delay_timer = Timer{ m_timer_mode };
+    m_sound_timer = Timer{ m_timer_mode };
+
+    // Queued keys and the history are for the old ROM, which ran for a different amount of cycles
+    m_cycles = 0;
+    m_events.clear();
+    resetEvents();
+    m_rewind.clear();
 
     // Set regs
-    m_regs = {Chip8Const::reg_amount};
+    m_regs = {};
 
     // Key states
     for(int i{}; i < Chip8Const::buttons; ++i)
     {
         m_key_states[i] = Chip8::KeyState::UP;
     }
+
+    revalidateAot();
 }
 
-Chip8::SaveState Chip8::getSaveState()
-{
-    SaveState state{};
+// A snapshot is a plain copy, so rewinding and forking don't allocate
+static_assert(std::is_trivially_copyable_v<Chip8::MachineState>, "MachineState has to be copyable with memcpy");
 
-    // Save memory
-    /*
-    for(Chip8_t::Word i{}; i < Chip8Const::mem_size; ++i)
-    {
-        state.memory.write(i, m_memory.read(i));
-    }
-    */
+void Chip8::saveState(MachineState& state)
+{
     state.memory = m_memory;
-
-    // Save display
-    /*
-    for(Chip8_t::Word y{}; y < Chip8Const::screen_height; ++y)
+    state.display = m_display;
+    state.stack = m_stack;
+    state.regs = m_regs;
+    state.PC = m_PC;
+    state.I = m_I;
+    state.delay_timer = m_delay_timer.get();
+    state.sound_timer = m_sound_timer.get();
+    state.keys = m_key_states;
+    state.behaviour = m_behaviour;
+    state.quirks = m_quirks;
+    state.timer_mode = m_timer_mode;
+    state.instructions_per_frame = m_instructions_per_frame;
+    state.cycles_per_audio_buffer = m_cycles_per_audio_buffer;
+    state.cycles = m_cycles;
+    state.rom_hash = m_rom_hash;
+    state.seed = m_seed;
+    state.random = m_random;
+
+    // Only the periodic events are state, the keys are input
+    state.next_frame = m_cycles + m_instructions_per_frame;
+    state.next_audio = 0;
+    for(const Event& event : m_events)
     {
-        for(Chip8_t::Word x{}; x < Chip8Const::screen_width; ++x)
+        if(event.type == EventType::FRAME)
         {
-            state.display.setPixel(x, y, m_display.getPixel(x, y));
+            state.next_frame = event.cycle;
+        }
+        else if(event.type == EventType::AUDIO)
+        {
+            state.next_audio = event.cycle;
         }
     }
-    */
-    state.display = m_display;
+}
 
-    // Save PC & I
-    state.PC = m_PC;
-    state.I = m_I;
+void Chip8::loadState(const MachineState& state)
+{
+    m_memory = state.memory;
+    m_display.restore(state.display);
+    m_stack = state.stack;
+    m_regs = state.regs;
+    m_PC = state.PC;
+    m_I = state.I;
 
-    // Save stack
-    state.stack = m_stack;
+    m_timer_mode = state.timer_mode;
+    m_delay_timer = Timer{ m_timer_mode };
+    m_delay_timer.set(state.delay_timer);
+    m_sound_timer = Timer{ m_timer_mode };
+    m_sound_timer.set(state.sound_timer);
 
-    // Save regs
-    state.regs = m_regs;
+    m_key_states = state.keys;
+    m_behaviour = state.behaviour;
+    if(state.quirks != m_quirks)
+    {
+        setQuirkFlags(state.quirks);
+    }
 
-    return state;
+    m_instructions_per_frame = std::max<std::uint32_t>(state.instructions_per_frame, 1);
+    m_cycles_per_audio_buffer = state.cycles_per_audio_buffer;
+    m_cycles = state.cycles;
+    m_rom_hash = state.rom_hash;
+    m_seed = state.seed;
+    m_random.setState(state.random.getState());
+    m_idle_head = 0;
+    m_event_cycle = m_cycles;
+    m_events.clear();
+    scheduleEvent({ state.next_frame, 0, EventType::FRAME });
+    if(m_cycles_per_audio_buffer > 0)
+    {
+        scheduleEvent({ state.next_audio > 0 ? state.next_audio : m_cycles + m_cycles_per_audio_buffer, 0, EventType::AUDIO });
+    }
+
+    // The code may be different
+    invalidateDecodeCache();
+    revalidateAot();
 }
 
-void Chip8::loadSaveState(Chip8::SaveState state)
+void Chip8::setRewind(std::size_t budget, std::uint32_t frames)
 {
-    m_memory = state.memory;
-    m_display = state.display;
-    m_PC = state.PC;
-    m_I = state.I;
-    m_stack = state.stack;
-    m_regs = state.regs;
+    m_rewind = budget > 0 ? Rewind{ budget, sizeof(MachineState), rewind_keyframe_interval } : Rewind{};
+    m_frames_per_snapshot = std::max<std::uint32_t>(frames, 1);
+    m_frames_until_snapshot = m_frames_per_snapshot;
+    m_rewind_tick = Timer::getTime() * 60 / 1000;
+}
+
+bool Chip8::rewind()
+{
+    MachineState state{};
+    if(!m_rewind.pop({ reinterpret_cast<std::uint8_t*>(&state), sizeof(state) }))
+    {
+        return false;
+    }
+    loadState(state);
+    m_frames_until_snapshot = m_frames_per_snapshot;
+    // The time spent going back doesn't count towards the next snapshot
+    m_rewind_tick = Timer::getTime() * 60 / 1000;
+    return true;
+}
 
+std::size_t Chip8::getRewindLength()
+{
+    return m_rewind.getCount();
 }
 
 void Chip8::emulateStep()
 {
-    // Fetch
-    Instruction<Chip8_t::Word> operation{fetch()};
+    // Through run, so the clock moves on and the events of the cycle (timers, keys, rewind) are serviced
+    run(1);
+}
 
-    // Ensure PC and I validness
-    if(m_PC >= Chip8Const::mem_size)
+void Chip8::emulateSteps(std::uint64_t amount)
+{
+    // Stopping to wait for a key is fine, the rest of the instructions would only execute the same FX0A again
+    run(amount);
+}
+
+Chip8::RunResult Chip8::run(std::uint64_t max_instructions)
+{
+    return run(max_instructions, StopConditions{});
+}
+
+Chip8::RunResult Chip8::run(std::uint64_t max_instructions, const StopConditions& conditions)
+{
+    if(conditions.frame || conditions.breakpoints != nullptr)
     {
-        printf("PC (%04X) out of bounds! Setting it to 0xFFF - 1!\n", m_PC);
-        m_PC = Chip8Const::mem_size - 2;
+        return runChecked(max_instructions, conditions);
     }
-    if(m_I >= Chip8Const::mem_size)
+
+    RunResult result{ StopReason::BUDGET, 0, 0 };
+    std::uint64_t end{ m_cycles + max_instructions };
+
+    // Keys queued for now, the rest of the events were serviced at the end of the last run
+    serviceEvents(conditions);
+    while(m_cycles < end)
     {
-        printf("I (%04X) out of bounds! Setting it to 0xFFF - 1!\n", m_PC);
-        m_I = Chip8Const::mem_size - 2;
+        m_stop = StopReason::BUDGET;
+
+        // Every backend stops right before the next event, so it happens at the same instruction for all of them
+        std::uint64_t left{ std::min(end, nextEventCycle(conditions)) - m_cycles };
+        std::uint64_t executed{};
+        switch(m_backend)
+        {
+            case Chip8::Backend::CACHED_BLOCKS:
+            {
+                executed = emulateBlocks(left);
+                break;
+            }
+            case Chip8::Backend::JIT:
+            {
+                executed = emulateJit(left);
+                break;
+            }
+            case Chip8::Backend::AOT:
+            {
+                executed = emulateAot(left);
+                break;
+            }
+            case Chip8::Backend::THREADED:
+            {
+                executed = emulateThreaded(left);
+                break;
+            }
+            default:
+            {
+                executed = emulateInterpreter(left);
+                break;
+            }
+        }
+
+        result.executed += executed;
+        m_cycles += executed;
+
+        if(endSlice(result, end, conditions))
+        {
+            break;
+        }
     }
 
-    // Decode & Execute
-    execute(decode(operation), operation);
+    return result;
 }
 
 bool Chip8::getPixel(Chip8_t::Byte x, Chip8_t::Byte y)
@@ -999,6 +1538,21 @@ bool Chip8::getPixel(Chip8_t::Byte x, Chip8_t::Byte y)
     return m_display.getPixel(x, y);
 }
 
+std::uint64_t Chip8::getDisplayGeneration()
+{
+    return m_display.getGeneration();
+}
+
+std::uint64_t Chip8::takeDisplayDirtyRows()
+{
+    return m_display.takeDirtyRows();
+}
+
+Display::Row Chip8::getDisplayRow(Chip8_t::Word y)
+{
+    return m_display.getRow(y);
+}
+
 void Chip8::setKeyState(Chip8_t::Byte which, Chip8::KeyState state)
 {
     m_key_states[which] = state;
@@ -1034,7 +1588,7 @@ Chip8_t::Byte Chip8::getReg(Chip8_t::Byte which)
     return m_regs.read(which);
 }
 
-std::stack<Chip8_t::Word> Chip8::getStackCopy()
+Chip8::StackType Chip8::getStackCopy()
 {
     return m_stack;
 }
@@ -1044,6 +1598,50 @@ std::uint8_t Chip8::getDelayTimerValue()
     return m_delay_timer.get();
 }
 
+std::int64_t Chip8::getTimeUntilDelayTick()
+{
+    return m_delay_timer.getTimeUntilTick();
+}
+
+void Chip8::setTimerMode(Timer::Mode mode)
+{
+    m_timer_mode = mode;
+    m_delay_timer.setMode(mode);
+    m_sound_timer.setMode(mode);
+}
+
+Timer::Mode Chip8::getTimerMode()
+{
+    return m_timer_mode;
+}
+
+void Chip8::setInstructionsPerFrame(std::uint32_t amount)
+{
+    m_instructions_per_frame = std::max<std::uint32_t>(amount, 1);
+    resetEvents();
+}
+
+std::uint32_t Chip8::getInstructionsPerFrame()
+{
+    return m_instructions_per_frame;
+}
+
+std::uint64_t Chip8::getCycles()
+{
+    return m_cycles;
+}
+
+void Chip8::queueKeyEvent(std::uint64_t cycle, Chip8_t::Byte which, KeyState state)
+{
+    scheduleEvent({ std::max(cycle, m_cycles), 0, EventType::KEY, which, state });
+}
+
+void Chip8::setCyclesPerAudioBuffer(std::uint32_t cycles)
+{
+    m_cycles_per_audio_buffer = cycles;
+    resetEvents();
+}
+
 std::uint8_t Chip8::getSoundTimerValue()
 {
     return m_sound_timer.get();
@@ -0,0 +1,117 @@
+#include <iostream>
+#include "../header/Chip8.hpp"
+
+// The AOT backend, runs ROMs translated to C++ ahead of time by chip8-aot
+
+// --- Private member functions ---
+
+std::uint64_t Chip8::emulateAot(std::uint64_t amount)
+{
+    const Chip8AotModule* module{ m_aot.get() };
+    if(module == nullptr)
+    {
+        return emulateInterpreter(amount);
+    }
+
+    static_assert(sizeof(KeyState) == sizeof(std::int32_t), "Translated ROMs expect 4 byte key states");
+    Chip8AotContext context{};
+    context.self = this;
+    context.regs = m_regs.data();
+    context.I = &m_I;
+    context.PC = &m_PC;
+    context.keys = reinterpret_cast<const std::int32_t*>(m_key_states.data());
+    context.dirty = m_aot_dirty.data();
+    context.quirks = m_quirks;
+    context.execute = &Chip8::aotExecute;
+    context.check_i = &Chip8::aotCheckI;
+
+    std::uint64_t executed{};
+    while(executed < amount && m_stop == StopReason::BUDGET)
+    {
+        checkI();
+        std::uint64_t done{ module->run(&context, amount - executed) };
+        executed += done;
+
+        // The PC isn't at a translated block, or the block doesn't fit, interpret until it is
+        if(done == 0)
+        {
+            step();
+            ++executed;
+        }
+    }
+
+    return executed;
+}
+
+void Chip8::revalidateAot()
+{
+    const Chip8AotModule* module{ m_aot.get() };
+    if(module == nullptr)
+    {
+        return;
+    }
+
+    for(std::uint32_t i{}; i < module->block_count; ++i)
+    {
+        Chip8_t::Word start{ module->blocks[i * 2] };
+        Chip8_t::Word end{ (Chip8_t::Word)(start + module->blocks[i * 2 + 1] * 2) };
+
+        bool dirty{};
+        for(Chip8_t::Word address{start}; address < end; ++address)
+        {
+            if(m_memory.read(address) != module->rom[address - Chip8Const::rom_mem_start])
+            {
+                dirty = true;
+                break;
+            }
+        }
+        m_aot_dirty[start >> 1] = dirty;
+    }
+}
+
+void Chip8::aotExecute(void* self, std::uint16_t opcode)
+{
+    Chip8* emulator{ static_cast<Chip8*>(self) };
+    const DecodedOp& op{ emulator->m_dispatch[opcode] };
+    (emulator->*op.handler)(op);
+}
+
+void Chip8::aotCheckI(void* self, std::uint16_t pc)
+{
+    Chip8* emulator{ static_cast<Chip8*>(self) };
+    emulator->m_PC = pc;
+    emulator->checkI();
+}
+
+// --- Member functions ---
+
+bool Chip8::loadAotModule(const std::string& path)
+{
+    m_aot_lengths.fill(0);
+    m_aot_dirty.fill(0);
+
+    if(!m_aot.load(path))
+    {
+        return false;
+    }
+
+    // Make sure the blocks are ones this emulator could have discovered itself
+    const Chip8AotModule* module{ m_aot.get() };
+    for(std::uint32_t i{}; i < module->block_count; ++i)
+    {
+        Chip8_t::Word start{ module->blocks[i * 2] };
+        Chip8_t::Word length{ module->blocks[i * 2 + 1] };
+        std::uint32_t end{ start + length * 2u };
+        if(start < Chip8Const::rom_mem_start || (start & 1) != 0 || length == 0 || length > max_block_length ||
+           end > Chip8Const::rom_mem_start + module->rom_size || end > Chip8Const::mem_size - 2u)
+        {
+            std::cout << "AOT module " << path << " has an invalid block at " << start << "!\n";
+            m_aot.unload();
+            return false;
+        }
+        m_aot_lengths[start >> 1] = length;
+    }
+
+    revalidateAot();
+    return true;
+}
@@ -0,0 +1,418 @@
+#include <cstddef>
+#include <algorithm>
+#include "../header/Chip8.hpp"
+
+// The JIT backend, translates hot basic blocks to x86-64 machine code
+//
+// Registers used by the compiled blocks:
+//  r14 - the JitContext
+//  rbx - the V registers, VX is accessed as [rbx + X]
+//  r12 - the I register
+//  r15 - the key states
+//  r13 - unused, only saved to keep the stack aligned for calls
+//  rax, rcx, rdx, rsi, rdi - scratch
+//
+// Everything that needs more than a few instructions (drawing, timers, memory, the stack, key waits)
+// is done by calling back into the interpreter functions through jitCallHandler
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#define CHIP8_JIT_X64
+#endif
+
+// --- Private member functions ---
+
+std::uint64_t Chip8::emulateJit(std::uint64_t amount)
+{
+    JitContext context{ this, m_regs.data(), &m_I, &m_PC, m_key_states.data() };
+
+    std::uint64_t executed{};
+    while(executed < amount && m_stop == StopReason::BUDGET)
+    {
+        if(m_flush_blocks)
+        {
+            flushBlocks();
+        }
+
+        Block* block{ getBlock(m_PC) };
+        if(block == nullptr)
+        {
+            step();
+            ++executed;
+            continue;
+        }
+
+        // Compile the block once it's hot, only try once so a block that can't be compiled isn't retried every time
+        if(block->native == nullptr && block->hits <= jit_threshold)
+        {
+            ++block->hits;
+            if(block->hits > jit_threshold)
+            {
+                block->native = compileBlock(*block, m_PC);
+            }
+        }
+
+        // A compiled block always runs whole, so it's only used if it fits in the amount
+        std::uint64_t left{ amount - executed };
+        if(block->native != nullptr && block->op_count <= left)
+        {
+            checkI();
+            m_PC = block->native(&context);
+            executed += block->op_count;
+        }
+        else
+        {
+            std::uint64_t count{ std::min<std::uint64_t>(block->op_count, left) };
+            runBlockOps(*block, count);
+            executed += count;
+        }
+    }
+
+    return executed;
+}
+
+Chip8::JitBlockFn Chip8::compileBlock(const Block& block, Chip8_t::Word address)
+{
+#ifndef CHIP8_JIT_X64
+    (void)block;
+    (void)address;
+    return nullptr;
+#else
+    if(!m_jit_code.isAllocated() && !m_jit_code.allocate(jit_buffer_size))
+    {
+        return nullptr;
+    }
+
+    ExecutableBuffer& code{ m_jit_code };
+    const std::uint8_t ctx_self{ offsetof(JitContext, self) };
+    const std::uint8_t ctx_regs{ offsetof(JitContext, regs) };
+    const std::uint8_t ctx_I{ offsetof(JitContext, I) };
+    const std::uint8_t ctx_PC{ offsetof(JitContext, PC) };
+    const std::uint8_t ctx_keys{ offsetof(JitContext, keys) };
+    const std::uint8_t vf{ 0xF };
+    const bool vf_reset{ (m_quirks & Quirks::VF_RESET) != 0 };
+    const bool shift_vy{ (m_quirks & Quirks::SHIFT_VY) != 0 };
+    const bool jump_v0{ (m_quirks & Quirks::JUMP_V0) != 0 };
+    static_assert(sizeof(KeyState) == 4, "The compiled key checks expect 4 byte key states");
+
+    // mov rax, [r14 + offset]
+    auto loadContext{ [&](std::uint8_t offset) { code.emit({0x49, 0x8B, 0x46, offset}); } };
+
+    // Write r12 to the emulator I
+    auto storeI{ [&]() { loadContext(ctx_I); code.emit({0x66, 0x44, 0x89, 0x20}); } };
+
+    // Read the emulator I to r12
+    auto loadI{ [&]() { loadContext(ctx_I); code.emit({0x44, 0x0F, 0xB7, 0x20}); } };
+
+    // Set the emulator PC
+    auto storePC{ [&](Chip8_t::Word pc) { loadContext(ctx_PC); code.emit({0x66, 0xC7, 0x00}); code.emit16(pc); } };
+
+    // Call fn(self, arg)
+    auto callHelper{ [&](const void* fn, std::uint64_t arg)
+    {
+        code.emit({0x49, 0x8B, 0x7E, ctx_self});
+        code.emit({0x48, 0xBE});
+        code.emit64(arg);
+        code.emit({0x48, 0xB8});
+        code.emit64((std::uint64_t)fn);
+        code.emit({0xFF, 0xD0});
+    } };
+
+    // Clamp I like Chip8::checkI if it went out of bounds, pc is what the interpreter would have at that point
+    // Only needed when another instruction of the block follows, otherwise the next dispatch checks I itself
+    auto checkIAfter{ [&](Chip8_t::Word pc)
+    {
+        code.emit({0x41, 0x81, 0xFC});
+        code.emit32(Chip8Const::mem_size - 1);
+        code.emit({0x0F, 0x86});
+        std::size_t jump{ code.getPosition() };
+        code.emit32(0);
+        storeI();
+        callHelper((const void*)&Chip8::jitCheckI, pc);
+        loadI();
+        code.patch32(jump, code.getPosition() - (jump + 4));
+    } };
+
+    // Restore the saved registers and return, the next PC has to be in eax already
+    auto epilogue{ [&]() { code.emit({0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3}); } };
+
+    // Return the provided PC
+    auto exitTo{ [&](Chip8_t::Word pc)
+    {
+        storeI();
+        code.emit({0xB8});
+        code.emit32(pc);
+        epilogue();
+    } };
+
+    // Return next, or the instruction after it if 'compare' moves ecx to eax
+    auto skipIf{ [&](Chip8_t::Word next, auto compare)
+    {
+        storeI();
+        code.emit({0xB8});
+        code.emit32(next);
+        code.emit({0x8D, 0x48, 0x02});
+        compare();
+        epilogue();
+    } };
+
+    // Read VX to al, do the ALU operation on VY and write al back to VX
+    auto aluOp{ [&](std::uint8_t opcode, const DecodedOp& op)
+    {
+        code.emit({0x8A, 0x43, op.x, opcode, 0x43, op.y, 0x88, 0x43, op.x});
+        if(vf_reset)
+        {
+            code.emit({0xC6, 0x43, vf, 0x00});
+        }
+    } };
+
+    // Execute the instruction with the interpreter and return the PC it leaves behind, next is the PC after the instruction
+    auto callAndExit{ [&](const DecodedOp& op, Chip8_t::Word next)
+    {
+        storePC(next);
+        storeI();
+        callHelper((const void*)&Chip8::jitCallHandler, (std::uint64_t)&m_dispatch[op.opcode]);
+        loadContext(ctx_PC);
+        code.emit({0x0F, 0xB7, 0x00});
+        epilogue();
+    } };
+
+    std::size_t start{ code.getPosition() };
+    code.unlock();
+
+    // Prologue
+    code.emit({0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57});
+    code.emit({0x49, 0x89, 0xFE});
+    code.emit({0x49, 0x8B, 0x5E, ctx_regs});
+    code.emit({0x4D, 0x8B, 0x7E, ctx_keys});
+    loadI();
+
+    const DecodedOp* ops{ m_block_ops.data() + block.first_op };
+    Chip8_t::Word pc{ address };
+    bool exited{};
+    for(std::uint16_t i{}; i < block.op_count && !exited; ++i, pc += 2)
+    {
+        const DecodedOp& op{ ops[i] };
+        Chip8_t::Word next{ (Chip8_t::Word)(pc + 2) };
+
+        switch(op.type)
+        {
+            case OpType::_6XNN:
+            {
+                code.emit({0xC6, 0x43, op.x, op.nn});
+                break;
+            }
+            case OpType::_7XNN:
+            {
+                code.emit({0x80, 0x43, op.x, op.nn});
+                break;
+            }
+            case OpType::_8XY0:
+            {
+                code.emit({0x8A, 0x43, op.y, 0x88, 0x43, op.x});
+                break;
+            }
+            case OpType::_8XY1:
+            {
+                aluOp(0x0A, op);
+                break;
+            }
+            case OpType::_8XY2:
+            {
+                aluOp(0x22, op);
+                break;
+            }
+            case OpType::_8XY3:
+            {
+                aluOp(0x32, op);
+                break;
+            }
+            case OpType::_8XY4:
+            {
+                // VX += VY, VF = carry
+                code.emit({0x8A, 0x43, op.x, 0x02, 0x43, op.y, 0x0F, 0x92, 0xC1, 0x88, 0x43, op.x, 0x88, 0x4B, vf});
+                break;
+            }
+            case OpType::_8XY5:
+            {
+                // VX -= VY, VF = no borrow
+                code.emit({0x8A, 0x43, op.x, 0x2A, 0x43, op.y, 0x0F, 0x93, 0xC1, 0x88, 0x43, op.x, 0x88, 0x4B, vf});
+                break;
+            }
+            case OpType::_8XY7:
+            {
+                // VX = VY - VX, VF = no borrow
+                code.emit({0x8A, 0x43, op.y, 0x2A, 0x43, op.x, 0x0F, 0x93, 0xC1, 0x88, 0x43, op.x, 0x88, 0x4B, vf});
+                break;
+            }
+            case OpType::_8XY6:
+            {
+                // VX = source >> 1, VF = the bit shifted out
+                std::uint8_t source{ shift_vy ? op.y : op.x };
+                code.emit({0x8A, 0x43, source, 0x88, 0xC1, 0xD0, 0xE8, 0x80, 0xE1, 0x01, 0x88, 0x43, op.x, 0x88, 0x4B, vf});
+                break;
+            }
+            case OpType::_8XYE:
+            {
+                // VX = source << 1, VF = the bit shifted out
+                std::uint8_t source{ shift_vy ? op.y : op.x };
+                code.emit({0x8A, 0x43, source, 0x88, 0xC1, 0xD0, 0xE0, 0xC0, 0xE9, 0x07, 0x88, 0x43, op.x, 0x88, 0x4B, vf});
+                break;
+            }
+            case OpType::_ANNN:
+            {
+                code.emit({0x41, 0xBC});
+                code.emit32(op.nnn);
+                break;
+            }
+            case OpType::_FX1E:
+            {
+                // I += VX, wrapping at 16 bits like the Word it is
+                code.emit({0x0F, 0xB6, 0x43, op.x, 0x66, 0x41, 0x01, 0xC4});
+                if(i + 1 < block.op_count)
+                {
+                    checkIAfter(next + 2);
+                }
+                break;
+            }
+            case OpType::_FX29:
+            {
+                // I = font_begin + (VX & 0xF) * 5
+                code.emit({0x0F, 0xB6, 0x43, op.x, 0x83, 0xE0, 0x0F, 0x8D, 0x04, 0x80, 0x05});
+                code.emit32(Chip8Const::font_begin);
+                code.emit({0x41, 0x89, 0xC4});
+                break;
+            }
+            case OpType::_1NNN:
+            {
+                // The jump back of an idle loop goes through the interpreter, which tells the emulator to stop
+                if(op.nnn <= pc && getIdleLoopLength(op.nnn, pc) > 0)
+                {
+                    callAndExit(op, next);
+                }
+                else
+                {
+                    exitTo(op.nnn);
+                }
+                exited = true;
+                break;
+            }
+            case OpType::_BXNN:
+            {
+                storeI();
+                code.emit({0x0F, 0xB6, 0x43, jump_v0 ? (std::uint8_t)0x0 : op.x, 0x05});
+                code.emit32(op.nnn);
+                code.emit({0x25});
+                code.emit32(0xFFFF);
+                epilogue();
+                exited = true;
+                break;
+            }
+            case OpType::_3XNN:
+            {
+                skipIf(next, [&]() { code.emit({0x80, 0x7B, op.x, op.nn, 0x0F, 0x44, 0xC1}); });
+                exited = true;
+                break;
+            }
+            case OpType::_4XNN:
+            {
+                skipIf(next, [&]() { code.emit({0x80, 0x7B, op.x, op.nn, 0x0F, 0x45, 0xC1}); });
+                exited = true;
+                break;
+            }
+            case OpType::_5XY0:
+            {
+                skipIf(next, [&]() { code.emit({0x8A, 0x53, op.x, 0x3A, 0x53, op.y, 0x0F, 0x44, 0xC1}); });
+                exited = true;
+                break;
+            }
+            case OpType::_9XY0:
+            {
+                skipIf(next, [&]() { code.emit({0x8A, 0x53, op.x, 0x3A, 0x53, op.y, 0x0F, 0x45, 0xC1}); });
+                exited = true;
+                break;
+            }
+            case OpType::_EX9E:
+            {
+                skipIf(next, [&]()
+                {
+                    code.emit({0x0F, 0xB6, 0x53, op.x, 0x83, 0xE2, 0x0F, 0x41, 0x8B, 0x14, 0x97});
+                    code.emit({0x83, 0xFA, (std::uint8_t)KeyState::DOWN, 0x0F, 0x44, 0xC1});
+                });
+                exited = true;
+                break;
+            }
+            case OpType::_EXA1:
+            {
+                skipIf(next, [&]()
+                {
+                    code.emit({0x0F, 0xB6, 0x53, op.x, 0x83, 0xE2, 0x0F, 0x41, 0x8B, 0x14, 0x97});
+                    code.emit({0x83, 0xFA, (std::uint8_t)KeyState::UP, 0x0F, 0x44, 0xC1});
+                    code.emit({0x83, 0xFA, (std::uint8_t)KeyState::JUST_RELEASED, 0x0F, 0x44, 0xC1});
+                });
+                exited = true;
+                break;
+            }
+            case OpType::_2NNN:
+            case OpType::_00EE:
+            case OpType::_FX0A:
+            {
+                // These need the stack or the keys, and decide the next PC themselves
+                callAndExit(op, next);
+                exited = true;
+                break;
+            }
+            default:
+            {
+                // Everything else is executed by the interpreter
+                storePC(next);
+                storeI();
+                callHelper((const void*)&Chip8::jitCallHandler, (std::uint64_t)&m_dispatch[op.opcode]);
+                loadI();
+                if((op.type == OpType::_FX55 || op.type == OpType::_FX65) && i + 1 < block.op_count)
+                {
+                    checkIAfter(next + 2);
+                }
+                break;
+            }
+        }
+    }
+
+    if(!exited)
+    {
+        exitTo(pc);
+    }
+
+    code.lock();
+
+    // Out of space, drop everything and start over
+    if(code.hasOverflown())
+    {
+        m_flush_blocks = true;
+        return nullptr;
+    }
+
+    return (JitBlockFn)code.getAddress(start);
+#endif
+}
+
+void Chip8::jitCallHandler(Chip8* self, const DecodedOp* op)
+{
+    (self->*op->handler)(*op);
+}
+
+void Chip8::jitCheckI(Chip8* self, std::uint32_t pc)
+{
+    self->m_PC = pc;
+    self->checkI();
+}
+
+// --- Static functions ---
+
+bool Chip8::isJitSupported()
+{
+#ifdef CHIP8_JIT_X64
+    return ExecutableBuffer::isSupported();
+#else
+    return false;
+#endif
+}
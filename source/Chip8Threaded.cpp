@@ -0,0 +1,209 @@
+#include <cstdio>
+#include "../header/Chip8.hpp"
+
+// The threaded backend, the interpreter written as a single function which jumps straight from one
+// instruction to the next through a table of label addresses (GCC/Clang "labels as values")
+//
+// The simple instructions are done inline, everything else goes through the usual handlers
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CHIP8_COMPUTED_GOTO
+#endif
+
+// --- Private member functions ---
+
+std::uint64_t Chip8::emulateThreaded(std::uint64_t amount)
+{
+#ifdef CHIP8_COMPUTED_GOTO
+    // One label per OpType, in the same order
+    static const void* const labels[]
+    {
+        &&handler,  &&handler,  &&handler,  &&op_1NNN,  &&handler,  &&op_3XNN,  &&op_4XNN,  &&op_5XY0,
+        &&op_6XNN,  &&op_7XNN,  &&op_8XY0,  &&op_8XY1,  &&op_8XY2,  &&op_8XY3,  &&op_8XY4,  &&op_8XY5,
+        &&op_8XY6,  &&op_8XY7,  &&op_8XYE,  &&op_9XY0,  &&op_ANNN,  &&op_BXNN,  &&handler,  &&handler,
+        &&op_EX9E,  &&op_EXA1,  &&handler,  &&op_FX0A,  &&handler,  &&handler,  &&op_FX1E,  &&handler,
+        &&handler,  &&handler,  &&handler,
+        &&handler,
+    };
+    static_assert(sizeof(labels) / sizeof(labels[0]) == (std::size_t)OpType::INVALID + 1, "Every OpType needs a label");
+
+    Chip8_t::Byte* V{ m_regs.data() };
+    const bool vf_reset{ (m_quirks & Quirks::VF_RESET) != 0 };
+    const bool shift_vy{ (m_quirks & Quirks::SHIFT_VY) != 0 };
+    const bool jump_v0{ (m_quirks & Quirks::JUMP_V0) != 0 };
+    const DecodedOp* op{};
+    std::uint64_t executed{};
+
+    // Same as Chip8::step, up to the call of the handler
+#define DISPATCH()                                                                          \
+    if(executed == amount)                                                                  \
+    {                                                                                       \
+        return executed;                                                                    \
+    }                                                                                       \
+    ++executed;                                                                             \
+    op = &fetch();                                                                          \
+    if(m_PC >= Chip8Const::mem_size)                                                        \
+    {                                                                                       \
+        printf("PC (%04X) out of bounds! Setting it to 0xFFF - 1!\n", m_PC);                \
+        m_PC = Chip8Const::mem_size - 2;                                                    \
+    }                                                                                       \
+    checkI();                                                                               \
+    goto *labels[(std::size_t)op->type]
+
+    DISPATCH();
+
+handler:
+    (this->*op->handler)(*op);
+    if(m_stop != StopReason::BUDGET)
+    {
+        return executed;
+    }
+    DISPATCH();
+
+op_1NNN:
+    // Jumps back go through the handler to look for idle loops
+    if(op->nnn >= m_PC)
+    {
+        m_PC = op->nnn;
+        DISPATCH();
+    }
+    _1NNN(*op);
+    if(m_stop != StopReason::BUDGET)
+    {
+        return executed;
+    }
+    DISPATCH();
+
+op_3XNN:
+    m_PC += V[op->x] == op->nn ? 2 : 0;
+    DISPATCH();
+
+op_4XNN:
+    m_PC += V[op->x] != op->nn ? 2 : 0;
+    DISPATCH();
+
+op_5XY0:
+    m_PC += V[op->x] == V[op->y] ? 2 : 0;
+    DISPATCH();
+
+op_6XNN:
+    V[op->x] = op->nn;
+    DISPATCH();
+
+op_7XNN:
+    V[op->x] += op->nn;
+    DISPATCH();
+
+op_8XY0:
+    V[op->x] = V[op->y];
+    DISPATCH();
+
+op_8XY1:
+    V[op->x] |= V[op->y];
+    if(vf_reset)
+    {
+        V[0xF] = 0;
+    }
+    DISPATCH();
+
+op_8XY2:
+    V[op->x] &= V[op->y];
+    if(vf_reset)
+    {
+        V[0xF] = 0;
+    }
+    DISPATCH();
+
+op_8XY3:
+    V[op->x] ^= V[op->y];
+    if(vf_reset)
+    {
+        V[0xF] = 0;
+    }
+    DISPATCH();
+
+op_8XY4:
+{
+    Chip8_t::Byte vx{ V[op->x] };
+    Chip8_t::Byte vy{ V[op->y] };
+    V[op->x] = vx + vy;
+    V[0xF] = vx + vy > 0xFF;
+    DISPATCH();
+}
+
+op_8XY5:
+{
+    Chip8_t::Byte vx{ V[op->x] };
+    Chip8_t::Byte vy{ V[op->y] };
+    V[op->x] = vx - vy;
+    V[0xF] = vx >= vy;
+    DISPATCH();
+}
+
+op_8XY7:
+{
+    Chip8_t::Byte vx{ V[op->x] };
+    Chip8_t::Byte vy{ V[op->y] };
+    V[op->x] = vy - vx;
+    V[0xF] = vy >= vx;
+    DISPATCH();
+}
+
+op_8XY6:
+{
+    Chip8_t::Byte vx{ shift_vy ? V[op->y] : V[op->x] };
+    V[op->x] = vx >> 1;
+    V[0xF] = vx & 0b00000001;
+    DISPATCH();
+}
+
+op_8XYE:
+{
+    Chip8_t::Byte vx{ shift_vy ? V[op->y] : V[op->x] };
+    V[op->x] = vx << 1;
+    V[0xF] = (vx & 0b10000000) > 0;
+    DISPATCH();
+}
+
+op_9XY0:
+    m_PC += V[op->x] != V[op->y] ? 2 : 0;
+    DISPATCH();
+
+op_ANNN:
+    m_I = op->nnn;
+    DISPATCH();
+
+op_BXNN:
+    m_PC = op->nnn + (jump_v0 ? V[0x0] : V[op->x]);
+    DISPATCH();
+
+op_EX9E:
+    m_PC += m_key_states[V[op->x] % Chip8Const::buttons] == Chip8::KeyState::DOWN ? 2 : 0;
+    DISPATCH();
+
+op_EXA1:
+{
+    Chip8::KeyState state{ m_key_states[V[op->x] % Chip8Const::buttons] };
+    m_PC += state == Chip8::KeyState::UP || state == Chip8::KeyState::JUST_RELEASED ? 2 : 0;
+    DISPATCH();
+}
+
+op_FX0A:
+{
+    _FX0A(*op);
+    if(m_stop != StopReason::BUDGET)
+    {
+        return executed;
+    }
+    DISPATCH();
+}
+
+op_FX1E:
+    m_I += V[op->x];
+    DISPATCH();
+
+#undef DISPATCH
+#else
+    return emulateInterpreter(amount);
+#endif
+}
@@ -1,9 +1,137 @@
 #include "../header/Display.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
 #include <iostream>
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define DISPLAY_SIMD_X64
+#include <immintrin.h>
+#endif
+
+// The sprite blitters for 64 pixel wide displays, each one XORs 'count' rows of a sprite onto consecutive rows
+// of the display and returns whether any pixel was turned off
+//  rows    - the first row of the display to draw to
+//  sprite  - one byte per row for 8 pixel wide sprites, two for 16 pixel wide ones (wide)
+//  x       - how far right the sprite is shifted, with 'wrap' the pixels past the right edge come back on the left
+namespace
+{
+    typedef bool (*BlitFn)(std::uint64_t* rows, const std::uint8_t* sprite, std::size_t count, bool wide, unsigned x, bool wrap);
+
+    std::uint64_t spriteRow(const std::uint8_t* sprite, std::size_t i, bool wide)
+    {
+        if(wide)
+        {
+            return std::uint64_t((sprite[i * 2] << 8) | sprite[i * 2 + 1]) << 48;
+        }
+        return std::uint64_t(sprite[i]) << 56;
+    }
+
+    bool blitScalar(std::uint64_t* rows, const std::uint8_t* sprite, std::size_t count, bool wide, unsigned x, bool wrap)
+    {
+        std::uint64_t collision{};
+        for(std::size_t i{}; i < count; ++i)
+        {
+            std::uint64_t bits{ spriteRow(sprite, i, wide) };
+            std::uint64_t placed{ wrap ? std::rotr(bits, x) : bits >> x };
+            collision |= rows[i] & placed;
+            rows[i] ^= placed;
+        }
+        return collision != 0;
+    }
+
+#ifdef DISPLAY_SIMD_X64
+    // Shifting a lane by 64 or more gives 0, so (bits >> x) | (bits << (64 - x)) is a rotate even for x = 0,
+    // and shifting left by 64 turns wrapping off
+
+    // Two rows at a time, every x86-64 CPU has SSE2
+    bool blitSse2(std::uint64_t* rows, const std::uint8_t* sprite, std::size_t count, bool wide, unsigned x, bool wrap)
+    {
+        const __m128i shift{ _mm_cvtsi32_si128(x) };
+        const __m128i wrap_shift{ _mm_cvtsi32_si128(wrap ? 64 - x : 64) };
+        __m128i collision{ _mm_setzero_si128() };
+
+        std::size_t i{};
+        for(; i + 2 <= count; i += 2)
+        {
+            __m128i bits{ _mm_set_epi64x(spriteRow(sprite, i + 1, wide), spriteRow(sprite, i, wide)) };
+            __m128i placed{ _mm_or_si128(_mm_srl_epi64(bits, shift), _mm_sll_epi64(bits, wrap_shift)) };
+            __m128i row{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows + i)) };
+            collision = _mm_or_si128(collision, _mm_and_si128(row, placed));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(rows + i), _mm_xor_si128(row, placed));
+        }
+
+        bool hit{ _mm_movemask_epi8(_mm_cmpeq_epi8(collision, _mm_setzero_si128())) != 0xFFFF };
+        bool rest{ blitScalar(rows + i, sprite + i * (wide ? 2 : 1), count - i, wide, x, wrap) };
+        return hit || rest;
+    }
+
+    // Four rows at a time, the sprite bytes are widened into the lanes directly
+    __attribute__((target("avx2")))
+    bool blitAvx2(std::uint64_t* rows, const std::uint8_t* sprite, std::size_t count, bool wide, unsigned x, bool wrap)
+    {
+        const __m128i shift{ _mm_cvtsi32_si128(x) };
+        const __m128i wrap_shift{ _mm_cvtsi32_si128(wrap ? 64 - x : 64) };
+        // The two bytes of a 16 pixel wide row are big endian
+        const __m128i swap_bytes{ _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14) };
+        __m256i collision{ _mm256_setzero_si256() };
+
+        std::size_t i{};
+        for(; i + 4 <= count; i += 4)
+        {
+            __m256i bits{};
+            if(wide)
+            {
+                __m128i words{ _mm_shuffle_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(sprite + i * 2)), swap_bytes) };
+                bits = _mm256_slli_epi64(_mm256_cvtepu16_epi64(words), 48);
+            }
+            else
+            {
+                std::uint32_t bytes{};
+                std::memcpy(&bytes, sprite + i, sizeof(bytes));
+                bits = _mm256_slli_epi64(_mm256_cvtepu8_epi64(_mm_cvtsi32_si128((int)bytes)), 56);
+            }
+
+            __m256i placed{ _mm256_or_si256(_mm256_srl_epi64(bits, shift), _mm256_sll_epi64(bits, wrap_shift)) };
+            __m256i row{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows + i)) };
+            collision = _mm256_or_si256(collision, _mm256_and_si256(row, placed));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(rows + i), _mm256_xor_si256(row, placed));
+        }
+
+        bool hit{ !_mm256_testz_si256(collision, collision) };
+        bool rest{ blitScalar(rows + i, sprite + i * (wide ? 2 : 1), count - i, wide, x, wrap) };
+        return hit || rest;
+    }
+#endif
+
+    // Picks the fastest blitter that the CPU supports
+    BlitFn selectBlit()
+    {
+#ifdef DISPLAY_SIMD_X64
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2"))
+        {
+            return blitAvx2;
+        }
+        return blitSse2;
+#else
+        return blitScalar;
+#endif
+    }
+}
+
 // --- Constructors ---
 
-Display::Display(Chip8_t::Word width, Chip8_t::Word height) : m_data(height, std::vector<bool>(width, false)) {}
+Display::Display(Chip8_t::Word width, Chip8_t::Word height) : m_width{width}, m_height{height}
+{
+    if(m_width > max_width || m_height > max_height)
+    {
+        std::cout << "A Display can't be bigger than (" << max_width << ", " << max_height << ")!\n";
+        std::cout << "Attempted to create one of size (" << width << ", " << height << ")\n";
+        m_width = std::min(m_width, max_width);
+        m_height = std::min(m_height, max_height);
+    }
+}
 
 // --- Member functions ---
 
@@ -16,10 +144,17 @@ void Display::setPixel(Chip8_t::Word x, Chip8_t::Word y, bool state)
         std::cout << "Attempted to set pixel at (" << x << ", " << y << ") to " << state << '\n';
         return; 
     }
-    m_data[y][x] = state;
+
+    std::uint64_t mask{ std::uint64_t(1) << (63 - x % 64) };
+    std::uint64_t& word{ m_words[x / 64][y] };
+    if(((word & mask) != 0) != state)
+    {
+        word ^= mask;
+        markChanged(std::uint64_t(1) << y);
+    }
 }
 
-bool Display::getPixel(Chip8_t::Word x, Chip8_t::Word y)
+bool Display::getPixel(Chip8_t::Word x, Chip8_t::Word y) const
 {
     if(x >= getWidth() || y >= getHeight())
     {
@@ -28,7 +163,7 @@ bool Display::getPixel(Chip8_t::Word x, Chip8_t::Word y)
         std::cout << "Attempted to get pixel at (" << x << ", " << y << ")\n";
         return 0; 
     }
-    return m_data[y][x];
+    return (m_words[x / 64][y] >> (63 - x % 64)) & 1;
 }
 
 void Display::flipPixel(Chip8_t::Word x, Chip8_t::Word y)
@@ -40,34 +175,170 @@ void Display::flipPixel(Chip8_t::Word x, Chip8_t::Word y)
         std::cout << "Attempted to flip pixel at (" << x << ", " << y << ")\n";
         return; 
     }
-    setPixel(x, y, !getPixel(x, y));
+    m_words[x / 64][y] ^= std::uint64_t(1) << (63 - x % 64);
+    markChanged(std::uint64_t(1) << y);
 }
 
-void Display::setAll(bool state)
+bool Display::drawSprite(Chip8_t::Word x, Chip8_t::Word y, std::span<const Chip8_t::Byte> sprite, bool wide, bool clip)
 {
-    for(int x{}; x < getWidth(); ++x)
+    if(x >= getWidth() || y >= getHeight())
     {
-        for(int y{}; y < getHeight(); ++y)
+        std::cout << "Attempting to draw out-of-bounds to a Display!\n";
+        std::cout << "The display size is: (" << getWidth() << ", " << getHeight() << ")\n";
+        std::cout << "Attempted to draw a sprite at (" << x << ", " << y << ")\n";
+        return false;
+    }
+
+    static const BlitFn blit{ selectBlit() };
+    std::size_t bytes_per_row{ wide ? 2u : 1u };
+    std::size_t count{ sprite.size() / bytes_per_row };
+    bool collision{};
+
+    // The rows past the bottom edge are cut off, or drawn from the top again
+    std::size_t done{};
+    Chip8_t::Word row_y{ y };
+    std::uint64_t changed{};
+    while(done < count)
+    {
+        std::size_t part{ std::min<std::size_t>(count - done, m_height - row_y) };
+        changed |= (part == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << part) - 1) << row_y;
+        const Chip8_t::Byte* part_sprite{ sprite.data() + done * bytes_per_row };
+
+        // A row of the CHIP8 display is a single word, so the whole part is placed with shifts (or rotates to wrap it around)
+        if(m_width == 64)
         {
-            setPixel(x, y, state);
+            collision |= blit(&m_words[0][row_y], part_sprite, part, wide, x, !clip);
+        }
+        else
+        {
+            for(std::size_t i{}; i < part; ++i)
+            {
+                std::uint16_t bits{ (std::uint16_t)(wide ? (part_sprite[i * 2] << 8) | part_sprite[i * 2 + 1] : part_sprite[i]) };
+                collision |= drawBits(x, row_y + i, bits, wide ? 16 : 8, clip);
+            }
+        }
+
+        done += part;
+        row_y = 0;
+        if(clip)
+        {
+            break;
         }
     }
+
+    // Every row that was drawn to counts, even if the sprite row was empty
+    if(changed != 0)
+    {
+        markChanged(changed);
+    }
+    return collision;
 }
 
-Chip8_t::Word Display::getWidth()
+bool Display::drawBits(Chip8_t::Word x, Chip8_t::Word y, std::uint16_t bits, Chip8_t::Byte count, bool clip)
 {
-    if(getHeight() > 0)
+    bool collision{};
+    for(Chip8_t::Word i{}; i < count; ++i)
     {
-        return (m_data[0]).size();
+        if(((bits >> (count - 1 - i)) & 1) == 0)
+        {
+            continue;
+        }
+
+        Chip8_t::Word pixel_x{ (Chip8_t::Word)(x + i) };
+        if(pixel_x >= m_width)
+        {
+            if(clip)
+            {
+                break;
+            }
+            pixel_x %= m_width;
+        }
+
+        collision |= getPixel(pixel_x, y);
+        m_words[pixel_x / 64][y] ^= std::uint64_t(1) << (63 - pixel_x % 64);
+    }
+    return collision;
+}
+
+Display::Row Display::getRow(Chip8_t::Word y) const
+{
+    Row row{};
+    for(std::size_t word{}; word < row.size(); ++word)
+    {
+        row[word] = m_words[word][y];
     }
-    else
+    return row;
+}
+
+void Display::setRow(Chip8_t::Word y, const Row& row)
+{
+    for(std::size_t word{}; word < row.size(); ++word)
     {
-        std::cout << "Couldn't get Display width properly because the Display height is not > 0!\n";
-        return 0;
+        // Only the bits inside the width are kept
+        Chip8_t::Word bits{ (Chip8_t::Word)std::clamp<int>(m_width - (int)word * 64, 0, 64) };
+        std::uint64_t mask{ bits == 0 ? 0 : bits == 64 ? ~std::uint64_t(0) : ~(~std::uint64_t(0) >> bits) };
+        m_words[word][y] = row[word] & mask;
     }
+    markChanged(std::uint64_t(1) << y);
 }
 
-Chip8_t::Word Display::getHeight()
+void Display::setAll(bool state)
 {
-    return m_data.size();
-}
\ No newline at end of file
+    // Only the rows that weren't already in that state change (clearing a clear screen does nothing)
+    std::uint64_t changed{};
+    for(std::size_t word{}; word < m_words.size(); ++word)
+    {
+        // Only the bits inside the width are set
+        Chip8_t::Word bits{ (Chip8_t::Word)std::clamp<int>(m_width - (int)word * 64, 0, 64) };
+        std::uint64_t filled{ !state || bits == 0 ? 0 : bits == 64 ? ~std::uint64_t(0) : ~(~std::uint64_t(0) >> bits) };
+        for(Chip8_t::Word y{}; y < m_height; ++y)
+        {
+            if(m_words[word][y] != filled)
+            {
+                m_words[word][y] = filled;
+                changed |= std::uint64_t(1) << y;
+            }
+        }
+    }
+
+    if(changed != 0)
+    {
+        markChanged(changed);
+    }
+}
+
+std::uint64_t Display::takeDirtyRows()
+{
+    std::uint64_t rows{ m_dirty_rows };
+    m_dirty_rows = 0;
+    return rows;
+}
+
+std::uint64_t Display::getGeneration() const
+{
+    return m_generation;
+}
+
+void Display::restore(const Display& other)
+{
+    std::uint64_t generation{ std::max(m_generation, other.m_generation) };
+    *this = other;
+    m_generation = generation;
+    markChanged(~std::uint64_t(0));
+}
+
+void Display::markChanged(std::uint64_t rows)
+{
+    m_dirty_rows |= rows;
+    ++m_generation;
+}
+
+Chip8_t::Word Display::getWidth() const
+{
+    return m_width;
+}
+
+Chip8_t::Word Display::getHeight() const
+{
+    return m_height;
+}
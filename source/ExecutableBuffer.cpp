@@ -0,0 +1,168 @@
+#include "../header/ExecutableBuffer.hpp"
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define EXECUTABLE_BUFFER_MMAP
+#endif
+
+// --- Constructors ---
+
+ExecutableBuffer::ExecutableBuffer() {}
+
+ExecutableBuffer::ExecutableBuffer(ExecutableBuffer&& other) noexcept :
+    m_data{std::exchange(other.m_data, nullptr)},
+    m_size{std::exchange(other.m_size, 0)},
+    m_position{std::exchange(other.m_position, 0)},
+    m_overflow{std::exchange(other.m_overflow, false)}
+{}
+
+ExecutableBuffer& ExecutableBuffer::operator=(ExecutableBuffer&& other) noexcept
+{
+    if(this != &other)
+    {
+        allocate(0);
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+        m_position = std::exchange(other.m_position, 0);
+        m_overflow = std::exchange(other.m_overflow, false);
+    }
+    return *this;
+}
+
+ExecutableBuffer::~ExecutableBuffer()
+{
+    allocate(0);
+}
+
+// --- Static functions ---
+
+bool ExecutableBuffer::isSupported()
+{
+#ifdef EXECUTABLE_BUFFER_MMAP
+    return true;
+#else
+    return false;
+#endif
+}
+
+// --- Member functions ---
+
+bool ExecutableBuffer::allocate(std::size_t size)
+{
+#ifdef EXECUTABLE_BUFFER_MMAP
+    if(m_data != nullptr)
+    {
+        munmap(m_data, m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    clear();
+
+    if(size == 0)
+    {
+        return true;
+    }
+
+    void* data{ mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) };
+    if(data == MAP_FAILED)
+    {
+        return false;
+    }
+
+    m_data = static_cast<std::uint8_t*>(data);
+    m_size = size;
+    return true;
+#else
+    return size == 0;
+#endif
+}
+
+bool ExecutableBuffer::isAllocated() const
+{
+    return m_data != nullptr;
+}
+
+void ExecutableBuffer::unlock()
+{
+#ifdef EXECUTABLE_BUFFER_MMAP
+    if(m_data != nullptr)
+    {
+        mprotect(m_data, m_size, PROT_READ | PROT_WRITE);
+    }
+#endif
+}
+
+void ExecutableBuffer::lock()
+{
+#ifdef EXECUTABLE_BUFFER_MMAP
+    if(m_data != nullptr)
+    {
+        mprotect(m_data, m_size, PROT_READ | PROT_EXEC);
+    }
+#endif
+}
+
+void ExecutableBuffer::clear()
+{
+    m_position = 0;
+    m_overflow = false;
+}
+
+void ExecutableBuffer::emit(std::initializer_list<std::uint8_t> bytes)
+{
+    if(m_position + bytes.size() > m_size)
+    {
+        m_overflow = true;
+        return;
+    }
+
+    for(std::uint8_t byte : bytes)
+    {
+        m_data[m_position++] = byte;
+    }
+}
+
+void ExecutableBuffer::emit16(std::uint16_t value)
+{
+    emit({(std::uint8_t)value, (std::uint8_t)(value >> 8)});
+}
+
+void ExecutableBuffer::emit32(std::uint32_t value)
+{
+    emit({(std::uint8_t)value, (std::uint8_t)(value >> 8), (std::uint8_t)(value >> 16), (std::uint8_t)(value >> 24)});
+}
+
+void ExecutableBuffer::emit64(std::uint64_t value)
+{
+    emit32((std::uint32_t)value);
+    emit32((std::uint32_t)(value >> 32));
+}
+
+void ExecutableBuffer::patch32(std::size_t position, std::uint32_t value)
+{
+    if(position + 4 > m_size)
+    {
+        return;
+    }
+
+    for(int i{}; i < 4; ++i)
+    {
+        m_data[position + i] = (std::uint8_t)(value >> (i * 8));
+    }
+}
+
+std::size_t ExecutableBuffer::getPosition() const
+{
+    return m_position;
+}
+
+void* ExecutableBuffer::getAddress(std::size_t position) const
+{
+    return m_data + position;
+}
+
+bool ExecutableBuffer::hasOverflown() const
+{
+    return m_overflow;
+}
@@ -0,0 +1,39 @@
+#include "../header/Instruction.hpp"
+
+// Compile time checks of the Instruction field extraction, if any of these fail the project won't build
+
+namespace
+{
+    constexpr Instruction<std::uint16_t> dxyn{ std::uint16_t{0xD12F} };
+    constexpr Instruction<std::uint16_t> dead{ std::uint16_t{0xDEAD} };
+
+    // Fields
+    static_assert(dxyn.getOpClass() == 0xD);
+    static_assert(dxyn.getX() == 0x1);
+    static_assert(dxyn.getY() == 0x2);
+    static_assert(dxyn.getN() == 0xF);
+    static_assert(dxyn.getNN() == 0x2F);
+    static_assert(dxyn.getNNN() == 0x12F);
+    static_assert(dxyn.get() == 0xD12F);
+
+    // Compile time checked nibbles
+    static_assert(dead.getNibble<0>() == 0xD);
+    static_assert(dead.getNibble<1>() == 0xE);
+    static_assert(dead.getNibble<2>() == 0xA);
+    static_assert(dead.getNibble<3>() == 0xD);
+    static_assert(dead.getNibbles<1, 2>() == 0xEA);
+    static_assert(dead.getNibbles<0, 3>() == 0xDEAD);
+    static_assert(dead.getNibbles<3, 3>() == 0xD);
+
+    // Constructors
+    static_assert(Instruction<std::uint16_t>{ std::array<std::uint8_t, 2>{0xDE, 0xAD} }.get() == 0xDEAD);
+    static_assert(Instruction<std::uint16_t>{ std::array<std::uint8_t, 4>{0xD, 0xE, 0xA, 0xD} }.get() == 0xDEAD);
+    static_assert(Instruction<std::uint16_t>::getAmountOfNibbles() == 4);
+
+    // Wider instructions
+    constexpr Instruction<std::uint32_t> wide{ std::uint32_t{0x12345678} };
+    static_assert(Instruction<std::uint32_t>::getAmountOfNibbles() == 8);
+    static_assert(wide.getNibble<7>() == 0x8);
+    static_assert(wide.getNibbles<2, 5>() == 0x3456);
+    static_assert(wide.getNibbles<0, 7>() == 0x12345678);
+}
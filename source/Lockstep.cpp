@@ -0,0 +1,751 @@
+#include "../header/Lockstep.hpp"
+#include <algorithm>
+#include <cstring>
+
+// The loops over the lanes are compiled for AVX-512 and AVX2 too, the best one the CPU supports is picked when the program starts
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define LOCKSTEP_TARGETS __attribute__((target_clones("arch=x86-64-v4", "avx2", "default")))
+#else
+#define LOCKSTEP_TARGETS
+#endif
+
+double Lockstep::Counters::getUtilisation(std::size_t lanes) const
+{
+    if(vector_groups == 0 || lanes == 0)
+    {
+        return 0;
+    }
+    return (double)vector_instructions / ((double)vector_groups * lanes);
+}
+
+// --- Constructors ---
+
+Lockstep::Lockstep(std::size_t lanes) :
+    m_lanes{std::max<std::size_t>(lanes, 1)},
+    m_stride{(m_lanes + lane_block - 1) / lane_block * lane_block},
+    m_regs(m_stride * Chip8Const::reg_amount),
+    m_PC(m_stride),
+    m_I(m_stride),
+    m_delay_timer(m_stride),
+    m_sound_timer(m_stride),
+    m_keys(m_stride * Chip8Const::buttons),
+    m_running(m_stride),
+    m_lane_states(m_lanes),
+    m_opcodes(m_stride),
+    m_group(m_stride),
+    m_pending(m_stride)
+{
+    clearMemory();
+}
+
+// --- Private member functions ---
+
+Chip8_t::Byte* Lockstep::reg(Chip8_t::Byte which)
+{
+    return m_regs.data() + (which & (Chip8Const::reg_amount - 1)) * m_stride;
+}
+
+Chip8::KeyState Lockstep::key(std::size_t lane, Chip8_t::Byte which) const
+{
+    return (Chip8::KeyState)m_keys[(which & (Chip8Const::buttons - 1)) * m_stride + lane];
+}
+
+void Lockstep::writeMemory(std::size_t lane, Chip8_t::Word where, std::span<const Chip8_t::Byte> what)
+{
+    m_lane_states[lane].memory.writeBlock(where, what);
+    for(std::size_t i{}; i < what.size(); ++i)
+    {
+        m_shared.reset((where + i) % Chip8Const::mem_size);
+    }
+}
+
+void Lockstep::stopLane(std::size_t lane, Chip8::StopReason reason)
+{
+    // Like Chip8::run, the instruction that failed counts but the events of its cycle aren't serviced
+    LaneState& state{ m_lane_states[lane] };
+    state.stop = reason;
+    state.stop_cycle = m_cycles + 1;
+    state.stop_next_frame = m_next_frame;
+    m_running[lane] = 0;
+}
+
+void Lockstep::executeLane(const Chip8::DecodedOp& op, std::size_t lane)
+{
+    // The same as the functions of Chip8 executing the instructions (see Chip8.cpp and template_defs/Chip8.tpp)
+    LaneState& state{ m_lane_states[lane] };
+    auto V{ [&](Chip8_t::Byte which) -> Chip8_t::Byte& { return reg(which)[lane]; } };
+    Chip8_t::Word& PC{ m_PC[lane] };
+    Chip8_t::Word& I{ m_I[lane] };
+
+    switch(op.type)
+    {
+        case Chip8::OpType::_00E0: state.display.setAll(false); break;
+        case Chip8::OpType::_00EE:
+        {
+            Chip8_t::Word location{};
+            if(!state.stack.pop(location))
+            {
+                PC -= 2;
+                stopLane(lane, Chip8::StopReason::STACK_UNDERFLOW);
+                break;
+            }
+            PC = location;
+            break;
+        }
+        case Chip8::OpType::_1NNN: PC = op.nnn; break;
+        case Chip8::OpType::_2NNN:
+        {
+            if(!state.stack.push(PC))
+            {
+                PC -= 2;
+                stopLane(lane, Chip8::StopReason::STACK_OVERFLOW);
+                break;
+            }
+            PC = op.nnn;
+            break;
+        }
+        case Chip8::OpType::_3XNN: if(V(op.x) == op.nn) PC += 2; break;
+        case Chip8::OpType::_4XNN: if(V(op.x) != op.nn) PC += 2; break;
+        case Chip8::OpType::_5XY0: if(V(op.x) == V(op.y)) PC += 2; break;
+        case Chip8::OpType::_9XY0: if(V(op.x) != V(op.y)) PC += 2; break;
+        case Chip8::OpType::_6XNN: V(op.x) = op.nn; break;
+        case Chip8::OpType::_7XNN: V(op.x) += op.nn; break;
+        case Chip8::OpType::_8XY0: V(op.x) = V(op.y); break;
+        case Chip8::OpType::_8XY1:
+        case Chip8::OpType::_8XY2:
+        case Chip8::OpType::_8XY3:
+        {
+            Chip8_t::Byte vx{ V(op.x) };
+            Chip8_t::Byte vy{ V(op.y) };
+            V(op.x) = op.type == Chip8::OpType::_8XY1 ? vx | vy : op.type == Chip8::OpType::_8XY2 ? vx & vy : vx ^ vy;
+            if(m_quirks & Quirks::VF_RESET)
+            {
+                V(0xF) = 0;
+            }
+            break;
+        }
+        case Chip8::OpType::_8XY4:
+        {
+            Chip8_t::Byte vx{ V(op.x) };
+            Chip8_t::Byte vy{ V(op.y) };
+            V(op.x) = vx + vy;
+            V(0xF) = vx + vy > 0xFF;
+            break;
+        }
+        case Chip8::OpType::_8XY5:
+        {
+            Chip8_t::Byte vx{ V(op.x) };
+            Chip8_t::Byte vy{ V(op.y) };
+            V(op.x) = vx - vy;
+            V(0xF) = vx >= vy;
+            break;
+        }
+        case Chip8::OpType::_8XY7:
+        {
+            Chip8_t::Byte vx{ V(op.x) };
+            Chip8_t::Byte vy{ V(op.y) };
+            V(op.x) = vy - vx;
+            V(0xF) = vy >= vx;
+            break;
+        }
+        case Chip8::OpType::_8XY6:
+        {
+            Chip8_t::Byte vx{ (m_quirks & Quirks::SHIFT_VY) ? V(op.y) : V(op.x) };
+            V(op.x) = vx >> 1;
+            V(0xF) = vx & 0b00000001;
+            break;
+        }
+        case Chip8::OpType::_8XYE:
+        {
+            Chip8_t::Byte vx{ (m_quirks & Quirks::SHIFT_VY) ? V(op.y) : V(op.x) };
+            V(op.x) = vx << 1;
+            V(0xF) = (vx & 0b10000000) > 0;
+            break;
+        }
+        case Chip8::OpType::_ANNN: I = op.nnn; break;
+        case Chip8::OpType::_BXNN: PC = op.nnn + ((m_quirks & Quirks::JUMP_V0) ? V(0x0) : V(op.x)); break;
+        case Chip8::OpType::_CXNN: V(op.x) = (Chip8_t::Byte)(state.random.next() >> 24) & op.nn; break;
+        case Chip8::OpType::_DXYN:
+        {
+            Chip8_t::Byte x{ (Chip8_t::Byte)(V(op.x) % Chip8Const::screen_width) };
+            Chip8_t::Byte y{ (Chip8_t::Byte)(V(op.y) % Chip8Const::screen_height) };
+            bool wide{ (m_quirks & Quirks::SPRITE_16) && op.n == 0 };
+            std::size_t bytes{ wide ? 32u : op.n };
+
+            std::array<Chip8_t::Byte, 32> sprite{};
+            state.memory.readBlock(I, std::span<Chip8_t::Byte>{ sprite.data(), bytes });
+            bool collision{ state.display.drawSprite(x, y, std::span<const Chip8_t::Byte>{ sprite.data(), bytes }, wide, (m_quirks & Quirks::CLIP) != 0) };
+            V(0xF) = collision ? 1 : 0;
+            break;
+        }
+        case Chip8::OpType::_EX9E: if(key(lane, V(op.x)) == Chip8::KeyState::DOWN) PC += 2; break;
+        case Chip8::OpType::_EXA1:
+        {
+            Chip8::KeyState state{ key(lane, V(op.x)) };
+            if(state == Chip8::KeyState::UP || state == Chip8::KeyState::JUST_RELEASED) PC += 2;
+            break;
+        }
+        case Chip8::OpType::_FX07: V(op.x) = m_delay_timer[lane]; break;
+        case Chip8::OpType::_FX0A:
+        {
+            Chip8_t::Byte which{};
+            while(which < Chip8Const::buttons && key(lane, which) != Chip8::KeyState::JUST_RELEASED)
+            {
+                ++which;
+            }
+            if(which >= Chip8Const::buttons)
+            {
+                // Stays at the FX0A, Chip8::run would skip these cycles as elided
+                PC -= 2;
+                break;
+            }
+            V(op.x) = which;
+            break;
+        }
+        case Chip8::OpType::_FX15: m_delay_timer[lane] = V(op.x); break;
+        case Chip8::OpType::_FX18: m_sound_timer[lane] = V(op.x); break;
+        case Chip8::OpType::_FX1E: I += V(op.x); break;
+        case Chip8::OpType::_FX29: I = Chip8Const::font_begin + (V(op.x) % (0xF + 1)) * 5; break;
+        case Chip8::OpType::_FX33:
+        {
+            Chip8_t::Byte num{ V(op.x) };
+            const Chip8_t::Byte digits[]{ (Chip8_t::Byte)(num / 100), (Chip8_t::Byte)(num / 10 % 10), (Chip8_t::Byte)(num % 10) };
+            writeMemory(lane, I, digits);
+            break;
+        }
+        case Chip8::OpType::_FX55:
+        {
+            std::array<Chip8_t::Byte, Chip8Const::reg_amount> regs{};
+            for(Chip8_t::Byte r{}; r <= op.x; ++r)
+            {
+                regs[r] = V(r);
+            }
+            writeMemory(lane, I, std::span<const Chip8_t::Byte>{ regs.data(), (std::size_t)op.x + 1 });
+            if(m_quirks & Quirks::LOAD_STORE_INCREMENT)
+            {
+                I += op.x + 1;
+            }
+            break;
+        }
+        case Chip8::OpType::_FX65:
+        {
+            std::array<Chip8_t::Byte, Chip8Const::reg_amount> regs{};
+            state.memory.readBlock(I, std::span<Chip8_t::Byte>{ regs.data(), (std::size_t)op.x + 1 });
+            for(Chip8_t::Byte r{}; r <= op.x; ++r)
+            {
+                V(r) = regs[r];
+            }
+            if(m_quirks & Quirks::LOAD_STORE_INCREMENT)
+            {
+                I += op.x + 1;
+            }
+            break;
+        }
+        default:
+        {
+            // 0NNN and invalid instructions don't do anything
+            break;
+        }
+    }
+}
+
+void Lockstep::stepLane(std::size_t lane)
+{
+    // Like Chip8::step, the PC and I are moved back in bounds before executing
+    const Chip8::MemoryType& memory{ m_lane_states[lane].memory };
+    Chip8_t::Word pc{ m_PC[lane] };
+    Chip8_t::Word opcode = (memory.read(pc) << 8) | memory.read(pc + 1);
+    m_PC[lane] = pc + 2 >= Chip8Const::mem_size ? Chip8Const::mem_size - 2 : pc + 2;
+    if(m_I[lane] >= Chip8Const::mem_size)
+    {
+        m_I[lane] = Chip8Const::mem_size - 2;
+    }
+    executeLane(Chip8::decodeOp(opcode), lane);
+}
+
+LOCKSTEP_TARGETS
+void Lockstep::stepGroup(const Chip8::DecodedOp& op, Chip8_t::Word pc, const Chip8_t::Byte* group)
+{
+    Chip8_t::Word* PC{ m_PC.data() };
+    Chip8_t::Word* I{ m_I.data() };
+    Chip8_t::Byte* vx{ reg(op.x) };
+    Chip8_t::Byte* vy{ reg(op.y) };
+    Chip8_t::Byte* vf{ reg(0xF) };
+    const std::size_t n{ m_stride };
+
+    // Like Chip8::step
+    Chip8_t::Word next{ (Chip8_t::Word)(pc + 2 >= Chip8Const::mem_size ? Chip8Const::mem_size - 2 : pc + 2) };
+    for(std::size_t i{}; i < n; ++i)
+    {
+        PC[i] = group[i] ? next : PC[i];
+        I[i] = group[i] && I[i] >= Chip8Const::mem_size ? Chip8Const::mem_size - 2 : I[i];
+    }
+
+    // VX is written before VF, a block of results is made first so it doesn't matter if X or Y is F
+    Chip8_t::Byte result[lane_block];
+    Chip8_t::Byte flag[lane_block];
+    auto writeResults{ [&](std::size_t base, bool write_flag)
+    {
+        for(std::size_t i{}; i < lane_block; ++i)
+        {
+            vx[base + i] = group[base + i] ? result[i] : vx[base + i];
+        }
+        if(write_flag)
+        {
+            for(std::size_t i{}; i < lane_block; ++i)
+            {
+                vf[base + i] = group[base + i] ? flag[i] : vf[base + i];
+            }
+        }
+    } };
+
+    switch(op.type)
+    {
+        case Chip8::OpType::_1NNN:
+            for(std::size_t i{}; i < n; ++i) PC[i] = group[i] ? op.nnn : PC[i];
+            break;
+        case Chip8::OpType::_3XNN:
+            for(std::size_t i{}; i < n; ++i) PC[i] += group[i] && vx[i] == op.nn ? 2 : 0;
+            break;
+        case Chip8::OpType::_4XNN:
+            for(std::size_t i{}; i < n; ++i) PC[i] += group[i] && vx[i] != op.nn ? 2 : 0;
+            break;
+        case Chip8::OpType::_5XY0:
+            for(std::size_t i{}; i < n; ++i) PC[i] += group[i] && vx[i] == vy[i] ? 2 : 0;
+            break;
+        case Chip8::OpType::_9XY0:
+            for(std::size_t i{}; i < n; ++i) PC[i] += group[i] && vx[i] != vy[i] ? 2 : 0;
+            break;
+        case Chip8::OpType::_6XNN:
+            for(std::size_t i{}; i < n; ++i) vx[i] = group[i] ? op.nn : vx[i];
+            break;
+        case Chip8::OpType::_7XNN:
+            for(std::size_t i{}; i < n; ++i) vx[i] += group[i] & op.nn;
+            break;
+        case Chip8::OpType::_8XY0:
+            for(std::size_t i{}; i < n; ++i) vx[i] = group[i] ? vy[i] : vx[i];
+            break;
+        case Chip8::OpType::_8XY1:
+        case Chip8::OpType::_8XY2:
+        case Chip8::OpType::_8XY3:
+            for(std::size_t base{}; base < n; base += lane_block)
+            {
+                for(std::size_t i{}; i < lane_block; ++i)
+                {
+                    Chip8_t::Byte x{ vx[base + i] };
+                    Chip8_t::Byte y{ vy[base + i] };
+                    result[i] = op.type == Chip8::OpType::_8XY1 ? x | y : op.type == Chip8::OpType::_8XY2 ? x & y : x ^ y;
+                    flag[i] = 0;
+                }
+                writeResults(base, (m_quirks & Quirks::VF_RESET) != 0);
+            }
+            break;
+        case Chip8::OpType::_8XY4:
+        case Chip8::OpType::_8XY5:
+        case Chip8::OpType::_8XY7:
+            for(std::size_t base{}; base < n; base += lane_block)
+            {
+                for(std::size_t i{}; i < lane_block; ++i)
+                {
+                    Chip8_t::Byte x{ vx[base + i] };
+                    Chip8_t::Byte y{ vy[base + i] };
+                    if(op.type == Chip8::OpType::_8XY4)
+                    {
+                        result[i] = x + y;
+                        flag[i] = x + y > 0xFF;
+                    }
+                    else if(op.type == Chip8::OpType::_8XY5)
+                    {
+                        result[i] = x - y;
+                        flag[i] = x >= y;
+                    }
+                    else
+                    {
+                        result[i] = y - x;
+                        flag[i] = y >= x;
+                    }
+                }
+                writeResults(base, true);
+            }
+            break;
+        case Chip8::OpType::_8XY6:
+        case Chip8::OpType::_8XYE:
+        {
+            const Chip8_t::Byte* source{ (m_quirks & Quirks::SHIFT_VY) ? vy : vx };
+            for(std::size_t base{}; base < n; base += lane_block)
+            {
+                for(std::size_t i{}; i < lane_block; ++i)
+                {
+                    Chip8_t::Byte value{ source[base + i] };
+                    result[i] = op.type == Chip8::OpType::_8XY6 ? value >> 1 : value << 1;
+                    flag[i] = op.type == Chip8::OpType::_8XY6 ? value & 1 : value >> 7;
+                }
+                writeResults(base, true);
+            }
+            break;
+        }
+        case Chip8::OpType::_ANNN:
+            for(std::size_t i{}; i < n; ++i) I[i] = group[i] ? op.nnn : I[i];
+            break;
+        case Chip8::OpType::_BXNN:
+        {
+            const Chip8_t::Byte* offset{ (m_quirks & Quirks::JUMP_V0) ? reg(0x0) : vx };
+            for(std::size_t i{}; i < n; ++i) PC[i] = group[i] ? op.nnn + offset[i] : PC[i];
+            break;
+        }
+        case Chip8::OpType::_FX07:
+            for(std::size_t i{}; i < n; ++i) vx[i] = group[i] ? m_delay_timer[i] : vx[i];
+            break;
+        case Chip8::OpType::_FX15:
+            for(std::size_t i{}; i < n; ++i) m_delay_timer[i] = group[i] ? vx[i] : m_delay_timer[i];
+            break;
+        case Chip8::OpType::_FX18:
+            for(std::size_t i{}; i < n; ++i) m_sound_timer[i] = group[i] ? vx[i] : m_sound_timer[i];
+            break;
+        case Chip8::OpType::_FX1E:
+            for(std::size_t i{}; i < n; ++i) I[i] += group[i] ? vx[i] : 0;
+            break;
+        case Chip8::OpType::_FX29:
+            for(std::size_t i{}; i < n; ++i) I[i] = group[i] ? Chip8Const::font_begin + (vx[i] & 0xF) * 5 : I[i];
+            break;
+        default:
+        {
+            // The memory, the display, the stack, the keys and the random numbers are separate for every lane
+            for(std::size_t lane{}; lane < m_lanes; ++lane)
+            {
+                if(group[lane])
+                {
+                    executeLane(op, lane);
+                }
+            }
+            break;
+        }
+    }
+}
+
+LOCKSTEP_TARGETS
+void Lockstep::step()
+{
+    const Chip8_t::Byte* running{ m_running.data() };
+    const Chip8_t::Word* PC{ m_PC.data() };
+    const std::size_t n{ m_stride };
+
+    std::size_t count{};
+    for(std::size_t i{}; i < n; ++i)
+    {
+        count += running[i] & 1;
+    }
+    if(count == 0)
+    {
+        return;
+    }
+    ++m_counters.cycles;
+    m_counters.instructions += count;
+
+    // Every lane at the same instruction, which it doesn't have to be read from every lane for
+    std::size_t first{ (std::size_t)(std::find(m_running.begin(), m_running.end(), 0xFF) - m_running.begin()) };
+    Chip8_t::Word pc{ PC[first] };
+    Chip8_t::Byte apart{};
+    for(std::size_t i{}; i < n; ++i)
+    {
+        apart |= running[i] & (PC[i] != pc ? 0xFF : 0);
+    }
+    if(apart == 0 && pc + 1 < Chip8Const::mem_size && m_shared[pc] && m_shared[pc + 1])
+    {
+        Chip8_t::Word opcode = (m_reference.read(pc) << 8) | m_reference.read(pc + 1);
+        // A lane stopping in the middle of the group doesn't change who is in it
+        std::copy(m_running.begin(), m_running.end(), m_group.begin());
+        stepGroup(Chip8::decodeOp(opcode), pc, m_group.data());
+        ++m_counters.vector_groups;
+        m_counters.vector_instructions += count;
+        return;
+    }
+
+    // The lanes split up, group the ones at the same instruction
+    ++m_counters.divergent_cycles;
+    for(std::size_t lane{}; lane < m_lanes; ++lane)
+    {
+        if(running[lane])
+        {
+            const Chip8::MemoryType& memory{ m_lane_states[lane].memory };
+            m_opcodes[lane] = (memory.read(PC[lane]) << 8) | memory.read(PC[lane] + 1);
+        }
+    }
+    std::copy(m_running.begin(), m_running.end(), m_pending.begin());
+
+    std::size_t groups{};
+    for(std::size_t lane{}; lane < m_lanes; ++lane)
+    {
+        if(!m_pending[lane])
+        {
+            continue;
+        }
+
+        // Too many groups already, looking for more would cost more than it saves
+        if(groups == max_groups)
+        {
+            m_pending[lane] = 0;
+            stepLane(lane);
+            continue;
+        }
+        ++groups;
+
+        Chip8_t::Word group_pc{ PC[lane] };
+        Chip8_t::Word opcode{ m_opcodes[lane] };
+        const Chip8_t::Word* opcodes{ m_opcodes.data() };
+        Chip8_t::Byte* pending{ m_pending.data() };
+        Chip8_t::Byte* group{ m_group.data() };
+        std::size_t size{};
+        for(std::size_t i{}; i < n; ++i)
+        {
+            group[i] = pending[i] & (PC[i] == group_pc ? 0xFF : 0) & (opcodes[i] == opcode ? 0xFF : 0);
+            pending[i] &= ~group[i];
+            size += group[i] & 1;
+        }
+
+        if(size >= min_group_lanes)
+        {
+            stepGroup(Chip8::decodeOp(opcode), group_pc, group);
+            ++m_counters.vector_groups;
+            m_counters.vector_instructions += size;
+            continue;
+        }
+        for(std::size_t i{ lane }; i < m_lanes; ++i)
+        {
+            if(group[i])
+            {
+                stepLane(i);
+            }
+        }
+    }
+}
+
+LOCKSTEP_TARGETS
+void Lockstep::serviceEvents()
+{
+    // Like Chip8::serviceEvents, only for the lanes still running
+    if(m_cycles >= m_next_frame)
+    {
+        const Chip8_t::Byte* running{ m_running.data() };
+        for(std::size_t i{}; i < m_stride; ++i)
+        {
+            m_delay_timer[i] -= running[i] & (m_delay_timer[i] != 0);
+            m_sound_timer[i] -= running[i] & (m_sound_timer[i] != 0);
+        }
+        m_next_frame += m_instructions_per_frame;
+    }
+
+    while(m_next_key_event < m_key_events.size() && m_key_events[m_next_key_event].cycle <= m_cycles)
+    {
+        const KeyEvent& event{ m_key_events[m_next_key_event++] };
+        if(m_running[event.lane])
+        {
+            m_keys[event.key * m_stride + event.lane] = (Chip8_t::Byte)event.state;
+        }
+    }
+}
+
+// --- Member functions ---
+
+std::size_t Lockstep::getLaneCount() const
+{
+    return m_lanes;
+}
+
+void Lockstep::setBehaviourType(Chip8::BehaviourType type)
+{
+    m_behaviour = type;
+    m_quirks = type == Chip8::BehaviourType::CHIP8 ? Quirks::Cosmac::flags : Quirks::SuperChip::flags;
+}
+
+void Lockstep::setQuirkFlags(std::uint8_t flags)
+{
+    m_quirks = flags & Quirks::all_flags;
+}
+
+void Lockstep::setInstructionsPerFrame(std::uint32_t amount)
+{
+    m_instructions_per_frame = std::max<std::uint32_t>(amount, 1);
+    m_next_frame = m_cycles + m_instructions_per_frame;
+}
+
+void Lockstep::setSeed(std::size_t lane, std::uint64_t seed)
+{
+    m_lane_states[lane].seed = seed;
+    m_lane_states[lane].random.seed(seed);
+}
+
+void Lockstep::clearMemory()
+{
+    m_reference.clear();
+    std::copy(Chip8Const::font.begin(), Chip8Const::font.end(), m_reference.view().begin() + Chip8Const::font_begin);
+    m_shared.set();
+    m_rom_hash = 0;
+
+    for(LaneState& state : m_lane_states)
+    {
+        state.memory = m_reference;
+        state.display.setAll(false);
+        state.stack = {};
+        state.random.seed(state.seed);
+        state.stop = Chip8::StopReason::BUDGET;
+    }
+
+    std::fill(m_regs.begin(), m_regs.end(), 0);
+    std::fill(m_PC.begin(), m_PC.end(), Chip8Const::rom_mem_start);
+    std::fill(m_I.begin(), m_I.end(), 0);
+    std::fill(m_delay_timer.begin(), m_delay_timer.end(), 0);
+    std::fill(m_sound_timer.begin(), m_sound_timer.end(), 0);
+    std::fill(m_keys.begin(), m_keys.end(), (Chip8_t::Byte)Chip8::KeyState::UP);
+    std::fill(m_running.begin(), m_running.end(), 0);
+    std::fill(m_running.begin(), m_running.begin() + m_lanes, 0xFF);
+
+    m_cycles = 0;
+    m_next_frame = m_instructions_per_frame;
+    m_key_events.clear();
+    m_next_key_event = 0;
+}
+
+void Lockstep::loadMemory(std::span<const Chip8_t::Byte> rom)
+{
+    // Like Chip8::loadMemory
+    std::span<Chip8_t::Byte> memory{ m_reference.view().subspan(Chip8Const::rom_mem_start) };
+    rom = rom.first(std::min(rom.size(), memory.size()));
+    std::copy(rom.begin(), rom.end(), memory.begin());
+
+    m_rom_hash = 0xCBF29CE484222325;
+    for(Chip8_t::Byte byte : rom)
+    {
+        m_rom_hash = (m_rom_hash ^ byte) * 0x100000001B3;
+    }
+
+    // Every lane has the same ROM now
+    for(LaneState& state : m_lane_states)
+    {
+        std::copy(rom.begin(), rom.end(), state.memory.view().begin() + Chip8Const::rom_mem_start);
+    }
+    for(std::size_t i{}; i < rom.size(); ++i)
+    {
+        m_shared.set(Chip8Const::rom_mem_start + i);
+    }
+}
+
+void Lockstep::setKeyState(std::size_t lane, Chip8_t::Byte which, Chip8::KeyState state)
+{
+    m_keys[(which & (Chip8Const::buttons - 1)) * m_stride + lane] = (Chip8_t::Byte)state;
+}
+
+void Lockstep::queueKeyEvent(std::size_t lane, std::uint64_t cycle, Chip8_t::Byte which, Chip8::KeyState state)
+{
+    // Drop the applied ones first, so the queue doesn't keep growing
+    m_key_events.erase(m_key_events.begin(), m_key_events.begin() + m_next_key_event);
+    m_next_key_event = 0;
+
+    // After the ones queued for the same cycle, Chip8 applies them in the order they were queued
+    KeyEvent event{ std::max(cycle, m_cycles), (std::uint32_t)lane, (Chip8_t::Byte)(which & (Chip8Const::buttons - 1)), state };
+    auto at{ std::upper_bound(m_key_events.begin(), m_key_events.end(), event,
+                              [](const KeyEvent& a, const KeyEvent& b) { return a.cycle < b.cycle; }) };
+    m_key_events.insert(at, event);
+}
+
+std::size_t Lockstep::run(std::uint64_t cycles)
+{
+    // Keys queued for now, like Chip8::run
+    serviceEvents();
+    for(std::uint64_t i{}; i < cycles; ++i)
+    {
+        step();
+        ++m_cycles;
+        serviceEvents();
+    }
+    return (std::size_t)std::count(m_running.begin(), m_running.end(), 0xFF);
+}
+
+std::uint64_t Lockstep::getCycles() const
+{
+    return m_cycles;
+}
+
+Chip8::StopReason Lockstep::getStopReason(std::size_t lane) const
+{
+    return m_lane_states[lane].stop;
+}
+
+void Lockstep::saveState(std::size_t lane, Chip8::MachineState& state) const
+{
+    const LaneState& lane_state{ m_lane_states[lane] };
+    bool stopped{ m_running[lane] == 0 };
+
+    state.memory = lane_state.memory;
+    state.display = lane_state.display;
+    state.stack = lane_state.stack;
+    for(Chip8_t::Byte r{}; r < Chip8Const::reg_amount; ++r)
+    {
+        state.regs.write(r, m_regs[r * m_stride + lane]);
+    }
+    state.PC = m_PC[lane];
+    state.I = m_I[lane];
+    state.delay_timer = m_delay_timer[lane];
+    state.sound_timer = m_sound_timer[lane];
+    for(Chip8_t::Byte which{}; which < Chip8Const::buttons; ++which)
+    {
+        state.keys[which] = key(lane, which);
+    }
+    state.behaviour = m_behaviour;
+    state.quirks = m_quirks;
+    state.timer_mode = Timer::Mode::VIRTUAL;
+    state.instructions_per_frame = m_instructions_per_frame;
+    state.cycles_per_audio_buffer = 0;
+    state.cycles = stopped ? lane_state.stop_cycle : m_cycles;
+    state.next_frame = stopped ? lane_state.stop_next_frame : m_next_frame;
+    state.next_audio = 0;
+    state.rom_hash = m_rom_hash;
+    state.seed = lane_state.seed;
+    state.random = lane_state.random;
+}
+
+void Lockstep::loadState(std::size_t lane, const Chip8::MachineState& state)
+{
+    LaneState& lane_state{ m_lane_states[lane] };
+    lane_state.memory = state.memory;
+    lane_state.display.restore(state.display);
+    lane_state.stack = state.stack;
+    lane_state.seed = state.seed;
+    lane_state.random.setState(state.random.getState());
+    lane_state.stop = Chip8::StopReason::BUDGET;
+
+    for(Chip8_t::Byte r{}; r < Chip8Const::reg_amount; ++r)
+    {
+        m_regs[r * m_stride + lane] = state.regs.read(r);
+    }
+    m_PC[lane] = state.PC;
+    m_I[lane] = state.I;
+    m_delay_timer[lane] = state.delay_timer;
+    m_sound_timer[lane] = state.sound_timer;
+    for(Chip8_t::Byte which{}; which < Chip8Const::buttons; ++which)
+    {
+        setKeyState(lane, which, state.keys[which]);
+    }
+    m_running[lane] = 0xFF;
+
+    // The bytes that differ from the other lanes have to be read from every lane
+    std::span<const Chip8_t::Byte> memory{ lane_state.memory.view() };
+    std::span<const Chip8_t::Byte> reference{ m_reference.view() };
+    for(std::size_t i{}; i < memory.size(); ++i)
+    {
+        if(memory[i] != reference[i])
+        {
+            m_shared.reset(i);
+        }
+    }
+}
+
+const Lockstep::Counters& Lockstep::getCounters() const
+{
+    return m_counters;
+}
+
+void Lockstep::resetCounters()
+{
+    m_counters = {};
+}
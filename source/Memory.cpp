@@ -2,39 +2,11 @@
 #include <iostream>
 
 
-// -- Constructors --
+// -- Functions --
 
-Memory::Memory(std::uint16_t  size) : m_data(size, 0) {}
-
-
-// -- Member functions --
-
-void Memory::write(std::uint16_t where, std::uint8_t what)
+void MemoryAccess::reportOutOfBounds(bool write, std::size_t size, std::size_t where, std::size_t count)
 {
-    if(where >= m_data.size())
-    {
-        std::cout << "Attempting to write out of Memory bounds!\n";
-        std::cout << "The memory is of size (dec): " << (int)m_data.size() << '\n';
-        std::cout << "Attempted to write \'" << std::hex << what << std::dec << "\' to address (dec): " << where << '\n'; 
-        return;
-    }
-
-    m_data[where] = what;
+    std::cout << "Attempting to " << (write ? "write" : "read") << " out of Memory bounds!\n";
+    std::cout << "The memory is of size (dec): " << size << '\n';
+    std::cout << "Attempted to " << (write ? "write " : "read ") << count << " byte(s) at address (dec): " << where << '\n';
 }
-
-std::uint8_t  Memory::read(std::uint16_t where)
-{
-    if(where >= m_data.size())
-    {
-        std::cout << "Attempting to read out of Memory bounds!\n";
-        std::cout << "The memory is of size (dec): " << (int)m_data.size() << '\n';
-        std::cout << "Attempted to read address (dec): " << where << '\n'; 
-        return 0;
-    }
-    return m_data[where];
-}
-
-std::uint16_t  Memory::getSize()
-{
-    return m_data.size();
-}
\ No newline at end of file
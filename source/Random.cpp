@@ -0,0 +1,45 @@
+#include "../header/Random.hpp"
+
+// --- Constructors ---
+
+Random::Random()
+{
+    seed(default_seed);
+}
+
+Random::Random(std::uint64_t seed)
+{
+    this->seed(seed);
+}
+
+// --- Member functions ---
+
+void Random::seed(std::uint64_t seed)
+{
+    // SplitMix64 spreads the seed over the whole state, similar seeds don't give similar numbers and the state is never all zeros
+    for(std::size_t i{}; i < m_state.size(); i += 2)
+    {
+        seed += 0x9E3779B97F4A7C15;
+        std::uint64_t mixed{ seed };
+        mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9;
+        mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EB;
+        mixed ^= mixed >> 31;
+        m_state[i] = (std::uint32_t)mixed;
+        m_state[i + 1] = (std::uint32_t)(mixed >> 32);
+    }
+}
+
+const Random::State& Random::getState() const
+{
+    return m_state;
+}
+
+void Random::setState(const State& state)
+{
+    if(state == State{})
+    {
+        seed(default_seed);
+        return;
+    }
+    m_state = state;
+}
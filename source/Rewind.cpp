@@ -0,0 +1,329 @@
+#include "../header/Rewind.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    // Bytes of the header and the trailer of every record
+    constexpr std::size_t record_overhead{ 8 };
+
+    // Equal bytes shorter than this are kept in the different bytes, a new run would take more
+    constexpr std::size_t min_equal_run{ 8 };
+
+    void writeVarint(std::uint8_t*& out, std::size_t value)
+    {
+        while(value >= 0x80)
+        {
+            *out++ = std::uint8_t(value | 0x80);
+            value >>= 7;
+        }
+        *out++ = std::uint8_t(value);
+    }
+
+    std::size_t readVarint(const std::uint8_t*& in)
+    {
+        std::size_t value{};
+        for(unsigned shift{}; ; shift += 7)
+        {
+            std::uint8_t byte{ *in++ };
+            value |= std::size_t(byte & 0x7F) << shift;
+            if((byte & 0x80) == 0)
+            {
+                return value;
+            }
+        }
+    }
+}
+
+// --- Constructors ---
+
+Rewind::Rewind() {}
+
+Rewind::Rewind(std::size_t budget, std::size_t snapshot_size, std::uint32_t keyframe_interval) :
+    m_data(budget),
+    m_snapshot_size{snapshot_size},
+    m_keyframe_interval{std::max<std::uint32_t>(keyframe_interval, 1)},
+    m_keyframe(snapshot_size),
+    // Every byte different is the worst case, one run plus the lengths
+    m_encoded(snapshot_size + 32)
+{}
+
+// --- Private member functions ---
+
+void Rewind::encode(std::span<const std::uint8_t> snapshot, std::span<const std::uint8_t> base)
+{
+    auto differs{ [&](std::size_t i) { return snapshot[i] != (base.empty() ? 0 : base[i]); } };
+
+    std::uint8_t* out{ m_encoded.data() };
+    std::size_t i{};
+    while(i < snapshot.size())
+    {
+        // Equal bytes, compared a word at a time while there are enough of them
+        std::size_t equal_start{ i };
+        while(i + 8 <= snapshot.size())
+        {
+            std::uint64_t a{}, b{};
+            std::memcpy(&a, snapshot.data() + i, 8);
+            if(!base.empty())
+            {
+                std::memcpy(&b, base.data() + i, 8);
+            }
+            if(a != b)
+            {
+                break;
+            }
+            i += 8;
+        }
+        while(i < snapshot.size() && !differs(i))
+        {
+            ++i;
+        }
+        std::size_t equal{ i - equal_start };
+
+        // Different bytes, until enough equal ones follow
+        std::size_t different_start{ i };
+        std::size_t run_end{ i };
+        while(i < snapshot.size())
+        {
+            if(differs(i))
+            {
+                run_end = ++i;
+            }
+            else if(i - run_end + 1 >= min_equal_run)
+            {
+                break;
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        i = run_end;
+
+        if(run_end == different_start)
+        {
+            // Only equal bytes up to the end, they don't need to be stored
+            break;
+        }
+        writeVarint(out, equal);
+        writeVarint(out, run_end - different_start);
+        for(std::size_t j{ different_start }; j < run_end; ++j)
+        {
+            *out++ = snapshot[j] ^ (base.empty() ? 0 : base[j]);
+        }
+    }
+
+    m_encoded.resize(out - m_encoded.data());
+}
+
+void Rewind::decode(std::span<const std::uint8_t> encoded, std::span<std::uint8_t> to)
+{
+    const std::uint8_t* in{ encoded.data() };
+    const std::uint8_t* end{ encoded.data() + encoded.size() };
+    std::size_t position{};
+    while(in < end)
+    {
+        position += readVarint(in);
+        std::size_t different{ readVarint(in) };
+        for(std::size_t j{}; j < different; ++j)
+        {
+            to[position++] ^= *in++;
+        }
+    }
+}
+
+bool Rewind::readHeader(std::size_t at, std::size_t& size) const
+{
+    std::uint32_t header{};
+    std::memcpy(&header, m_data.data() + at, sizeof(header));
+    size = header >> 1;
+    return (header & 1) != 0;
+}
+
+std::size_t Rewind::previousRecord(std::size_t at) const
+{
+    // A record that would have gone past the end of the ring was put at the start instead
+    std::size_t end{ at == 0 && m_wrapped ? m_wrap_end : at };
+    std::size_t size{};
+    readHeader(end - 4, size);
+    return end - size - record_overhead;
+}
+
+void Rewind::dropOldest()
+{
+    std::size_t size{};
+    do
+    {
+        readHeader(m_tail, size);
+        m_tail += size + record_overhead;
+        --m_count;
+        if(m_wrapped && m_tail == m_wrap_end)
+        {
+            m_tail = 0;
+            m_wrapped = false;
+        }
+    // The records up to the next keyframe can't be decoded without this one
+    } while(m_count > 0 && !readHeader(m_tail, size));
+}
+
+// --- Member functions ---
+
+bool Rewind::push(std::span<const std::uint8_t> snapshot)
+{
+    if(!isEnabled())
+    {
+        return false;
+    }
+
+    // Nothing to base the snapshot on, or the group of the keyframe is full
+    bool keyframe{ m_count == 0 || m_since_keyframe + 1 >= m_keyframe_interval };
+    m_encoded.resize(m_snapshot_size + 32);
+    encode(snapshot, keyframe ? std::span<const std::uint8_t>{} : std::span<const std::uint8_t>{m_keyframe});
+
+    // Make room, dropping the oldest records
+    std::size_t total{ m_encoded.size() + record_overhead };
+    if(total > m_data.size())
+    {
+        return false;
+    }
+    while(true)
+    {
+        if(m_count == 0)
+        {
+            m_head = 0;
+            m_tail = 0;
+            m_wrapped = false;
+            if(!keyframe)
+            {
+                // The keyframe it was based on got dropped
+                keyframe = true;
+                m_encoded.resize(m_snapshot_size + 32);
+                encode(snapshot, {});
+                total = m_encoded.size() + record_overhead;
+                if(total > m_data.size())
+                {
+                    return false;
+                }
+            }
+        }
+
+        if(!m_wrapped)
+        {
+            if(m_head + total <= m_data.size())
+            {
+                break;
+            }
+            if(total <= m_tail)
+            {
+                m_wrap_end = m_head;
+                m_head = 0;
+                m_wrapped = true;
+                break;
+            }
+        }
+        else if(m_head + total <= m_tail)
+        {
+            break;
+        }
+        dropOldest();
+    }
+
+    std::uint32_t header{ std::uint32_t(m_encoded.size() << 1) | (keyframe ? 1 : 0) };
+    std::memcpy(m_data.data() + m_head, &header, sizeof(header));
+    std::memcpy(m_data.data() + m_head + 4, m_encoded.data(), m_encoded.size());
+    std::memcpy(m_data.data() + m_head + 4 + m_encoded.size(), &header, sizeof(header));
+    m_head += total;
+    ++m_count;
+
+    if(keyframe)
+    {
+        std::copy(snapshot.begin(), snapshot.end(), m_keyframe.begin());
+        m_since_keyframe = 0;
+    }
+    else
+    {
+        ++m_since_keyframe;
+    }
+    return true;
+}
+
+bool Rewind::pop(std::span<std::uint8_t> snapshot)
+{
+    if(m_count == 0)
+    {
+        return false;
+    }
+
+    std::size_t start{ previousRecord(m_head) };
+    if(m_head == 0 && m_wrapped)
+    {
+        m_wrapped = false;
+    }
+    std::size_t size{};
+    bool keyframe{ readHeader(start, size) };
+    std::span<const std::uint8_t> encoded{ m_data.data() + start + 4, size };
+
+    // Every record after the newest keyframe is based on it
+    if(keyframe)
+    {
+        std::fill(snapshot.begin(), snapshot.end(), 0);
+    }
+    else
+    {
+        std::copy(m_keyframe.begin(), m_keyframe.end(), snapshot.begin());
+    }
+    decode(encoded, snapshot);
+    m_head = start;
+    --m_count;
+
+    if(!keyframe)
+    {
+        --m_since_keyframe;
+        return true;
+    }
+
+    // The records left are based on the keyframe before, find it
+    m_since_keyframe = 0;
+    std::size_t at{ m_head };
+    for(std::size_t i{}; i < m_count; ++i)
+    {
+        at = previousRecord(at);
+        std::size_t keyframe_size{};
+        if(readHeader(at, keyframe_size))
+        {
+            std::fill(m_keyframe.begin(), m_keyframe.end(), 0);
+            decode({ m_data.data() + at + 4, keyframe_size }, m_keyframe);
+            break;
+        }
+        ++m_since_keyframe;
+    }
+    return true;
+}
+
+void Rewind::clear()
+{
+    m_head = 0;
+    m_tail = 0;
+    m_wrapped = false;
+    m_count = 0;
+    m_since_keyframe = 0;
+}
+
+std::size_t Rewind::getCount() const
+{
+    return m_count;
+}
+
+std::size_t Rewind::getUsed() const
+{
+    if(m_count == 0)
+    {
+        return 0;
+    }
+    return m_wrapped ? (m_wrap_end - m_tail) + m_head : m_head - m_tail;
+}
+
+bool Rewind::isEnabled() const
+{
+    return !m_data.empty();
+}
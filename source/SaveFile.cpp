@@ -0,0 +1,411 @@
+#include "../header/SaveFile.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SAVE_FILE_POSIX
+#endif
+
+static_assert(std::endian::native == std::endian::little, "Save files are little endian, the sections are copied as they are");
+static_assert(sizeof(SaveFile::Header) == 32 && sizeof(SaveFile::SectionHeader) == 8, "The layout of the file can't change");
+static_assert(sizeof(SaveFile::CpuSection) == 54 && sizeof(SaveFile::TimingSection) == 40, "The layout of the file can't change");
+static_assert(sizeof(SaveFile::RandomSection) == 24, "The layout of the file can't change");
+
+namespace
+{
+    constexpr std::size_t align(std::size_t size)
+    {
+        return (size + 7) & ~std::size_t(7);
+    }
+
+    constexpr std::size_t words_per_row{ Display::max_width / 64 };
+
+    // The most a file written by this version can take, so it's built on the stack
+    constexpr std::size_t max_file_size
+    {
+        sizeof(SaveFile::Header) +
+        sizeof(SaveFile::SectionHeader) * 6 +
+        align(Chip8Const::mem_size) +
+        align(sizeof(SaveFile::CpuSection)) +
+        align(sizeof(SaveFile::TimingSection)) +
+        align(sizeof(SaveFile::KeysSection)) +
+        align(sizeof(SaveFile::DisplaySection) + Display::max_height * words_per_row * 8) +
+        align(sizeof(SaveFile::RandomSection))
+    };
+
+    // Appends sections to a buffer
+    class Writer
+    {
+    private:
+        std::array<std::uint8_t, max_file_size> m_data{};
+        std::size_t m_size{};
+    public:
+        void append(const void* data, std::size_t size)
+        {
+            std::memcpy(m_data.data() + m_size, data, size);
+            m_size += size;
+        }
+
+        // Starts a section of 'size' bytes, the data has to be appended right after
+        void beginSection(std::uint32_t id, std::size_t size)
+        {
+            SaveFile::SectionHeader header{ id, (std::uint32_t)size };
+            append(&header, sizeof(header));
+        }
+
+        // Pads the section to 8 bytes, the padding is already zeroed
+        void endSection()
+        {
+            m_size = align(m_size);
+        }
+
+        std::uint8_t* data()
+        {
+            return m_data.data();
+        }
+
+        std::size_t size() const
+        {
+            return m_size;
+        }
+    };
+
+    // Copies the known part of a section, the fields the section is too old to have keep their defaults
+    template <typename Section>
+    Section readSection(const std::uint8_t* data, std::uint32_t size)
+    {
+        Section section{};
+        std::memcpy(&section, data, std::min<std::size_t>(size, sizeof(Section)));
+        return section;
+    }
+
+    // Checks the header and the section headers, so reading can't fail half way through
+    bool validate(const std::uint8_t* data, std::size_t size, const std::string& path)
+    {
+        if(size < sizeof(SaveFile::Header))
+        {
+            std::cout << "Save file " << path << " is too small!\n";
+            return false;
+        }
+
+        SaveFile::Header header{};
+        std::memcpy(&header, data, sizeof(header));
+        if(header.magic != SaveFile::magic)
+        {
+            std::cout << "Save file " << path << " isn't a save file!\n";
+            return false;
+        }
+        if(header.version_major != SaveFile::version_major)
+        {
+            std::cout << "Save file " << path << " is from an incompatible version (" << header.version_major << ")!\n";
+            return false;
+        }
+        if(header.header_size < sizeof(header) || header.header_size > size)
+        {
+            std::cout << "Save file " << path << " has an invalid header!\n";
+            return false;
+        }
+
+        bool has_memory{};
+        bool has_cpu{};
+        std::size_t position{ header.header_size };
+        for(std::uint32_t i{}; i < header.section_count; ++i)
+        {
+            SaveFile::SectionHeader section{};
+            if(position + sizeof(section) > size)
+            {
+                std::cout << "Save file " << path << " is cut off!\n";
+                return false;
+            }
+            std::memcpy(&section, data + position, sizeof(section));
+            position += sizeof(section);
+            if(section.size > size - position)
+            {
+                std::cout << "Save file " << path << " is cut off!\n";
+                return false;
+            }
+
+            if(section.id == SaveFile::DISPLAY)
+            {
+                SaveFile::DisplaySection display{ readSection<SaveFile::DisplaySection>(data + position, section.size) };
+                if(section.size < sizeof(display) || display.words_per_row == 0 ||
+                   section.size - sizeof(display) < std::size_t(display.height) * display.words_per_row * 8)
+                {
+                    std::cout << "Save file " << path << " has an invalid display!\n";
+                    return false;
+                }
+            }
+            has_memory |= section.id == SaveFile::MEMORY;
+            has_cpu |= section.id == SaveFile::CPU;
+            position += align(section.size);
+        }
+
+        if(!has_memory || !has_cpu)
+        {
+            std::cout << "Save file " << path << " is missing the memory or the CPU!\n";
+            return false;
+        }
+        return true;
+    }
+
+    // The file has to be validated first
+    void parse(const std::uint8_t* data, Chip8::MachineState& state)
+    {
+        // What the file doesn't have keeps the defaults
+        state = {};
+
+        SaveFile::Header header{};
+        std::memcpy(&header, data, sizeof(header));
+        state.rom_hash = header.rom_hash;
+        state.quirks = header.quirks;
+        state.behaviour = header.behaviour < (std::uint8_t)Chip8::BehaviourType::INVALID ? (Chip8::BehaviourType)header.behaviour : Chip8::BehaviourType::CHIP8;
+        state.timer_mode = header.timer_mode == (std::uint8_t)Timer::Mode::VIRTUAL ? Timer::Mode::VIRTUAL : Timer::Mode::WALL_CLOCK;
+
+        std::size_t position{ header.header_size };
+        for(std::uint32_t i{}; i < header.section_count; ++i)
+        {
+            SaveFile::SectionHeader section{};
+            std::memcpy(&section, data + position, sizeof(section));
+            position += sizeof(section);
+            const std::uint8_t* body{ data + position };
+            position += align(section.size);
+
+            switch(section.id)
+            {
+                case SaveFile::MEMORY:
+                {
+                    std::span<std::uint8_t> memory{ state.memory.view() };
+                    std::memcpy(memory.data(), body, std::min<std::size_t>(section.size, memory.size()));
+                    break;
+                }
+                case SaveFile::CPU:
+                {
+                    SaveFile::CpuSection cpu{ readSection<SaveFile::CpuSection>(body, section.size) };
+                    state.PC = cpu.PC;
+                    state.I = cpu.I;
+                    for(Chip8_t::Byte reg{}; reg < Chip8Const::reg_amount; ++reg)
+                    {
+                        state.regs.write(reg, cpu.regs[reg]);
+                    }
+                    state.stack = {};
+                    for(std::size_t depth{}; depth < std::min<std::size_t>(cpu.stack_depth, Chip8Const::stack_size); ++depth)
+                    {
+                        state.stack.push(cpu.stack[depth]);
+                    }
+                    break;
+                }
+                case SaveFile::TIMING:
+                {
+                    SaveFile::TimingSection timing{ readSection<SaveFile::TimingSection>(body, section.size) };
+                    state.delay_timer = timing.delay_timer;
+                    state.sound_timer = timing.sound_timer;
+                    state.instructions_per_frame = timing.instructions_per_frame;
+                    state.cycles_per_audio_buffer = timing.cycles_per_audio_buffer;
+                    state.cycles = timing.cycles;
+                    state.next_frame = timing.next_frame;
+                    state.next_audio = timing.next_audio;
+                    break;
+                }
+                case SaveFile::KEYS:
+                {
+                    SaveFile::KeysSection keys{ readSection<SaveFile::KeysSection>(body, section.size) };
+                    for(std::size_t key{}; key < state.keys.size(); ++key)
+                    {
+                        state.keys[key] = (Chip8::KeyState)std::min<std::uint8_t>(keys.states[key], (std::uint8_t)Chip8::KeyState::JUST_RELEASED);
+                    }
+                    break;
+                }
+                case SaveFile::DISPLAY:
+                {
+                    SaveFile::DisplaySection display{ readSection<SaveFile::DisplaySection>(body, section.size) };
+                    const std::uint8_t* rows{ body + sizeof(display) };
+                    state.display.setAll(false);
+                    Chip8_t::Word height{ std::min(display.height, state.display.getHeight()) };
+                    for(Chip8_t::Word y{}; y < height; ++y)
+                    {
+                        Display::Row row{};
+                        std::memcpy(row.data(), rows + std::size_t(y) * display.words_per_row * 8,
+                                    std::min<std::size_t>(display.words_per_row, row.size()) * 8);
+                        state.display.setRow(y, row);
+                    }
+                    break;
+                }
+                case SaveFile::RANDOM:
+                {
+                    SaveFile::RandomSection random{ readSection<SaveFile::RandomSection>(body, section.size) };
+                    Random::State random_state{};
+                    std::copy(std::begin(random.state), std::end(random.state), random_state.begin());
+                    state.seed = random.seed;
+                    state.random.setState(random_state);
+                    break;
+                }
+                default:
+                {
+                    // From a newer version
+                    break;
+                }
+            }
+        }
+    }
+}
+
+bool SaveFile::write(const std::string& path, const Chip8::MachineState& state)
+{
+    Writer writer{};
+
+    Header header{};
+    header.section_count = 6;
+    header.rom_hash = state.rom_hash;
+    header.quirks = state.quirks;
+    header.behaviour = (std::uint8_t)state.behaviour;
+    header.timer_mode = (std::uint8_t)state.timer_mode;
+    writer.append(&header, sizeof(header));
+
+    std::span<const std::uint8_t> memory{ state.memory.view() };
+    writer.beginSection(MEMORY, memory.size());
+    writer.append(memory.data(), memory.size());
+    writer.endSection();
+
+    CpuSection cpu{};
+    cpu.PC = state.PC;
+    cpu.I = state.I;
+    for(Chip8_t::Byte reg{}; reg < Chip8Const::reg_amount; ++reg)
+    {
+        cpu.regs[reg] = state.regs.read(reg);
+    }
+    std::span<const std::uint16_t> stack{ state.stack.view() };
+    cpu.stack_depth = (std::uint8_t)stack.size();
+    std::copy(stack.begin(), stack.end(), cpu.stack);
+    writer.beginSection(CPU, sizeof(cpu));
+    writer.append(&cpu, sizeof(cpu));
+    writer.endSection();
+
+    TimingSection timing{};
+    timing.delay_timer = state.delay_timer;
+    timing.sound_timer = state.sound_timer;
+    timing.instructions_per_frame = state.instructions_per_frame;
+    timing.cycles_per_audio_buffer = state.cycles_per_audio_buffer;
+    timing.cycles = state.cycles;
+    timing.next_frame = state.next_frame;
+    timing.next_audio = state.next_audio;
+    writer.beginSection(TIMING, sizeof(timing));
+    writer.append(&timing, sizeof(timing));
+    writer.endSection();
+
+    KeysSection keys{};
+    for(std::size_t key{}; key < state.keys.size(); ++key)
+    {
+        keys.states[key] = (std::uint8_t)state.keys[key];
+    }
+    writer.beginSection(KEYS, sizeof(keys));
+    writer.append(&keys, sizeof(keys));
+    writer.endSection();
+
+    // Only the rows and words the display has
+    DisplaySection display{};
+    display.width = state.display.getWidth();
+    display.height = state.display.getHeight();
+    display.words_per_row = (display.width + 63) / 64;
+    writer.beginSection(DISPLAY, sizeof(display) + std::size_t(display.height) * display.words_per_row * 8);
+    writer.append(&display, sizeof(display));
+    for(Chip8_t::Word y{}; y < display.height; ++y)
+    {
+        writer.append(state.display.getRow(y).data(), std::size_t(display.words_per_row) * 8);
+    }
+    writer.endSection();
+
+    RandomSection random{};
+    random.seed = state.seed;
+    std::copy(state.random.getState().begin(), state.random.getState().end(), random.state);
+    writer.beginSection(RANDOM, sizeof(random));
+    writer.append(&random, sizeof(random));
+    writer.endSection();
+
+    // Written next to the old file first, so a failed write doesn't lose the old state
+    std::string temporary{ path + ".tmp" };
+#ifdef SAVE_FILE_POSIX
+    int file{ open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644) };
+    if(file < 0)
+    {
+        return false;
+    }
+    bool written{ ::write(file, writer.data(), writer.size()) == (ssize_t)writer.size() };
+    written &= close(file) == 0;
+#else
+    std::ofstream file{ temporary, std::ios::binary };
+    file.write(reinterpret_cast<const char*>(writer.data()), writer.size());
+    file.close();
+    bool written{ file.good() };
+#endif
+    if(!written || std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool SaveFile::read(const std::string& path, Chip8::MachineState& state)
+{
+#ifdef SAVE_FILE_POSIX
+    int file{ open(path.c_str(), O_RDONLY) };
+    if(file < 0)
+    {
+        return false;
+    }
+    struct stat info{};
+    if(fstat(file, &info) != 0 || info.st_size <= 0)
+    {
+        close(file);
+        return false;
+    }
+
+    std::size_t size{ (std::size_t)info.st_size };
+    void* mapped{ mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0) };
+    close(file);
+    if(mapped == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const std::uint8_t* data{ static_cast<const std::uint8_t*>(mapped) };
+    bool valid{ validate(data, size, path) };
+    if(valid)
+    {
+        parse(data, state);
+    }
+    munmap(mapped, size);
+    return valid;
+#else
+    std::ifstream file{ path, std::ios::binary | std::ios::ate };
+    if(!file.is_open())
+    {
+        return false;
+    }
+    std::vector<std::uint8_t> data(file.tellg());
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), data.size());
+
+    bool valid{ file.good() && validate(data.data(), data.size(), path) };
+    if(valid)
+    {
+        parse(data.data(), state);
+    }
+    return valid;
+#endif
+}
+
+std::string SaveFile::getSlotPath(const std::string& rom_path, unsigned slot)
+{
+    return rom_path + ".state" + std::to_string(slot);
+}
@@ -5,21 +5,33 @@ std::int64_t Timer::getTime()
     return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 }
 
-Timer::Timer()
+Timer::Timer(Mode mode) : m_mode{mode}
 {
     m_start_val = 0;
-    m_time_started = getTime();
+    if(m_mode == Mode::WALL_CLOCK)
+    {
+        m_time_started = getTime();
+    }
 }
 
 void Timer::set(std::uint8_t value)
 {
     m_start_val = value;
     m_value = value;
-    m_time_started = getTime();
+    if(m_mode == Mode::WALL_CLOCK)
+    {
+        m_time_started = getTime();
+    }
 }
 
 void Timer::update()
 {
+    // Virtual timers only change on tick
+    if(m_mode == Mode::VIRTUAL)
+    {
+        return;
+    }
+
     //std::cout << "Timer updating.\n";
     int64_t now{ getTime() };
     double elapsed{ ((now - m_time_started)/1000.0) };
@@ -40,4 +52,40 @@ std::uint8_t Timer::get()
 {
     update();
     return m_value;
+}
+
+std::int64_t Timer::getTimeUntilTick()
+{
+    update();
+    if(m_value == 0 || m_mode == Mode::VIRTUAL)
+    {
+        return -1;
+    }
+
+    // The value goes down once every 1/60 of a second since it was set
+    std::int64_t ticks{ m_start_val - m_value };
+    std::int64_t next_tick{ m_time_started + ((ticks + 1) * 1000 + 59) / 60 };
+    std::int64_t until{ next_tick - getTime() };
+    return until > 0 ? until : 0;
+}
+
+void Timer::tick(std::uint64_t ticks)
+{
+    if(m_mode != Mode::VIRTUAL)
+    {
+        return;
+    }
+    m_value = ticks >= m_value ? 0 : m_value - ticks;
+}
+
+void Timer::setMode(Mode mode)
+{
+    update();
+    m_mode = mode;
+    set(m_value);
+}
+
+Timer::Mode Timer::getMode()
+{
+    return m_mode;
 }
\ No newline at end of file
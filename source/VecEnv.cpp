@@ -0,0 +1,439 @@
+#include "../header/VecEnv.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    //  Name:           parseNumber
+    //  Description:    reads a whole word as a number, decimal or hex with 0x
+    //  Arguments:      word - the word
+    //                  value - set to the number
+    //  Return:         false if the word isn't a number
+    bool parseNumber(const std::string& word, unsigned long long& value)
+    {
+        char* end{};
+        value = std::strtoull(word.c_str(), &end, 0);
+        return !word.empty() && *end == '\0';
+    }
+}
+
+// --- Constructors ---
+
+VecEnv::VecEnv(const Options& options, const Spec& spec) :
+    m_options{ options },
+    m_spec{ spec },
+    m_environments(std::max<std::size_t>(options.environments, 1))
+{
+    m_options.environments = m_environments.size();
+    m_options.frame_skip = std::max<std::uint32_t>(m_options.frame_skip, 1);
+    m_options.instructions_per_frame = std::max<std::uint32_t>(m_options.instructions_per_frame, 1);
+    if(m_spec.rewards.size() > max_reward_terms)
+    {
+        std::cout << "Only the first " << max_reward_terms << " reward terms are used!\n";
+        m_spec.rewards.resize(max_reward_terms);
+    }
+
+    for(Environment& environment : m_environments)
+    {
+        environment.emulator = std::make_unique<Chip8>();
+        environment.emulator->setBehaviourType(m_options.behaviour);
+        environment.emulator->setTimerMode(Timer::Mode::VIRTUAL);
+        environment.emulator->setInstructionsPerFrame(m_options.instructions_per_frame);
+        environment.emulator->setBackend(m_options.backend);
+    }
+
+    // Small chunks so a thread that got slow environments doesn't hold the rest up, big enough to not fight over the counter
+    std::size_t threads{ m_options.threads > 0 ? m_options.threads : std::max(std::thread::hardware_concurrency(), 1u) };
+    threads = std::min(threads, m_environments.size());
+    m_chunk = std::max<std::size_t>(m_environments.size() / (threads * 8), 1);
+    for(std::size_t i{ 1 }; i < threads; ++i)
+    {
+        m_workers.emplace_back(&VecEnv::work, this);
+    }
+}
+
+VecEnv::~VecEnv()
+{
+    {
+        std::lock_guard<std::mutex> lock{ m_mutex };
+        m_quit = true;
+    }
+    m_start.notify_all();
+    for(std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+// --- Private member functions ---
+
+std::int64_t VecEnv::readTerm(Chip8& emulator, const RewardTerm& term)
+{
+    std::int64_t value{};
+    for(Chip8_t::Byte i{}; i < term.bytes; ++i)
+    {
+        Chip8_t::Byte byte{ emulator.getMemoryAt((term.address + i) % Chip8Const::mem_size) };
+        value = term.bcd ? value * 10 + byte : (value << 8) | byte;
+    }
+    return value;
+}
+
+bool VecEnv::isDone(Environment& environment) const
+{
+    for(const DoneCondition& condition : m_spec.done)
+    {
+        Chip8_t::Byte value{ (Chip8_t::Byte)(environment.emulator->getMemoryAt(condition.address) & condition.mask) };
+        if((value == condition.value) == condition.equal)
+        {
+            return true;
+        }
+    }
+    return m_spec.max_frames > 0 && environment.frames >= m_spec.max_frames;
+}
+
+void VecEnv::resetEnvironment(std::size_t index)
+{
+    Environment& environment{ m_environments[index] };
+    Chip8& emulator{ *environment.emulator };
+    emulator.loadState(*m_reset_state);
+    emulator.setSeed(m_options.seed + index + environment.episodes * m_environments.size());
+
+    environment.held = 0;
+    environment.frames = 0;
+    ++environment.episodes;
+    for(std::size_t i{}; i < m_spec.rewards.size(); ++i)
+    {
+        environment.values[i] = readTerm(emulator, m_spec.rewards[i]);
+    }
+}
+
+bool VecEnv::stepEnvironment(std::size_t index, std::uint16_t action, float& reward)
+{
+    Environment& environment{ m_environments[index] };
+    Chip8& emulator{ *environment.emulator };
+    std::uint32_t instructions_per_frame{ emulator.getInstructionsPerFrame() };
+
+    // Like the frontend, a key let go of is JUST_RELEASED (what FX0A waits for) for a frame
+    for(Chip8_t::Byte key{}; key < Chip8Const::buttons; ++key)
+    {
+        bool down{ ((action >> key) & 1) != 0 };
+        bool was_down{ ((environment.held >> key) & 1) != 0 };
+        if(down)
+        {
+            emulator.setKeyState(key, Chip8::KeyState::DOWN);
+        }
+        else if(was_down)
+        {
+            emulator.setKeyState(key, Chip8::KeyState::JUST_RELEASED);
+            emulator.queueKeyEvent(emulator.getCycles() + instructions_per_frame, key, Chip8::KeyState::UP);
+        }
+    }
+    environment.held = action;
+
+    // The episode can end in the middle of the step, the frames after it aren't run
+    bool done{};
+    for(std::uint32_t frame{}; frame < m_options.frame_skip && !done; ++frame)
+    {
+        std::uint64_t end{ emulator.getCycles() + instructions_per_frame };
+        while(emulator.getCycles() < end)
+        {
+            Chip8::RunResult result{ emulator.run(end - emulator.getCycles()) };
+            if(result.reason == Chip8::StopReason::STACK_OVERFLOW || result.reason == Chip8::StopReason::STACK_UNDERFLOW)
+            {
+                done = true;
+                break;
+            }
+        }
+        ++environment.frames;
+        done = done || isDone(environment);
+    }
+
+    reward = 0;
+    for(std::size_t i{}; i < m_spec.rewards.size(); ++i)
+    {
+        std::int64_t value{ readTerm(emulator, m_spec.rewards[i]) };
+        reward += (float)(value - environment.values[i]) * m_spec.rewards[i].scale;
+        environment.values[i] = value;
+    }
+    return done;
+}
+
+void VecEnv::writeObservation(std::size_t index)
+{
+    Chip8& emulator{ *m_environments[index].emulator };
+    std::uint8_t* to{ m_observations.data() + index * getObservationSize() };
+    for(Chip8_t::Word y{}; y < Chip8Const::screen_height; ++y)
+    {
+        // The display is 64 pixels wide, so the whole row is in the first word
+        std::uint64_t word{ emulator.getDisplayRow(y)[0] };
+        if(m_options.observation == Observation::PACKED)
+        {
+            for(std::size_t byte{}; byte < Chip8Const::screen_width / 8; ++byte)
+            {
+                *to++ = (std::uint8_t)(word >> (56 - byte * 8));
+            }
+        }
+        else
+        {
+            for(std::size_t x{}; x < Chip8Const::screen_width; ++x)
+            {
+                *to++ = (std::uint8_t)((word >> (63 - x)) & 1);
+            }
+        }
+    }
+}
+
+void VecEnv::doJob()
+{
+    std::size_t count{ m_environments.size() };
+    for(std::size_t first{ m_next_environment.fetch_add(m_chunk) }; first < count; first = m_next_environment.fetch_add(m_chunk))
+    {
+        for(std::size_t index{ first }; index < std::min(first + m_chunk, count); ++index)
+        {
+            if(m_job == Job::RESET)
+            {
+                resetEnvironment(index);
+            }
+            else
+            {
+                bool done{ stepEnvironment(index, m_actions[index], m_rewards[index]) };
+                m_dones[index] = done ? 1 : 0;
+                if(done && m_options.auto_reset)
+                {
+                    resetEnvironment(index);
+                }
+            }
+            writeObservation(index);
+        }
+    }
+}
+
+void VecEnv::runJob()
+{
+    m_next_environment = 0;
+    {
+        std::lock_guard<std::mutex> lock{ m_mutex };
+        ++m_generation;
+        m_busy = m_workers.size();
+    }
+    m_start.notify_all();
+
+    doJob();
+
+    std::unique_lock<std::mutex> lock{ m_mutex };
+    m_finished.wait(lock, [this]() { return m_busy == 0; });
+}
+
+void VecEnv::work()
+{
+    std::uint64_t generation{};
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock{ m_mutex };
+            m_start.wait(lock, [&]() { return m_quit || m_generation != generation; });
+            if(m_quit)
+            {
+                return;
+            }
+            generation = m_generation;
+        }
+
+        doJob();
+
+        std::lock_guard<std::mutex> lock{ m_mutex };
+        if(--m_busy == 0)
+        {
+            m_finished.notify_one();
+        }
+    }
+}
+
+bool VecEnv::checkBuffers(std::span<std::uint8_t> observations, std::size_t actions, std::size_t rewards, std::size_t dones) const
+{
+    std::size_t count{ m_environments.size() };
+    if(m_reset_state == nullptr)
+    {
+        std::cout << "No ROM was loaded!\n";
+        return false;
+    }
+    if(observations.size() < count * getObservationSize())
+    {
+        std::cout << "The observations need " << count * getObservationSize() << " bytes, got " << observations.size() << "!\n";
+        return false;
+    }
+    if(actions < count || rewards < count || dones < count)
+    {
+        std::cout << "Expected " << count << " actions, rewards and done flags, got " << actions << ", " << rewards << " and " << dones << "!\n";
+        return false;
+    }
+    return true;
+}
+
+// --- Member functions ---
+
+bool VecEnv::readSpec(const std::string& path, Spec& spec)
+{
+    std::ifstream file{ path };
+    if(!file.is_open())
+    {
+        std::cout << "Couldn't open " << path << "!\n";
+        return false;
+    }
+
+    std::string line{};
+    for(int number{ 1 }; std::getline(file, line); ++number)
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream words{ line };
+        std::string kind{};
+        if(!(words >> kind))
+        {
+            // Empty line
+            continue;
+        }
+
+        bool valid{};
+        std::string word{};
+        unsigned long long value{};
+        if(kind == "reward" && words >> word && parseNumber(word, value) && value < Chip8Const::mem_size)
+        {
+            RewardTerm term{};
+            term.address = (Chip8_t::Word)value;
+            valid = true;
+            while(valid && words >> word)
+            {
+                if(word == "bcd")
+                {
+                    term.bcd = true;
+                }
+                else if(word == "bytes")
+                {
+                    valid = words >> word && parseNumber(word, value) && value >= 1 && value <= 4;
+                    term.bytes = (Chip8_t::Byte)value;
+                }
+                else if(word == "scale")
+                {
+                    valid = (bool)(words >> term.scale);
+                }
+                else
+                {
+                    valid = false;
+                }
+            }
+            spec.rewards.push_back(term);
+        }
+        else if(kind == "done" && words >> word && parseNumber(word, value) && value < Chip8Const::mem_size)
+        {
+            DoneCondition condition{};
+            condition.address = (Chip8_t::Word)value;
+            std::string compare{};
+            valid = words >> compare >> word && (compare == "eq" || compare == "ne") && parseNumber(word, value) && value <= 0xFF;
+            condition.equal = compare == "eq";
+            condition.value = (Chip8_t::Byte)value;
+            if(valid && words >> word)
+            {
+                valid = word == "mask" && words >> word && parseNumber(word, value) && value <= 0xFF;
+                condition.mask = (Chip8_t::Byte)value;
+            }
+            spec.done.push_back(condition);
+        }
+        else if(kind == "max_frames" && words >> word && parseNumber(word, value))
+        {
+            spec.max_frames = value;
+            valid = !(words >> word);
+        }
+
+        if(!valid)
+        {
+            std::cout << path << ":" << number << ": expected \"reward <address> [bytes n] [bcd] [scale x]\", "
+                      << "\"done <address> <eq|ne> <value> [mask m]\" or \"max_frames <n>\"\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+std::size_t VecEnv::getObservationSize() const
+{
+    return m_options.observation == Observation::PACKED ? packed_size : unpacked_size;
+}
+
+std::size_t VecEnv::getEnvironmentCount() const
+{
+    return m_environments.size();
+}
+
+void VecEnv::saveResetState()
+{
+    Chip8::MachineState state{};
+    m_environments.front().emulator->saveState(state);
+    setResetState(state);
+}
+
+bool VecEnv::loadMemory(const std::string& path)
+{
+    Chip8& emulator{ *m_environments.front().emulator };
+    emulator.clearMemory();
+    if(!emulator.loadMemory(path))
+    {
+        return false;
+    }
+    saveResetState();
+    return true;
+}
+
+void VecEnv::loadMemory(std::span<const Chip8_t::Byte> rom)
+{
+    Chip8& emulator{ *m_environments.front().emulator };
+    emulator.clearMemory();
+    emulator.loadMemory(rom);
+    saveResetState();
+}
+
+void VecEnv::setResetState(const Chip8::MachineState& state)
+{
+    m_reset_state = std::make_unique<Chip8::MachineState>(state);
+    for(Environment& environment : m_environments)
+    {
+        environment.episodes = 0;
+    }
+}
+
+bool VecEnv::reset(std::span<std::uint8_t> observations)
+{
+    std::size_t count{ m_environments.size() };
+    if(!checkBuffers(observations, count, count, count))
+    {
+        return false;
+    }
+    m_job = Job::RESET;
+    m_observations = observations;
+    runJob();
+    return true;
+}
+
+bool VecEnv::step(std::span<const std::uint16_t> actions, std::span<std::uint8_t> observations,
+                  std::span<float> rewards, std::span<std::uint8_t> dones)
+{
+    if(!checkBuffers(observations, actions.size(), rewards.size(), dones.size()))
+    {
+        return false;
+    }
+    m_job = Job::STEP;
+    m_actions = actions;
+    m_observations = observations;
+    m_rewards = rewards;
+    m_dones = dones;
+    runJob();
+    return true;
+}
+
+Chip8& VecEnv::getEmulator(std::size_t index)
+{
+    return *m_environments[index].emulator;
+}
@@ -0,0 +1,228 @@
+#ifndef HEADLESSRUN_HPP
+#define HEADLESSRUN_HPP
+// What the headless tools share: options, ROMs, key scripts, running to a budget and hashing the results
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <iterator>
+#include "../header/Chip8.hpp"
+
+namespace HeadlessRun
+{
+    // A line of a key script, "<frame> <key> <down|up>" with the key in hex ('#' starts a comment)
+    struct ScriptedKey
+    {
+        std::uint64_t frame{};
+        Chip8_t::Byte key{};
+        bool down{};
+    };
+
+    //  Name:           readInputScript
+    //  Description:    reads a key script, reporting the first invalid line
+    //  Arguments:      path - the path to the script
+    //                  keys - the keys are added to it
+    //  Return:         true if the whole script was read, false otherwise
+    inline bool readInputScript(const std::string& path, std::vector<ScriptedKey>& keys)
+    {
+        std::ifstream file{ path };
+        if(!file.is_open())
+        {
+            std::cout << "Couldn't open " << path << "!\n";
+            return false;
+        }
+
+        std::string line{};
+        for(int number{ 1 }; std::getline(file, line); ++number)
+        {
+            line = line.substr(0, line.find('#'));
+            std::istringstream words{ line };
+            ScriptedKey key{};
+            if(!(words >> key.frame))
+            {
+                // Empty line
+                continue;
+            }
+
+            std::string which{};
+            std::string state{};
+            char* which_end{};
+            unsigned long value{};
+            if(words >> which >> state)
+            {
+                value = std::strtoul(which.c_str(), &which_end, 16);
+            }
+            if(which_end == nullptr || *which_end != '\0' || value >= Chip8Const::buttons || (state != "down" && state != "up"))
+            {
+                std::cout << path << ":" << number << ": expected \"<frame> <key> <down|up>\"\n";
+                return false;
+            }
+            key.key = (Chip8_t::Byte)value;
+            key.down = state == "down";
+            keys.push_back(key);
+        }
+        return true;
+    }
+
+    //  Name:           readRom
+    //  Description:    reads a whole ROM file, e.g. to load it into many emulators without reading it again
+    //  Arguments:      path - the path to the ROM
+    //                  rom - set to the contents of the file
+    //  Return:         true if the file was read, false otherwise
+    inline bool readRom(const std::string& path, std::vector<Chip8_t::Byte>& rom)
+    {
+        std::ifstream file{ path, std::ios::binary };
+        if(!file.is_open())
+        {
+            std::cout << "Couldn't open " << path << "!\n";
+            return false;
+        }
+        rom.assign(std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{});
+        return true;
+    }
+
+    //  Name:           parseBehaviour
+    //  Description:    reads the name of a behaviour: chip8 or superchip
+    //  Arguments:      name - the name
+    //                  behaviour - set to the behaviour
+    //  Return:         false if there is no behaviour with the name
+    inline bool parseBehaviour(const std::string& name, Chip8::BehaviourType& behaviour)
+    {
+        if(name == "chip8") behaviour = Chip8::BehaviourType::CHIP8;
+        else if(name == "superchip") behaviour = Chip8::BehaviourType::SUPERCHIP;
+        else return false;
+        return true;
+    }
+
+    //  Name:           parseBackend
+    //  Description:    reads the name of a backend: interpreter, threaded, blocks, jit or aot
+    //  Arguments:      name - the name
+    //                  backend - set to the backend
+    //  Return:         false if there is no backend with the name
+    inline bool parseBackend(const std::string& name, Chip8::Backend& backend)
+    {
+        if(name == "interpreter") backend = Chip8::Backend::INTERPRETER;
+        else if(name == "threaded") backend = Chip8::Backend::THREADED;
+        else if(name == "blocks") backend = Chip8::Backend::CACHED_BLOCKS;
+        else if(name == "jit") backend = Chip8::Backend::JIT;
+        else if(name == "aot") backend = Chip8::Backend::AOT;
+        else return false;
+        return true;
+    }
+
+    //  Name:           queueInputScript
+    //  Description:    queues the keys of a script, a released key is JUST_RELEASED for a frame and then UP (like in the frontend)
+    //  Arguments:      emulator - the emulator to queue the keys on
+    //                  keys - the script
+    //                  instructions_per_frame - the length of a frame
+    inline void queueInputScript(Chip8& emulator, const std::vector<ScriptedKey>& keys, std::uint32_t instructions_per_frame)
+    {
+        for(const ScriptedKey& key : keys)
+        {
+            std::uint64_t cycle{ key.frame * instructions_per_frame };
+            if(key.down)
+            {
+                emulator.queueKeyEvent(cycle, key.key, Chip8::KeyState::DOWN);
+            }
+            else
+            {
+                emulator.queueKeyEvent(cycle, key.key, Chip8::KeyState::JUST_RELEASED);
+                emulator.queueKeyEvent(cycle + instructions_per_frame, key.key, Chip8::KeyState::UP);
+            }
+        }
+    }
+
+    //  Name:           runUntil
+    //  Description:    runs until the cycle counter reaches 'end', skipping ahead while the ROM waits, or until the ROM can't go on
+    //  Arguments:      emulator - the emulator to run
+    //                  end - the cycle to stop at
+    //                  conditions - the stop conditions of every run, e.g. to not skip idle loops
+    //  Return:         the instructions executed and skipped, and why the last run stopped
+    inline Chip8::RunResult runUntil(Chip8& emulator, std::uint64_t end, const Chip8::StopConditions& conditions = {})
+    {
+        Chip8::RunResult total{ Chip8::StopReason::BUDGET };
+        while(emulator.getCycles() < end)
+        {
+            Chip8::RunResult result{ emulator.run(end - emulator.getCycles(), conditions) };
+            total.executed += result.executed;
+            total.elided += result.elided;
+            total.reason = result.reason;
+            if(result.reason == Chip8::StopReason::STACK_OVERFLOW || result.reason == Chip8::StopReason::STACK_UNDERFLOW ||
+               result.executed + result.elided == 0)
+            {
+                break;
+            }
+        }
+        return total;
+    }
+
+    inline const char* getStopName(Chip8::StopReason reason)
+    {
+        switch(reason)
+        {
+            case Chip8::StopReason::BUDGET: return "BUDGET";
+            case Chip8::StopReason::KEY_WAIT: return "KEY_WAIT";
+            case Chip8::StopReason::BREAKPOINT: return "BREAKPOINT";
+            case Chip8::StopReason::FRAME: return "FRAME";
+            case Chip8::StopReason::IDLE: return "IDLE";
+            case Chip8::StopReason::VBLANK: return "VBLANK";
+            case Chip8::StopReason::AUDIO: return "AUDIO";
+            case Chip8::StopReason::STACK_OVERFLOW: return "STACK_OVERFLOW";
+            case Chip8::StopReason::STACK_UNDERFLOW: return "STACK_UNDERFLOW";
+            default: return "INVALID";
+        }
+    }
+
+    // FNV-1a, the same as the other tools use
+    struct Hash
+    {
+        std::uint64_t value{ 1469598103934665603ull };
+
+        void mix(std::uint64_t data)
+        {
+            value = (value ^ data) * 1099511628211ull;
+        }
+    };
+
+    //  Name:           hashState
+    //  Description:    hashes the memory, the registers, the PC and I, the same way chip8-bench does
+    //  Arguments:      state - the state to hash
+    //  Return:         the hash
+    inline std::uint64_t hashState(const Chip8::MachineState& state)
+    {
+        Hash hash{};
+        for(Chip8_t::Byte byte : state.memory.view())
+        {
+            hash.mix(byte);
+        }
+        for(Chip8_t::Byte reg{}; reg < Chip8Const::reg_amount; ++reg)
+        {
+            hash.mix(state.regs.read(reg));
+        }
+        hash.mix(state.PC);
+        hash.mix(state.I);
+        return hash.value;
+    }
+
+    //  Name:           hashDisplay
+    //  Description:    hashes the pixels of the display
+    //  Arguments:      state - the state to hash the display of
+    //  Return:         the hash
+    inline std::uint64_t hashDisplay(const Chip8::MachineState& state)
+    {
+        Hash hash{};
+        for(Chip8_t::Word y{}; y < state.display.getHeight(); ++y)
+        {
+            for(std::uint64_t word : state.display.getRow(y))
+            {
+                hash.mix(word);
+            }
+        }
+        return hash.value;
+    }
+}
+
+#endif
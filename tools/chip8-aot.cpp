@@ -0,0 +1,366 @@
+// chip8-aot - translates a CHIP8 ROM to C++ ahead of time
+//
+// Usage: chip8-aot <rom.ch8> <output.cpp>
+//
+// Recovers the control flow graph of the ROM starting at Chip8Const::rom_mem_start (following jumps, calls and skips)
+// and writes every basic block as a case of one big switch on the PC. The output is meant to be compiled into a
+// shared object (see CHIP8_AOT_ROMS in CMakeLists.txt) and loaded with Chip8::loadAotModule.
+// Anything that can't be found statically (BXNN targets, code outside the ROM, overwritten code) is interpreted.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <deque>
+#include <cstdio>
+#include "../header/Chip8.hpp"
+
+namespace
+{
+    // Must not be more than the emulator's own block limit
+    constexpr std::uint16_t max_block_length{ 64 };
+
+    struct Block
+    {
+        std::vector<Chip8_t::Word> opcodes{};
+        std::vector<Chip8_t::Word> successors{};
+        bool idle_jump{};   // ends with the jump back of an idle loop (see Chip8::isIdleLoop)
+    };
+
+    std::string hex(unsigned value, int width = 1)
+    {
+        char buffer[16]{};
+        std::snprintf(buffer, sizeof(buffer), "0x%0*X", width, value);
+        return buffer;
+    }
+
+    bool endsBlock(Chip8::OpType type)
+    {
+        switch(type)
+        {
+            case Chip8::OpType::_00EE:
+            case Chip8::OpType::_1NNN:
+            case Chip8::OpType::_2NNN:
+            case Chip8::OpType::_BXNN:
+            case Chip8::OpType::_3XNN:
+            case Chip8::OpType::_4XNN:
+            case Chip8::OpType::_5XY0:
+            case Chip8::OpType::_9XY0:
+            case Chip8::OpType::_EX9E:
+            case Chip8::OpType::_EXA1:
+            case Chip8::OpType::_FX0A:
+            case Chip8::OpType::_FX33:
+            case Chip8::OpType::_FX55:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // Finds every block reachable from the start of the ROM
+    std::map<Chip8_t::Word, Block> findBlocks(const std::vector<Chip8_t::Byte>& rom)
+    {
+        std::uint32_t rom_end{ Chip8Const::rom_mem_start + (std::uint32_t)rom.size() };
+        std::uint32_t code_end{ std::min<std::uint32_t>(rom_end, Chip8Const::mem_size - 2) };
+        auto opcodeAt{ [&](Chip8_t::Word address)
+        {
+            std::uint32_t offset{ (std::uint32_t)address - Chip8Const::rom_mem_start };
+            return (Chip8_t::Word)((rom[offset] << 8) | rom[offset + 1]);
+        } };
+
+        std::map<Chip8_t::Word, Block> blocks{};
+        std::deque<Chip8_t::Word> to_visit{ Chip8Const::rom_mem_start };
+        while(!to_visit.empty())
+        {
+            Chip8_t::Word start{ to_visit.front() };
+            to_visit.pop_front();
+
+            // Same rules as Chip8::getBlock
+            if(start < Chip8Const::rom_mem_start || start + 2u > code_end || (start & 1) != 0 || blocks.count(start) > 0)
+            {
+                continue;
+            }
+
+            Block& block{ blocks[start] };
+            Chip8_t::Word pc{ start };
+            bool ended{};
+            while(!ended && pc + 2u <= code_end && block.opcodes.size() < max_block_length)
+            {
+                const Chip8::DecodedOp& op{ Chip8::decodeOp(opcodeAt(pc)) };
+                block.opcodes.push_back(op.opcode);
+                Chip8_t::Word next{ (Chip8_t::Word)(pc + 2) };
+                ended = endsBlock(op.type);
+
+                switch(op.type)
+                {
+                    case Chip8::OpType::_1NNN:
+                    {
+                        block.successors = {op.nnn};
+                        if(op.nnn >= Chip8Const::rom_mem_start && op.nnn <= pc && (pc - op.nnn) % 2 == 0)
+                        {
+                            std::vector<Chip8_t::Word> body{};
+                            for(Chip8_t::Word address{op.nnn}; address < pc; address += 2)
+                            {
+                                body.push_back(opcodeAt(address));
+                            }
+                            block.idle_jump = Chip8::isIdleLoop(body.data(), body.size());
+                        }
+                        break;
+                    }
+                    case Chip8::OpType::_2NNN:
+                        block.successors = {op.nnn, next};
+                        break;
+                    case Chip8::OpType::_3XNN:
+                    case Chip8::OpType::_4XNN:
+                    case Chip8::OpType::_5XY0:
+                    case Chip8::OpType::_9XY0:
+                    case Chip8::OpType::_EX9E:
+                    case Chip8::OpType::_EXA1:
+                        block.successors = {next, (Chip8_t::Word)(next + 2)};
+                        break;
+                    case Chip8::OpType::_FX0A:
+                        block.successors = {pc, next};
+                        break;
+                    case Chip8::OpType::_FX33:
+                    case Chip8::OpType::_FX55:
+                        block.successors = {next};
+                        break;
+                    default:
+                        // 00EE returns to a call site, which is already a successor of the 2NNN
+                        // BXNN can't be followed statically
+                        break;
+                }
+                pc = next;
+            }
+
+            if(!ended)
+            {
+                block.successors = {pc};
+            }
+
+            for(Chip8_t::Word successor : block.successors)
+            {
+                to_visit.push_back(successor);
+            }
+        }
+
+        return blocks;
+    }
+
+    // Writes a single instruction, returns true if it sets the PC itself
+    bool writeOp(std::ostream& out, const Chip8::DecodedOp& op, Chip8_t::Word pc, std::size_t count, bool last, bool idle_jump)
+    {
+        const std::string indent(20, ' ');
+        std::string x{ "V[" + hex(op.x) + "]" };
+        std::string y{ "V[" + hex(op.y) + "]" };
+        std::string next{ hex(pc + 2, 3) };
+        std::string skip{ hex(pc + 4, 3) };
+        std::string leave{ indent + "executed += " + std::to_string(count) + ";\n" + indent + "continue;\n" };
+        auto interpret{ [&]() { out << indent << "PC = " << next << ";\n" << indent << "context->execute(context->self, " << hex(op.opcode, 4) << ");\n"; } };
+        // The interpreter checks I at the start of the next instruction, the start of every block does it for the last one
+        auto checkI{ [&]()
+        {
+            if(!last)
+            {
+                out << indent << "if(I >= " << hex(Chip8Const::mem_size) << ") context->check_i(context->self, " << skip << ");\n";
+            }
+        } };
+
+        out << indent << "// " << hex(pc, 3) << ": " << hex(op.opcode, 4) << " " << Chip8::decode(Instruction<Chip8_t::Word>{op.opcode}) << '\n';
+        switch(op.type)
+        {
+            case Chip8::OpType::_6XNN:
+                out << indent << x << " = " << hex(op.nn, 2) << ";\n";
+                return false;
+            case Chip8::OpType::_7XNN:
+                out << indent << x << " = (std::uint8_t)(" << x << " + " << hex(op.nn, 2) << ");\n";
+                return false;
+            case Chip8::OpType::_8XY0:
+                out << indent << x << " = " << y << ";\n";
+                return false;
+            case Chip8::OpType::_8XY1:
+            case Chip8::OpType::_8XY2:
+            case Chip8::OpType::_8XY3:
+            {
+                const char* operation{ op.type == Chip8::OpType::_8XY1 ? " | " : op.type == Chip8::OpType::_8XY2 ? " & " : " ^ " };
+                out << indent << x << " = " << x << operation << y << ";\n";
+                out << indent << "if(quirks & " << hex(Quirks::VF_RESET) << ") V[0xF] = 0;\n";
+                return false;
+            }
+            case Chip8::OpType::_8XY4:
+                out << indent << "{ unsigned r = " << x << " + " << y << "; " << x << " = (std::uint8_t)r; V[0xF] = r > 0xFF; }\n";
+                return false;
+            case Chip8::OpType::_8XY5:
+                out << indent << "{ std::uint8_t vx = " << x << ", vy = " << y << "; " << x << " = (std::uint8_t)(vx - vy); V[0xF] = vx >= vy; }\n";
+                return false;
+            case Chip8::OpType::_8XY7:
+                out << indent << "{ std::uint8_t vx = " << x << ", vy = " << y << "; " << x << " = (std::uint8_t)(vy - vx); V[0xF] = vy >= vx; }\n";
+                return false;
+            case Chip8::OpType::_8XY6:
+                out << indent << "{ std::uint8_t v = (quirks & " << hex(Quirks::SHIFT_VY) << ") ? " << y << " : " << x << "; " << x << " = v >> 1; V[0xF] = v & 1; }\n";
+                return false;
+            case Chip8::OpType::_8XYE:
+                out << indent << "{ std::uint8_t v = (quirks & " << hex(Quirks::SHIFT_VY) << ") ? " << y << " : " << x << "; " << x << " = (std::uint8_t)(v << 1); V[0xF] = (v & 0x80) != 0; }\n";
+                return false;
+            case Chip8::OpType::_ANNN:
+                out << indent << "I = " << hex(op.nnn, 3) << ";\n";
+                return false;
+            case Chip8::OpType::_FX1E:
+                out << indent << "I = (std::uint16_t)(I + " << x << ");\n";
+                checkI();
+                return false;
+            case Chip8::OpType::_FX29:
+                out << indent << "I = (std::uint16_t)(" << hex(Chip8Const::font_begin) << " + (" << x << " % 16) * 5);\n";
+                return false;
+            case Chip8::OpType::_1NNN:
+                if(idle_jump)
+                {
+                    // The emulator decides whether it's still idle, and stops if it is
+                    interpret();
+                    out << indent << "executed += " << count << ";\n" << indent << "return executed;\n";
+                    return true;
+                }
+                out << indent << "PC = " << hex(op.nnn, 3) << ";\n" << leave;
+                return true;
+            case Chip8::OpType::_BXNN:
+                out << indent << "PC = (std::uint16_t)(" << hex(op.nnn, 3) << " + ((quirks & " << hex(Quirks::JUMP_V0) << ") ? V[0x0] : " << x << "));\n" << leave;
+                return true;
+            case Chip8::OpType::_3XNN:
+                out << indent << "PC = " << x << " == " << hex(op.nn, 2) << " ? " << skip << " : " << next << ";\n" << leave;
+                return true;
+            case Chip8::OpType::_4XNN:
+                out << indent << "PC = " << x << " != " << hex(op.nn, 2) << " ? " << skip << " : " << next << ";\n" << leave;
+                return true;
+            case Chip8::OpType::_5XY0:
+                out << indent << "PC = " << x << " == " << y << " ? " << skip << " : " << next << ";\n" << leave;
+                return true;
+            case Chip8::OpType::_9XY0:
+                out << indent << "PC = " << x << " != " << y << " ? " << skip << " : " << next << ";\n" << leave;
+                return true;
+            case Chip8::OpType::_EX9E:
+                out << indent << "PC = context->keys[" << x << " % 16] == " << (int)Chip8::KeyState::DOWN << " ? " << skip << " : " << next << ";\n" << leave;
+                return true;
+            case Chip8::OpType::_EXA1:
+                out << indent << "{ std::int32_t key = context->keys[" << x << " % 16]; PC = key == " << (int)Chip8::KeyState::UP
+                    << " || key == " << (int)Chip8::KeyState::JUST_RELEASED << " ? " << skip << " : " << next << "; }\n" << leave;
+                return true;
+            case Chip8::OpType::_2NNN:
+            case Chip8::OpType::_00EE:
+                // These need the stack, and set the PC themselves, or leave it at the instruction when the stack is full/empty
+                interpret();
+                out << indent << "executed += " << count << ";\n";
+                out << indent << "if(PC == " << hex(pc, 3) << ") return executed;\n";
+                out << indent << "continue;\n";
+                return true;
+            case Chip8::OpType::_FX0A:
+                // Goes back to the emulator while waiting for a key, like every other backend
+                interpret();
+                out << indent << "executed += " << count << ";\n";
+                out << indent << "if(PC == " << hex(pc, 3) << ") return executed;\n";
+                out << indent << "continue;\n";
+                return true;
+            case Chip8::OpType::_FX55:
+            case Chip8::OpType::_FX65:
+                interpret();
+                checkI();
+                return false;
+            default:
+                interpret();
+                return false;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(argc != 3)
+    {
+        std::cout << "Usage: " << argv[0] << " <rom.ch8> <output.cpp>\n";
+        return 1;
+    }
+
+    // Read the ROM
+    std::ifstream file{argv[1], std::ios::binary};
+    if(!file.is_open())
+    {
+        std::cout << "Couldn't open " << argv[1] << "!\n";
+        return 1;
+    }
+    std::vector<Chip8_t::Byte> rom{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+    if(rom.size() > Chip8Const::mem_size - Chip8Const::rom_mem_start)
+    {
+        rom.resize(Chip8Const::mem_size - Chip8Const::rom_mem_start);
+    }
+
+    std::map<Chip8_t::Word, Block> blocks{ findBlocks(rom) };
+
+    // Write the translation
+    std::ostringstream out{};
+    out << "// Generated by chip8-aot from " << argv[1] << ", do not edit\n";
+    out << "#include <cstdint>\n";
+    out << "#include \"Aot.hpp\"\n\n";
+    out << "namespace\n{\n";
+
+    out << "    const std::uint8_t rom[]\n    {";
+    for(std::size_t i{}; i < rom.size(); ++i)
+    {
+        out << (i % 16 == 0 ? "\n        " : " ") << hex(rom[i], 2) << ",";
+    }
+    out << "\n    };\n\n";
+
+    out << "    const std::uint16_t blocks[]\n    {\n";
+    for(const auto& [start, block] : blocks)
+    {
+        out << "        " << hex(start, 3) << ", " << block.opcodes.size() << ",\n";
+    }
+    out << "    };\n\n";
+
+    out << "    std::uint64_t run(Chip8AotContext* context, std::uint64_t budget)\n    {\n";
+    // Not every ROM has blocks using the registers or the quirks
+    out << "        [[maybe_unused]] std::uint8_t* V{ context->regs };\n";
+    out << "        std::uint16_t& I{ *context->I };\n";
+    out << "        std::uint16_t& PC{ *context->PC };\n";
+    out << "        [[maybe_unused]] const std::uint8_t quirks{ context->quirks };\n";
+    out << "        std::uint64_t executed{};\n\n";
+    out << "        for(;;)\n        {\n            switch(PC)\n            {\n";
+    for(const auto& [start, block] : blocks)
+    {
+        std::size_t count{ block.opcodes.size() };
+        out << "                case " << hex(start, 3) << ":\n                {\n";
+        out << "                    if(context->dirty[" << hex(start >> 1) << "] || budget - executed < " << count << ")\n";
+        out << "                    {\n                        return executed;\n                    }\n";
+        out << "                    if(I >= " << hex(Chip8Const::mem_size) << ") context->check_i(context->self, " << hex(start + 2, 3) << ");\n";
+
+        bool left{};
+        Chip8_t::Word pc{ start };
+        for(std::size_t i{}; i < count; ++i)
+        {
+            left = writeOp(out, Chip8::decodeOp(block.opcodes[i]), pc, count, i + 1 == count, block.idle_jump);
+            pc += 2;
+        }
+        if(!left)
+        {
+            out << "                    PC = " << hex(pc, 3) << ";\n";
+            out << "                    executed += " << count << ";\n";
+            out << "                    continue;\n";
+        }
+        out << "                }\n";
+    }
+    out << "                default:\n                {\n                    return executed;\n                }\n";
+    out << "            }\n        }\n    }\n}\n\n";
+
+    out << "extern \"C\" const Chip8AotModule " << CHIP8_AOT_SYMBOL << "\n{\n";
+    out << "    CHIP8_AOT_ABI_VERSION,\n    rom,\n    sizeof(rom),\n    blocks,\n    sizeof(blocks) / sizeof(blocks[0]) / 2,\n    &run,\n};\n";
+
+    std::ofstream output{argv[2]};
+    if(!output.is_open())
+    {
+        std::cout << "Couldn't open " << argv[2] << "!\n";
+        return 1;
+    }
+    output << out.str();
+
+    std::cout << "Translated " << blocks.size() << " blocks from " << argv[1] << '\n';
+    return 0;
+}
@@ -0,0 +1,457 @@
+// chip8-batch - runs many ROMs headless on every core and writes the results to a columnar file
+//
+// Usage: chip8-batch <manifest> <output> [--threads n] [--ipf n] [--backend name] [--seed n]
+//   --threads <n>          how many threads run the jobs (default: one per core)
+//   --ipf <n>              instructions per frame of every job (default 11)
+//   --backend <name>       interpreter, threaded, blocks or jit (default interpreter)
+//   --seed <n>             seed of the random numbers, every job starts from it (default 1)
+//
+// Every line of the manifest is a job, "<rom> <profile> <input script> <budget>" ('#' starts a comment):
+//   profile                chip8, superchip or the Quirks::Flag bits (e.g. 0x30)
+//   input script           a key script like the ones of chip8-headless, or - for none
+//   budget                 instructions to run, or frames with an 'f' at the end (e.g. 600f)
+//
+// A job runs exactly like chip8-headless with the same arguments, so the hashes can be compared,
+// and gives the same results whichever thread runs it and whatever ran on that thread before.
+// The ROMs and scripts are read once and shared by the jobs, every thread reuses a single emulator.
+// The jobs are split evenly between the threads, a thread that runs out steals half of the jobs left to another one.
+//
+// The output file, every number is little endian:
+//   header                 "C8BR", u16 version, u16 amount of columns, u64 amount of rows (jobs)
+//   column descriptors     char name[24] (0 terminated), u32 size of an element, u32 reserved (0), u64 offset of the column from the start of the file
+//   columns                an element per job in manifest order, every column starts at a multiple of 8
+// The columns are state_hash, display_hash, cycles, executed, elided (u64), stop (u8, a Chip8::StopReason),
+// pc (u16), framebuffer (Display::max_height rows of Display::Row, the rows past the height are 0) and seconds (f64)
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../header/Chip8.hpp"
+#include "HeadlessRun.hpp"
+
+namespace
+{
+    constexpr char output_magic[4]{ 'C', '8', 'B', 'R' };
+    constexpr std::uint16_t output_version{ 1 };
+    constexpr std::size_t column_name_size{ 24 };
+
+    typedef std::array<Display::Row, Display::max_height> Framebuffer;
+
+    struct Options
+    {
+        const char* manifest{};
+        const char* output{};
+        unsigned threads{ std::max(std::thread::hardware_concurrency(), 1u) };
+        std::uint32_t instructions_per_frame{ 11 };
+        Chip8::Backend backend{ Chip8::Backend::INTERPRETER };
+        std::uint64_t seed{ Random::default_seed };
+    };
+
+    struct Job
+    {
+        std::size_t rom{};                      // index in Manifest::roms
+        std::size_t script{};                   // index in Manifest::scripts
+        bool use_behaviour{};                   // a named profile, otherwise 'quirks'
+        Chip8::BehaviourType behaviour{};
+        std::uint8_t quirks{};
+        std::uint64_t budget{};
+        bool frames{};                          // the budget is in frames
+    };
+
+    // Everything the jobs share, read only while they run
+    struct Manifest
+    {
+        std::vector<std::vector<Chip8_t::Byte>> roms{};
+        std::vector<std::vector<HeadlessRun::ScriptedKey>> scripts{ {} };  // the first one is the empty script
+        std::vector<Job> jobs{};
+    };
+
+    // The results, a vector per column
+    struct Results
+    {
+        std::vector<std::uint64_t> state_hash{};
+        std::vector<std::uint64_t> display_hash{};
+        std::vector<std::uint64_t> cycles{};
+        std::vector<std::uint64_t> executed{};
+        std::vector<std::uint64_t> elided{};
+        std::vector<std::uint8_t> stop{};
+        std::vector<std::uint16_t> pc{};
+        std::vector<Framebuffer> framebuffer{};
+        std::vector<double> seconds{};
+
+        explicit Results(std::size_t rows) :
+            state_hash(rows), display_hash(rows), cycles(rows), executed(rows), elided(rows),
+            stop(rows), pc(rows), framebuffer(rows), seconds(rows)
+        {}
+    };
+
+    // The jobs a thread has left, [begin, end) packed into a word so the owner and the thieves can take from it with a single CAS.
+    // The owner takes from the front, thieves take the back half. Aligned so the threads don't share cache lines
+    struct alignas(64) JobRange
+    {
+        std::atomic<std::uint64_t> bounds{};
+
+        static std::uint64_t pack(std::uint32_t begin, std::uint32_t end)
+        {
+            return (std::uint64_t)end << 32 | begin;
+        }
+        static std::uint32_t begin(std::uint64_t bounds) { return (std::uint32_t)bounds; }
+        static std::uint32_t end(std::uint64_t bounds) { return (std::uint32_t)(bounds >> 32); }
+    };
+
+    void printUsage(const char* name)
+    {
+        std::cout << "Usage: " << name << " <manifest> <output> [--threads n] [--ipf n] [--backend interpreter|threaded|blocks|jit]\n"
+                  << "       [--seed n]\n";
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options)
+    {
+        if(argc < 3)
+        {
+            return false;
+        }
+        options.manifest = argv[1];
+        options.output = argv[2];
+
+        for(int i{ 3 }; i + 1 < argc; i += 2)
+        {
+            std::string option{ argv[i] };
+            const char* value{ argv[i + 1] };
+            if(option == "--threads") options.threads = std::max<unsigned>(std::strtoul(value, nullptr, 10), 1);
+            else if(option == "--seed") options.seed = std::strtoull(value, nullptr, 10);
+            else if(option == "--ipf") options.instructions_per_frame = std::max<std::uint32_t>(std::strtoul(value, nullptr, 10), 1);
+            else if(option == "--backend")
+            {
+                // The AOT backend would need a module per ROM
+                if(!HeadlessRun::parseBackend(value, options.backend) || options.backend == Chip8::Backend::AOT)
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return argc % 2 == 1;
+    }
+
+    //  Name:           readManifest
+    //  Description:    reads the jobs of a manifest along with every ROM and script they use, reporting the first problem
+    //  Arguments:      path - the path to the manifest
+    //                  manifest - filled with the jobs
+    //  Return:         true if every job is valid, false otherwise
+    bool readManifest(const char* path, Manifest& manifest)
+    {
+        std::ifstream file{ path };
+        if(!file.is_open())
+        {
+            std::cout << "Couldn't open " << path << "!\n";
+            return false;
+        }
+
+        std::map<std::string, std::size_t> rom_indices{};
+        std::map<std::string, std::size_t> script_indices{ { "-", 0 } };
+        std::string line{};
+        for(int number{ 1 }; std::getline(file, line); ++number)
+        {
+            line = line.substr(0, line.find('#'));
+            std::istringstream words{ line };
+            std::string rom{}, profile{}, script{}, budget{};
+            if(!(words >> rom))
+            {
+                // Empty line
+                continue;
+            }
+
+            Job job{};
+            char* budget_end{};
+            char* quirks_end{};
+            if(words >> profile >> script >> budget)
+            {
+                job.budget = std::strtoull(budget.c_str(), &budget_end, 10);
+                if(HeadlessRun::parseBehaviour(profile, job.behaviour))
+                {
+                    job.use_behaviour = true;
+                    quirks_end = profile.data() + profile.size();
+                }
+                else
+                {
+                    unsigned long quirks{ std::strtoul(profile.c_str(), &quirks_end, 0) };
+                    job.quirks = (std::uint8_t)quirks;
+                    if(quirks & ~(unsigned long)Quirks::all_flags)
+                    {
+                        quirks_end = nullptr;
+                    }
+                }
+            }
+            if(budget_end != nullptr && *budget_end == 'f')
+            {
+                job.frames = true;
+                ++budget_end;
+            }
+            if(budget_end == nullptr || *budget_end != '\0' || budget_end == budget.c_str() || quirks_end == nullptr || *quirks_end != '\0')
+            {
+                std::cout << path << ":" << number << ": expected \"<rom> <chip8|superchip|quirk flags> <input script|-> <instructions|frames f>\"\n";
+                return false;
+            }
+
+            // Every file is read only once
+            auto [rom_index, new_rom]{ rom_indices.try_emplace(rom, manifest.roms.size()) };
+            if(new_rom && !HeadlessRun::readRom(rom, manifest.roms.emplace_back()))
+            {
+                return false;
+            }
+            auto [script_index, new_script]{ script_indices.try_emplace(script, manifest.scripts.size()) };
+            if(new_script && !HeadlessRun::readInputScript(script, manifest.scripts.emplace_back()))
+            {
+                return false;
+            }
+            job.rom = rom_index->second;
+            job.script = script_index->second;
+            manifest.jobs.push_back(job);
+        }
+        return true;
+    }
+
+    //  Name:           takeJob
+    //  Description:    takes the next job of a thread, stealing from the other threads when it has none left
+    //  Arguments:      ranges - the jobs left of every thread
+    //                  thread - the thread taking the job
+    //                  job - set to the index of the job
+    //  Return:         false if no thread has any jobs left
+    bool takeJob(std::vector<JobRange>& ranges, std::size_t thread, std::uint32_t& job)
+    {
+        std::atomic<std::uint64_t>& own{ ranges[thread].bounds };
+        while(true)
+        {
+            std::uint64_t bounds{ own.load(std::memory_order_acquire) };
+            while(JobRange::begin(bounds) < JobRange::end(bounds))
+            {
+                if(own.compare_exchange_weak(bounds, JobRange::pack(JobRange::begin(bounds) + 1, JobRange::end(bounds)), std::memory_order_acq_rel))
+                {
+                    job = JobRange::begin(bounds);
+                    return true;
+                }
+            }
+
+            // Out of jobs, take the back half of the first thread found with some left.
+            // Nobody steals from an empty range, so the stolen jobs can be stored without a CAS
+            bool stolen{};
+            for(std::size_t i{ 1 }; i < ranges.size() && !stolen; ++i)
+            {
+                std::atomic<std::uint64_t>& victim{ ranges[(thread + i) % ranges.size()].bounds };
+                std::uint64_t victim_bounds{ victim.load(std::memory_order_acquire) };
+                while(JobRange::begin(victim_bounds) < JobRange::end(victim_bounds))
+                {
+                    std::uint32_t begin{ JobRange::begin(victim_bounds) };
+                    std::uint32_t end{ JobRange::end(victim_bounds) };
+                    std::uint32_t middle{ end - (end - begin + 1) / 2 };
+                    if(victim.compare_exchange_weak(victim_bounds, JobRange::pack(begin, middle), std::memory_order_acq_rel))
+                    {
+                        own.store(JobRange::pack(middle, end), std::memory_order_release);
+                        stolen = true;
+                        break;
+                    }
+                }
+            }
+            if(!stolen)
+            {
+                // The jobs being moved by a thief are run by that thief
+                return false;
+            }
+        }
+    }
+
+    //  Name:           runJob
+    //  Description:    runs a job from a clean emulator and stores its results
+    //  Arguments:      emulator - the emulator of the thread
+    //                  manifest - the jobs
+    //                  index - the job to run
+    //                  instructions_per_frame - the length of a frame
+    //                  results - the results are stored at 'index'
+    void runJob(Chip8& emulator, const Manifest& manifest, std::size_t index, std::uint32_t instructions_per_frame, Results& results)
+    {
+        const Job& job{ manifest.jobs[index] };
+        auto begin{ std::chrono::steady_clock::now() };
+
+        if(job.use_behaviour)
+        {
+            emulator.setBehaviourType(job.behaviour);
+        }
+        else
+        {
+            emulator.setQuirkFlags(job.quirks);
+        }
+        emulator.clearMemory();
+        emulator.loadMemory(manifest.roms[job.rom]);
+        HeadlessRun::queueInputScript(emulator, manifest.scripts[job.script], instructions_per_frame);
+        Chip8::RunResult result{ HeadlessRun::runUntil(emulator, job.frames ? job.budget * instructions_per_frame : job.budget) };
+
+        Chip8::MachineState state{};
+        emulator.saveState(state);
+        results.state_hash[index] = HeadlessRun::hashState(state);
+        results.display_hash[index] = HeadlessRun::hashDisplay(state);
+        results.cycles[index] = state.cycles;
+        results.executed[index] = result.executed;
+        results.elided[index] = result.elided;
+        results.stop[index] = (std::uint8_t)result.reason;
+        results.pc[index] = state.PC;
+        for(Chip8_t::Word y{}; y < state.display.getHeight(); ++y)
+        {
+            results.framebuffer[index][y] = state.display.getRow(y);
+        }
+
+        std::chrono::duration<double> taken{ std::chrono::steady_clock::now() - begin };
+        results.seconds[index] = taken.count();
+    }
+
+    //  Name:           writeResults
+    //  Description:    writes the results in the columnar format described at the top
+    //  Arguments:      path - the path to the output file
+    //                  results - the results of every job
+    //  Return:         true if the whole file was written, false otherwise
+    bool writeResults(const char* path, const Results& results)
+    {
+        struct Column
+        {
+            const char* name;
+            std::uint32_t element_size;
+            const void* data;
+        };
+        const Column columns[]
+        {
+            { "state_hash", sizeof(std::uint64_t), results.state_hash.data() },
+            { "display_hash", sizeof(std::uint64_t), results.display_hash.data() },
+            { "cycles", sizeof(std::uint64_t), results.cycles.data() },
+            { "executed", sizeof(std::uint64_t), results.executed.data() },
+            { "elided", sizeof(std::uint64_t), results.elided.data() },
+            { "stop", sizeof(std::uint8_t), results.stop.data() },
+            { "pc", sizeof(std::uint16_t), results.pc.data() },
+            { "framebuffer", sizeof(Framebuffer), results.framebuffer.data() },
+            { "seconds", sizeof(double), results.seconds.data() },
+        };
+        constexpr std::uint16_t column_count{ sizeof(columns) / sizeof(columns[0]) };
+        constexpr std::size_t header_size{ 16 };
+        constexpr std::size_t descriptor_size{ column_name_size + 16 };
+        std::uint64_t rows{ results.state_hash.size() };
+        auto padded{ [](std::uint64_t size) { return (size + 7) & ~std::uint64_t{ 7 }; } };
+
+        std::vector<char> file(header_size + descriptor_size * column_count);
+        auto put{ [&](std::size_t at, const void* data, std::size_t size) { std::memcpy(file.data() + at, data, size); } };
+        put(0, output_magic, sizeof(output_magic));
+        put(4, &output_version, sizeof(output_version));
+        put(6, &column_count, sizeof(column_count));
+        put(8, &rows, sizeof(rows));
+
+        for(std::size_t i{}; i < column_count; ++i)
+        {
+            std::uint64_t offset{ file.size() };
+            std::uint64_t size{ rows * columns[i].element_size };
+            std::size_t descriptor{ header_size + descriptor_size * i };
+            put(descriptor, columns[i].name, std::strlen(columns[i].name));
+            put(descriptor + column_name_size, &columns[i].element_size, sizeof(columns[i].element_size));
+            put(descriptor + column_name_size + 8, &offset, sizeof(offset));
+
+            file.resize(offset + padded(size));
+            put(offset, columns[i].data, size);
+        }
+
+        std::ofstream output{ path, std::ios::binary };
+        output.write(file.data(), file.size());
+        return output.good();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options{};
+    if(!parseOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if(options.backend == Chip8::Backend::JIT && !Chip8::isJitSupported())
+    {
+        std::cout << "The JIT is unsupported on this platform!\n";
+        return 1;
+    }
+
+    Manifest manifest{};
+    if(!readManifest(options.manifest, manifest))
+    {
+        return 1;
+    }
+    if(manifest.jobs.size() > std::numeric_limits<std::uint32_t>::max())
+    {
+        std::cout << "Too many jobs!\n";
+        return 1;
+    }
+
+    // Every thread starts with an even share of consecutive jobs
+    std::size_t thread_count{ std::min<std::size_t>(options.threads, std::max<std::size_t>(manifest.jobs.size(), 1)) };
+    std::vector<JobRange> ranges(thread_count);
+    for(std::size_t i{}; i < thread_count; ++i)
+    {
+        std::uint32_t begin = manifest.jobs.size() * i / thread_count;
+        std::uint32_t end = manifest.jobs.size() * (i + 1) / thread_count;
+        ranges[i].bounds.store(JobRange::pack(begin, end));
+    }
+
+    Results results{ manifest.jobs.size() };
+    auto begin{ std::chrono::steady_clock::now() };
+    {
+        std::vector<std::jthread> threads{};
+        for(std::size_t i{}; i < thread_count; ++i)
+        {
+            threads.emplace_back([&, i]
+            {
+                // An emulator is too big for the stack of a thread
+                auto emulator{ std::make_unique<Chip8>() };
+                emulator->setTimerMode(Timer::Mode::VIRTUAL);
+                emulator->setInstructionsPerFrame(options.instructions_per_frame);
+                emulator->setBackend(options.backend);
+                // Every job clears the memory, which starts the random numbers over from the seed
+                emulator->setSeed(options.seed);
+
+                std::uint32_t job{};
+                while(takeJob(ranges, i, job))
+                {
+                    runJob(*emulator, manifest, job, options.instructions_per_frame, results);
+                }
+            });
+        }
+    }
+    std::chrono::duration<double> taken{ std::chrono::steady_clock::now() - begin };
+
+    if(!writeResults(options.output, results))
+    {
+        std::cout << "Couldn't write " << options.output << "!\n";
+        return 1;
+    }
+
+    std::uint64_t instructions{};
+    for(std::size_t i{}; i < manifest.jobs.size(); ++i)
+    {
+        instructions += results.executed[i] + results.elided[i];
+    }
+    printf("jobs=%zu\n", manifest.jobs.size());
+    printf("threads=%zu\n", thread_count);
+    printf("seconds=%.6f\n", taken.count());
+    printf("jobs_per_second=%.2f\n", manifest.jobs.size() / taken.count());
+    printf("mips=%.2f\n", instructions / taken.count() / 1e6);
+    return 0;
+}
@@ -0,0 +1,112 @@
+// chip8-bench - measures how fast every execution backend runs a ROM
+//
+// Usage: chip8-bench <rom.ch8> [instructions] [aot module]
+//
+// Runs the ROM from a fresh emulator on every backend, in slices the size of a 60 FPS frame at 1 MHz,
+// and prints the time taken along with a hash of the registers and memory so the results can be compared.
+// The AOT backend is only measured when a module made by chip8-aot from the same ROM is provided.
+
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include "../header/Chip8.hpp"
+
+namespace
+{
+    constexpr std::uint64_t slice{ 1000000 / 60 };
+
+    std::uint64_t hashState(Chip8& emulator)
+    {
+        std::uint64_t hash{ 1469598103934665603ull };
+        auto mix{ [&](unsigned value) { hash = (hash ^ value) * 1099511628211ull; } };
+
+        for(Chip8_t::Word i{}; i < Chip8Const::mem_size; ++i)
+        {
+            mix(emulator.getMemoryAt(i));
+        }
+        for(Chip8_t::Byte i{}; i < Chip8Const::reg_amount; ++i)
+        {
+            mix(emulator.getReg(i));
+        }
+        mix(emulator.getPC());
+        mix(emulator.getI());
+        return hash;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2 || argc > 4)
+    {
+        std::cout << "Usage: " << argv[0] << " <rom.ch8> [instructions] [aot module]\n";
+        return 1;
+    }
+
+    std::uint64_t instructions{ argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100000000ull };
+    const char* aot_module{ argc > 3 ? argv[3] : nullptr };
+
+    struct Entry
+    {
+        const char* name;
+        Chip8::Backend backend;
+    };
+    const Entry backends[]
+    {
+        {"Interpreter", Chip8::Backend::INTERPRETER},
+        {"Threaded", Chip8::Backend::THREADED},
+        {"Cached blocks", Chip8::Backend::CACHED_BLOCKS},
+        {"JIT", Chip8::Backend::JIT},
+        {"AOT", Chip8::Backend::AOT},
+    };
+
+    printf("%-14s %10s %10s  %s\n", "Backend", "Seconds", "MIPS", "State hash");
+    for(const Entry& entry : backends)
+    {
+        if(entry.backend == Chip8::Backend::JIT && !Chip8::isJitSupported())
+        {
+            printf("%-14s unsupported on this platform\n", entry.name);
+            continue;
+        }
+        if(entry.backend == Chip8::Backend::AOT && aot_module == nullptr)
+        {
+            continue;
+        }
+
+        // A new emulator starts from the default seed, so every backend gets the same random numbers
+        Chip8 emulator{};
+        if(!emulator.loadMemory(argv[1]))
+        {
+            std::cout << "Couldn't load " << argv[1] << "!\n";
+            return 1;
+        }
+        if(entry.backend == Chip8::Backend::AOT && !emulator.loadAotModule(aot_module))
+        {
+            std::cout << "Couldn't load " << aot_module << "!\n";
+            return 1;
+        }
+        emulator.setBackend(entry.backend);
+
+        // Virtual timers with a slice per frame, so the timers (and the hash) don't depend on how fast the backend is
+        emulator.setTimerMode(Timer::Mode::VIRTUAL);
+        emulator.setInstructionsPerFrame(slice);
+
+        // Keep going through key waits so every backend does the same amount of work
+        Chip8::StopConditions conditions{};
+        conditions.key_wait = false;
+        conditions.idle = false;
+
+        auto begin{ std::chrono::steady_clock::now() };
+        for(std::uint64_t done{}; done < instructions;)
+        {
+            done += emulator.run(std::min(slice, instructions - done), conditions).executed;
+        }
+        std::chrono::duration<double> taken{ std::chrono::steady_clock::now() - begin };
+
+        printf("%-14s %10.3f %10.1f  %016llx\n", entry.name, taken.count(), instructions / taken.count() / 1e6,
+               (unsigned long long)hashState(emulator));
+    }
+
+    return 0;
+}
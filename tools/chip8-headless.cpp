@@ -0,0 +1,243 @@
+// chip8-headless - runs a ROM without a frontend and dumps the final state
+//
+// Usage: chip8-headless <rom.ch8> [options]
+//   --instructions <n>     how many instructions to run (default 1000000)
+//   --frames <n>           how many frames to run instead, <n> * the instructions per frame
+//   --ipf <n>              instructions per frame (default 11)
+//   --behaviour <name>     chip8 or superchip (default chip8)
+//   --backend <name>       interpreter, threaded, blocks, jit or aot (default interpreter)
+//   --aot <module>         the module made by chip8-aot for the aot backend
+//   --input <script>       key presses, one "<frame> <key> <down|up>" per line, the key in hex ('#' starts a comment)
+//   --seed <n>             seed of the random numbers (default 1)
+//   --save <file>          writes the final state as a save file (see SaveFile.hpp)
+//   --display              prints the display as text
+//   --check-idle           also runs without skipping idle loops and checks both end in the same state
+//
+// The timers are virtual (a frame is --ipf instructions), so the same arguments always give the same results.
+// Every instruction counts, including the ones skipped while waiting for a key or the delay timer.
+// The state is printed as "name=value" lines, so it can be compared or parsed by scripts.
+
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "../header/Chip8.hpp"
+#include "../header/SaveFile.hpp"
+#include "HeadlessRun.hpp"
+
+namespace
+{
+    struct Options
+    {
+        const char* rom{};
+        std::uint64_t instructions{ 1000000 };
+        std::uint64_t frames{};
+        std::uint32_t instructions_per_frame{ 11 };
+        Chip8::BehaviourType behaviour{ Chip8::BehaviourType::CHIP8 };
+        Chip8::Backend backend{ Chip8::Backend::INTERPRETER };
+        const char* aot_module{};
+        const char* input{};
+        std::uint64_t seed{ Random::default_seed };
+        const char* save{};
+        bool display{};
+        bool check_idle{};
+    };
+
+    void printUsage(const char* name)
+    {
+        std::cout << "Usage: " << name << " <rom.ch8> [--instructions n | --frames n] [--ipf n] [--behaviour chip8|superchip]\n"
+                  << "       [--backend interpreter|threaded|blocks|jit|aot] [--aot module] [--input script] [--seed n]\n"
+                  << "       [--save file] [--display] [--check-idle]\n";
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options)
+    {
+        if(argc < 2)
+        {
+            return false;
+        }
+        options.rom = argv[1];
+
+        for(int i{ 2 }; i < argc; ++i)
+        {
+            std::string option{ argv[i] };
+            if(option == "--display")
+            {
+                options.display = true;
+                continue;
+            }
+            if(option == "--check-idle")
+            {
+                options.check_idle = true;
+                continue;
+            }
+
+            // Everything else takes a value
+            if(i + 1 >= argc)
+            {
+                return false;
+            }
+            const char* value{ argv[++i] };
+            if(option == "--instructions") options.instructions = std::strtoull(value, nullptr, 10);
+            else if(option == "--frames") options.frames = std::strtoull(value, nullptr, 10);
+            else if(option == "--ipf") options.instructions_per_frame = std::max<std::uint32_t>(std::strtoul(value, nullptr, 10), 1);
+            else if(option == "--aot") options.aot_module = value;
+            else if(option == "--input") options.input = value;
+            else if(option == "--seed") options.seed = std::strtoull(value, nullptr, 10);
+            else if(option == "--save") options.save = value;
+            else if(option == "--behaviour")
+            {
+                if(!HeadlessRun::parseBehaviour(value, options.behaviour))
+                {
+                    return false;
+                }
+            }
+            else if(option == "--backend")
+            {
+                if(!HeadlessRun::parseBackend(value, options.backend))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //  Name:           setUp
+    //  Description:    sets an emulator up as the options say: loads the ROM and the AOT module, picks the backend and queues the keys
+    //  Arguments:      emulator - the emulator
+    //                  options - the options
+    //  Return:         true if everything loaded, false otherwise
+    bool setUp(Chip8& emulator, const Options& options)
+    {
+        emulator.setSeed(options.seed);
+        emulator.setBehaviourType(options.behaviour);
+        emulator.setTimerMode(Timer::Mode::VIRTUAL);
+        emulator.setInstructionsPerFrame(options.instructions_per_frame);
+        if(!emulator.loadMemory(options.rom))
+        {
+            std::cout << "Couldn't load " << options.rom << "!\n";
+            return false;
+        }
+        if(options.backend == Chip8::Backend::AOT && (options.aot_module == nullptr || !emulator.loadAotModule(options.aot_module)))
+        {
+            std::cout << "Couldn't load the AOT module!\n";
+            return false;
+        }
+        if(options.backend == Chip8::Backend::JIT && !Chip8::isJitSupported())
+        {
+            std::cout << "The JIT is unsupported on this platform!\n";
+            return false;
+        }
+        emulator.setBackend(options.backend);
+        if(options.input != nullptr)
+        {
+            std::vector<HeadlessRun::ScriptedKey> keys{};
+            if(!HeadlessRun::readInputScript(options.input, keys))
+            {
+                return false;
+            }
+            HeadlessRun::queueInputScript(emulator, keys, options.instructions_per_frame);
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options{};
+    if(!parseOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    Chip8 emulator{};
+    if(!setUp(emulator, options))
+    {
+        return 1;
+    }
+
+    std::uint64_t end{ options.frames > 0 ? options.frames * options.instructions_per_frame : options.instructions };
+    auto begin{ std::chrono::steady_clock::now() };
+    Chip8::RunResult total{ HeadlessRun::runUntil(emulator, end) };
+    std::chrono::duration<double> taken{ std::chrono::steady_clock::now() - begin };
+
+    Chip8::MachineState state{};
+    emulator.saveState(state);
+
+    // The same run going around idle loops instead of skipping them has to end in the same state
+    bool same_idle{ true };
+    if(options.check_idle)
+    {
+        Chip8 reference{};
+        if(!setUp(reference, options))
+        {
+            return 1;
+        }
+        Chip8::StopConditions conditions{};
+        conditions.idle = false;
+        HeadlessRun::runUntil(reference, end, conditions);
+
+        Chip8::MachineState expected{};
+        reference.saveState(expected);
+        same_idle = expected.PC == state.PC && expected.cycles == state.cycles &&
+                    HeadlessRun::hashState(expected) == HeadlessRun::hashState(state) &&
+                    HeadlessRun::hashDisplay(expected) == HeadlessRun::hashDisplay(state);
+    }
+
+    printf("rom=%s\n", options.rom);
+    printf("rom_hash=%016llx\n", (unsigned long long)state.rom_hash);
+    printf("cycles=%llu\n", (unsigned long long)state.cycles);
+    printf("executed=%llu\n", (unsigned long long)total.executed);
+    printf("elided=%llu\n", (unsigned long long)total.elided);
+    printf("stop=%s\n", HeadlessRun::getStopName(total.reason));
+    printf("pc=%03X\n", state.PC);
+    printf("i=%03X\n", state.I);
+    printf("v=");
+    for(Chip8_t::Byte reg{}; reg < Chip8Const::reg_amount; ++reg)
+    {
+        printf("%02X%s", state.regs.read(reg), reg + 1 < Chip8Const::reg_amount ? " " : "\n");
+    }
+    printf("stack=");
+    for(Chip8_t::Word address : state.stack.view())
+    {
+        printf("%03X ", address);
+    }
+    printf("\n");
+    printf("delay_timer=%u\n", state.delay_timer);
+    printf("sound_timer=%u\n", state.sound_timer);
+    printf("state_hash=%016llx\n", (unsigned long long)HeadlessRun::hashState(state));
+    printf("display_hash=%016llx\n", (unsigned long long)HeadlessRun::hashDisplay(state));
+    printf("seconds=%.6f\n", taken.count());
+    printf("mips=%.2f\n", (total.executed + total.elided) / taken.count() / 1e6);
+    if(options.check_idle)
+    {
+        printf("idle_check=%s\n", same_idle ? "same" : "different");
+    }
+
+    if(options.display)
+    {
+        for(Chip8_t::Word y{}; y < state.display.getHeight(); ++y)
+        {
+            std::string row(state.display.getWidth(), '.');
+            for(Chip8_t::Word x{}; x < state.display.getWidth(); ++x)
+            {
+                row[x] = state.display.getPixel(x, y) ? '#' : '.';
+            }
+            printf("%s\n", row.c_str());
+        }
+    }
+
+    if(options.save != nullptr && !SaveFile::write(options.save, state))
+    {
+        std::cout << "Couldn't write " << options.save << "!\n";
+        return 1;
+    }
+    return same_idle ? 0 : 1;
+}
@@ -0,0 +1,237 @@
+// chip8-lockstep - runs many copies of a ROM in lockstep (see Lockstep.hpp) and prints how well they kept together
+//
+// Usage: chip8-lockstep <rom.ch8> [options]
+//   --lanes <n>            how many copies run (default 256)
+//   --frames <n>           how many frames every copy runs (default 600)
+//   --ipf <n>              instructions per frame (default 11)
+//   --behaviour <name>     chip8 or superchip (default chip8)
+//   --seed <n>             seed of the random numbers of the first copy (default 1)
+//   --seed-per-lane        copy n gets the seed + n, instead of every copy the same seed
+//   --random-keys          every copy gets its own random key presses, made from its index
+//   --verify               also runs every copy on a Chip8 and checks both give the same state
+//
+// The timers are virtual, so the same arguments always give the same results, like chip8-headless.
+
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "../header/Chip8.hpp"
+#include "../header/Lockstep.hpp"
+#include "HeadlessRun.hpp"
+
+namespace
+{
+    struct Options
+    {
+        const char* rom{};
+        std::size_t lanes{ 256 };
+        std::uint64_t frames{ 600 };
+        std::uint32_t instructions_per_frame{ 11 };
+        Chip8::BehaviourType behaviour{ Chip8::BehaviourType::CHIP8 };
+        std::uint64_t seed{ Random::default_seed };
+        bool seed_per_lane{};
+        bool random_keys{};
+        bool verify{};
+    };
+
+    void printUsage(const char* name)
+    {
+        std::cout << "Usage: " << name << " <rom.ch8> [--lanes n] [--frames n] [--ipf n] [--behaviour chip8|superchip]\n"
+                  << "       [--seed n] [--seed-per-lane] [--random-keys] [--verify]\n";
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options)
+    {
+        if(argc < 2)
+        {
+            return false;
+        }
+        options.rom = argv[1];
+
+        for(int i{ 2 }; i < argc; ++i)
+        {
+            std::string option{ argv[i] };
+            if(option == "--seed-per-lane") { options.seed_per_lane = true; continue; }
+            if(option == "--random-keys") { options.random_keys = true; continue; }
+            if(option == "--verify") { options.verify = true; continue; }
+
+            // Everything else takes a value
+            if(i + 1 >= argc)
+            {
+                return false;
+            }
+            const char* value{ argv[++i] };
+            if(option == "--lanes") options.lanes = std::max<std::size_t>(std::strtoull(value, nullptr, 10), 1);
+            else if(option == "--frames") options.frames = std::strtoull(value, nullptr, 10);
+            else if(option == "--ipf") options.instructions_per_frame = std::max<std::uint32_t>(std::strtoul(value, nullptr, 10), 1);
+            else if(option == "--seed") options.seed = std::strtoull(value, nullptr, 10);
+            else if(option == "--behaviour")
+            {
+                if(!HeadlessRun::parseBehaviour(value, options.behaviour))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //  Name:           makeRandomKeys
+    //  Description:    makes a key script of random presses, a key is held for 1 - 8 frames every 16 frames
+    //  Arguments:      lane - the index of the copy, the presses are made from it
+    //                  frames - the length of the script
+    //  Return:         the script
+    std::vector<HeadlessRun::ScriptedKey> makeRandomKeys(std::size_t lane, std::uint64_t frames)
+    {
+        Random random{ lane + 1 };
+        std::vector<HeadlessRun::ScriptedKey> keys{};
+        for(std::uint64_t frame{ random.next() % 16 }; frame < frames; frame += 16)
+        {
+            Chip8_t::Byte key{ (Chip8_t::Byte)(random.next() % Chip8Const::buttons) };
+            keys.push_back({ frame, key, true });
+            keys.push_back({ frame + 1 + random.next() % 8, key, false });
+        }
+        return keys;
+    }
+
+    //  Name:           queueKeys
+    //  Description:    queues a key script on a lane, the same way HeadlessRun::queueInputScript does on a Chip8
+    //  Arguments:      engine - the lanes
+    //                  lane - the lane to queue the keys on
+    //                  keys - the script
+    //                  instructions_per_frame - the length of a frame
+    void queueKeys(Lockstep& engine, std::size_t lane, const std::vector<HeadlessRun::ScriptedKey>& keys, std::uint32_t instructions_per_frame)
+    {
+        for(const HeadlessRun::ScriptedKey& key : keys)
+        {
+            std::uint64_t cycle{ key.frame * instructions_per_frame };
+            if(key.down)
+            {
+                engine.queueKeyEvent(lane, cycle, key.key, Chip8::KeyState::DOWN);
+            }
+            else
+            {
+                engine.queueKeyEvent(lane, cycle, key.key, Chip8::KeyState::JUST_RELEASED);
+                engine.queueKeyEvent(lane, cycle + instructions_per_frame, key.key, Chip8::KeyState::UP);
+            }
+        }
+    }
+
+    //  Name:           isSameState
+    //  Description:    compares what a ROM can see of two states
+    //  Arguments:      a, b - the states
+    //  Return:         true if they are the same
+    bool isSameState(const Chip8::MachineState& a, const Chip8::MachineState& b)
+    {
+        if(HeadlessRun::hashState(a) != HeadlessRun::hashState(b) || HeadlessRun::hashDisplay(a) != HeadlessRun::hashDisplay(b))
+        {
+            return false;
+        }
+        std::span<const Chip8_t::Word> stack_a{ a.stack.view() };
+        std::span<const Chip8_t::Word> stack_b{ b.stack.view() };
+        return std::equal(stack_a.begin(), stack_a.end(), stack_b.begin(), stack_b.end()) &&
+               a.delay_timer == b.delay_timer && a.sound_timer == b.sound_timer && a.keys == b.keys &&
+               a.cycles == b.cycles && a.random.getState() == b.random.getState();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options{};
+    if(!parseOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::vector<Chip8_t::Byte> rom{};
+    if(!HeadlessRun::readRom(options.rom, rom))
+    {
+        return 1;
+    }
+
+    std::vector<std::vector<HeadlessRun::ScriptedKey>> keys(options.lanes);
+    for(std::size_t lane{}; lane < options.lanes && options.random_keys; ++lane)
+    {
+        keys[lane] = makeRandomKeys(lane, options.frames);
+    }
+    auto getSeed{ [&](std::size_t lane) { return options.seed + (options.seed_per_lane ? lane : 0); } };
+
+    Lockstep engine{ options.lanes };
+    engine.setBehaviourType(options.behaviour);
+    engine.setInstructionsPerFrame(options.instructions_per_frame);
+    for(std::size_t lane{}; lane < options.lanes; ++lane)
+    {
+        engine.setSeed(lane, getSeed(lane));
+    }
+    engine.clearMemory();
+    engine.loadMemory(rom);
+    for(std::size_t lane{}; lane < options.lanes; ++lane)
+    {
+        queueKeys(engine, lane, keys[lane], options.instructions_per_frame);
+    }
+
+    std::uint64_t end{ options.frames * options.instructions_per_frame };
+    auto begin{ std::chrono::steady_clock::now() };
+    std::size_t running{ engine.run(end) };
+    std::chrono::duration<double> taken{ std::chrono::steady_clock::now() - begin };
+
+    const Lockstep::Counters& counters{ engine.getCounters() };
+    printf("rom=%s\n", options.rom);
+    printf("lanes=%zu\n", options.lanes);
+    printf("running=%zu\n", running);
+    printf("cycles=%llu\n", (unsigned long long)counters.cycles);
+    printf("instructions=%llu\n", (unsigned long long)counters.instructions);
+    printf("vector_instructions=%llu\n", (unsigned long long)counters.vector_instructions);
+    printf("vector_groups=%llu\n", (unsigned long long)counters.vector_groups);
+    printf("divergent_cycles=%llu\n", (unsigned long long)counters.divergent_cycles);
+    printf("utilisation=%.4f\n", counters.getUtilisation(options.lanes));
+    printf("seconds=%.6f\n", taken.count());
+    printf("mips=%.2f\n", counters.instructions / taken.count() / 1e6);
+
+    if(!options.verify)
+    {
+        return 0;
+    }
+
+    // Every lane against a Chip8 with the same arguments
+    std::size_t mismatches{};
+    auto scalar_begin{ std::chrono::steady_clock::now() };
+    for(std::size_t lane{}; lane < options.lanes; ++lane)
+    {
+        Chip8 emulator{};
+        emulator.setSeed(getSeed(lane));
+        emulator.setBehaviourType(options.behaviour);
+        emulator.setTimerMode(Timer::Mode::VIRTUAL);
+        emulator.setInstructionsPerFrame(options.instructions_per_frame);
+        emulator.clearMemory();
+        emulator.loadMemory(rom);
+        HeadlessRun::queueInputScript(emulator, keys[lane], options.instructions_per_frame);
+        HeadlessRun::runUntil(emulator, end);
+
+        Chip8::MachineState expected{};
+        Chip8::MachineState state{};
+        emulator.saveState(expected);
+        engine.saveState(lane, state);
+        if(!isSameState(expected, state))
+        {
+            if(mismatches == 0)
+            {
+                printf("first_mismatch=%zu (pc %03X / %03X, cycles %llu / %llu)\n", lane, expected.PC, state.PC,
+                       (unsigned long long)expected.cycles, (unsigned long long)state.cycles);
+            }
+            ++mismatches;
+        }
+    }
+    std::chrono::duration<double> scalar_taken{ std::chrono::steady_clock::now() - scalar_begin };
+    printf("scalar_seconds=%.6f\n", scalar_taken.count());
+    printf("mismatches=%zu\n", mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
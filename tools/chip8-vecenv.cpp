@@ -0,0 +1,166 @@
+// chip8-vecenv - steps many environments of a ROM with random actions (see VecEnv.hpp) and prints how fast they ran
+//
+// Usage: chip8-vecenv <rom.ch8> <spec> [options]
+//   --envs <n>             how many environments (default 64)
+//   --threads <n>          how many threads step them, 0 for one per core (default 0)
+//   --steps <n>            how many steps (default 1000)
+//   --frame-skip <n>       frames per step (default 4)
+//   --ipf <n>              instructions per frame (default 11)
+//   --behaviour <name>     chip8 or superchip (default chip8)
+//   --seed <n>             seed of the environments and of the actions (default 1)
+//   --unpacked             a byte per pixel in the observations, instead of a bit
+//   --no-auto-reset        keep going after an episode ended
+//
+// The spec says where the rewards and the ends of episodes are in the memory of the ROM, e.g. for ROM/Pong.ch8
+// (ROM/Pong.spec, both scores are in VE = 10 * left + right, stored with FX33):
+//   reward 0x2F2 bytes 2 bcd       # the left player scored
+//   reward 0x2F4 scale -1          # the right player scored
+//   done 0x2F4 eq 9                # before the right player's 10th point carries into the left player's digits
+//   done 0x2F2 eq 2                # before VE wraps around past 255
+//   max_frames 3600
+//
+// The actions are made from the seed, so the same arguments give the same checksum whatever the amount of threads.
+
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "../header/VecEnv.hpp"
+#include "HeadlessRun.hpp"
+
+namespace
+{
+    struct Options
+    {
+        const char* rom{};
+        const char* spec{};
+        std::uint64_t steps{ 1000 };
+        VecEnv::Options environment{};
+    };
+
+    void printUsage(const char* name)
+    {
+        std::cout << "Usage: " << name << " <rom.ch8> <spec> [--envs n] [--threads n] [--steps n] [--frame-skip n] [--ipf n]\n"
+                  << "       [--behaviour chip8|superchip] [--seed n] [--unpacked] [--no-auto-reset]\n";
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options)
+    {
+        if(argc < 3)
+        {
+            return false;
+        }
+        options.rom = argv[1];
+        options.spec = argv[2];
+        options.environment.environments = 64;
+        options.environment.threads = 0;
+
+        for(int i{ 3 }; i < argc; ++i)
+        {
+            std::string option{ argv[i] };
+            if(option == "--unpacked") { options.environment.observation = VecEnv::Observation::UNPACKED; continue; }
+            if(option == "--no-auto-reset") { options.environment.auto_reset = false; continue; }
+
+            // Everything else takes a value
+            if(i + 1 >= argc)
+            {
+                return false;
+            }
+            const char* value{ argv[++i] };
+            if(option == "--envs") options.environment.environments = std::max<std::size_t>(std::strtoull(value, nullptr, 10), 1);
+            else if(option == "--threads") options.environment.threads = std::strtoull(value, nullptr, 10);
+            else if(option == "--steps") options.steps = std::strtoull(value, nullptr, 10);
+            else if(option == "--frame-skip") options.environment.frame_skip = std::max<std::uint32_t>(std::strtoul(value, nullptr, 10), 1);
+            else if(option == "--ipf") options.environment.instructions_per_frame = std::max<std::uint32_t>(std::strtoul(value, nullptr, 10), 1);
+            else if(option == "--seed") options.environment.seed = std::strtoull(value, nullptr, 10);
+            else if(option == "--behaviour")
+            {
+                if(!HeadlessRun::parseBehaviour(value, options.environment.behaviour))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options{};
+    if(!parseOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    VecEnv::Spec spec{};
+    if(!VecEnv::readSpec(options.spec, spec))
+    {
+        return 1;
+    }
+    VecEnv environments{ options.environment, spec };
+    if(!environments.loadMemory(options.rom))
+    {
+        std::cout << "Couldn't load " << options.rom << "!\n";
+        return 1;
+    }
+
+    std::size_t count{ environments.getEnvironmentCount() };
+    std::vector<std::uint16_t> actions(count);
+    std::vector<std::uint8_t> observations(count * environments.getObservationSize());
+    std::vector<float> rewards(count);
+    std::vector<std::uint8_t> dones(count);
+    if(!environments.reset(observations))
+    {
+        return 1;
+    }
+
+    // A key at a time, held for a few steps
+    Random random{ options.environment.seed };
+    double total_reward{};
+    std::uint64_t episodes{};
+    HeadlessRun::Hash hash{};
+    auto begin{ std::chrono::steady_clock::now() };
+    for(std::uint64_t step{}; step < options.steps; ++step)
+    {
+        for(std::uint16_t& action : actions)
+        {
+            std::uint32_t value{ random.next() };
+            if(value % 4 == 0)
+            {
+                action = (std::uint16_t)(1u << (value >> 28));
+            }
+        }
+        if(!environments.step(actions, observations, rewards, dones))
+        {
+            return 1;
+        }
+        for(std::size_t i{}; i < count; ++i)
+        {
+            total_reward += rewards[i];
+            episodes += dones[i];
+            hash.mix((std::uint64_t)(std::int64_t)rewards[i] << 1 | dones[i]);
+        }
+    }
+    std::chrono::duration<double> taken{ std::chrono::steady_clock::now() - begin };
+    for(std::uint8_t byte : observations)
+    {
+        hash.mix(byte);
+    }
+
+    printf("environments=%zu\n", count);
+    printf("steps=%llu\n", (unsigned long long)options.steps);
+    printf("episodes=%llu\n", (unsigned long long)episodes);
+    printf("total_reward=%.2f\n", total_reward);
+    printf("checksum=%016llx\n", (unsigned long long)hash.value);
+    printf("seconds=%.6f\n", taken.count());
+    printf("steps_per_second=%.0f\n", options.steps * count / taken.count());
+    return 0;
+}